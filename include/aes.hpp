@@ -13,6 +13,9 @@
 #include <cstdint> // Standardized types of guaranteed sizes
 #include <vector>
 #include <iostream>
+#include <string>
+#include <type_traits>
+#include "gf256.hpp"
 
 /**
  * @brief Used to prevent a cache-based side-channel attack that exploits the time-delta between CPU cache and main memory
@@ -25,6 +28,13 @@
  */
 extern "C" uint8_t no_cache_lookup(uint8_t row, uint8_t col, const uint8_t* lookup_table); //  NOLINT(modernize-use-trailing-return-type)  Come on linter, this is C...
 
+/**
+ * @brief Batched form of no_cache_lookup that substitutes 16 bytes (an entire AES state) in place
+ * The 16 rows of the 16-byte aligned lookup table are each loaded once, every byte is resolved with pshufb on its low nibble
+ * and kept through a compare-and-mask on its high nibble, so the access pattern is independent of the state.
+ */
+extern "C" void no_cache_lookup_state(uint8_t* state, const uint8_t* lookup_table);
+
 // namespace aes
 namespace aes
 {
@@ -53,49 +63,258 @@ namespace aes
 
     using CipherTuple = Tuple<std::vector<aes::byte>, std::vector<aes::byte>>;
 
+    /**
+     * Non-owning view of contiguous elements, the part of C++20 std::span the cipher modes need (the project builds as C++17).
+     * A span<const byte> is implicitly made from a std::vector, a std::array, a block or a span<byte>, so whole buffers pass
+     * without a copy, and subspan selects a range of one without allocating.
+     */
+    template <class T>
+    class span {
+    public:
+        constexpr span() noexcept = default;
+
+        constexpr span(T* data, std::size_t size) noexcept : elements(data), count(size) {}
+
+        template <class Container, class = std::enable_if_t<!std::is_same<std::decay_t<Container>, span>::value &&
+                                                            std::is_convertible<decltype(std::declval<Container&>().data()), T*>::value>>
+        constexpr span(Container&& container) noexcept : span(container.data(), container.size()) {} // NOLINT(bugprone-forwarding-reference-overload) implicit by design, like std::span
+
+        constexpr auto data() const noexcept -> T* { return elements; }
+        constexpr auto size() const noexcept -> std::size_t { return count; }
+        constexpr auto empty() const noexcept -> bool { return count == 0; }
+        constexpr auto begin() const noexcept -> T* { return elements; }
+        constexpr auto end() const noexcept -> T* { return elements + count; }
+        constexpr auto operator[](std::size_t i) const noexcept -> T& { return elements[i]; }
+
+        /**
+         * @brief View of count elements starting at offset, the caller keeps offset + count within size()
+         */
+        constexpr auto subspan(std::size_t offset, std::size_t length) const noexcept -> span { return span(elements + offset, length); }
+
+    private:
+        T* elements = nullptr;
+        std::size_t count = 0;
+    };
+
+    /**
+     * One 16-byte block in its stored (column-major) order. The alignment lets the SIMD engines and the keystream buffers of the
+     * cipher modes use aligned loads, and an array of blocks is a contiguous run of bytes the bulk functions accept directly.
+     */
+    struct alignas(16) block {
+        std::array<byte, 16> bytes;
+
+        auto data() noexcept -> byte* { return bytes.data(); }
+        auto data() const noexcept -> const byte* { return bytes.data(); }
+        static constexpr auto size() noexcept -> std::size_t { return 16; }
+
+        auto operator==(const block& other) const -> bool { return bytes == other.bytes; }
+        auto operator!=(const block& other) const -> bool { return bytes != other.bytes; }
+    };
+    static_assert(sizeof(block) == 16, "aes::block must be exactly 16 bytes, so arrays of blocks are contiguous");
+
     // Templated type aliases for data structure abstraction
     template <class T, std::size_t DIM_X, std::size_t DIM_Y>
     using matrix = std::array<std::array<T, DIM_X>, DIM_Y>;
 
     using state = matrix<byte, NB, NB>;
 
-    alignas(16) constexpr const std::array<byte, 256> S_BOX = {
-        0x63, 0x7C, 0x77, 0x7B, 0xF2, 0x6B, 0x6F, 0xC5, 0x30, 0x01, 0x67, 0x2B, 0xFE, 0xD7, 0xAB, 0x76,
-        0xCA, 0x82, 0xC9, 0x7D, 0xFA, 0x59, 0x47, 0xF0, 0xAD, 0xD4, 0xA2, 0xAF, 0x9C, 0xA4, 0x72, 0xC0,
-        0xB7, 0xFD, 0x93, 0x26, 0x36, 0x3F, 0xF7, 0xCC, 0x34, 0xA5, 0xE5, 0xF1, 0x71, 0xD8, 0x31, 0x15,
-        0x04, 0xC7, 0x23, 0xC3, 0x18, 0x96, 0x05, 0x9A, 0x07, 0x12, 0x80, 0xE2, 0xEB, 0x27, 0xB2, 0x75,
-        0x09, 0x83, 0x2C, 0x1A, 0x1B, 0x6E, 0x5A, 0xA0, 0x52, 0x3B, 0xD6, 0xB3, 0x29, 0xE3, 0x2F, 0x84,
-        0x53, 0xD1, 0x00, 0xED, 0x20, 0xFC, 0xB1, 0x5B, 0x6A, 0xCB, 0xBE, 0x39, 0x4A, 0x4C, 0x58, 0xCF,
-        0xD0, 0xEF, 0xAA, 0xFB, 0x43, 0x4D, 0x33, 0x85, 0x45, 0xF9, 0x02, 0x7F, 0x50, 0x3C, 0x9F, 0xA8,
-        0x51, 0xA3, 0x40, 0x8F, 0x92, 0x9D, 0x38, 0xF5, 0xBC, 0xB6, 0xDA, 0x21, 0x10, 0xFF, 0xF3, 0xD2,
-        0xCD, 0x0C, 0x13, 0xEC, 0x5F, 0x97, 0x44, 0x17, 0xC4, 0xA7, 0x7E, 0x3D, 0x64, 0x5D, 0x19, 0x73,
-        0x60, 0x81, 0x4F, 0xDC, 0x22, 0x2A, 0x90, 0x88, 0x46, 0xEE, 0xB8, 0x14, 0xDE, 0x5E, 0x0B, 0xDB,
-        0xE0, 0x32, 0x3A, 0x0A, 0x49, 0x06, 0x24, 0x5C, 0xC2, 0xD3, 0xAC, 0x62, 0x91, 0x95, 0xE4, 0x79,
-        0xE7, 0xC8, 0x37, 0x6D, 0x8D, 0xD5, 0x4E, 0xA9, 0x6C, 0x56, 0xF4, 0xEA, 0x65, 0x7A, 0xAE, 0x08,
-        0xBA, 0x78, 0x25, 0x2E, 0x1C, 0xA6, 0xB4, 0xC6, 0xE8, 0xDD, 0x74, 0x1F, 0x4B, 0xBD, 0x8B, 0x8A,
-        0x70, 0x3E, 0xB5, 0x66, 0x48, 0x03, 0xF6, 0x0E, 0x61, 0x35, 0x57, 0xB9, 0x86, 0xC1, 0x1D, 0x9E,
-        0xE1, 0xF8, 0x98, 0x11, 0x69, 0xD9, 0x8E, 0x94, 0x9B, 0x1E, 0x87, 0xE9, 0xCE, 0x55, 0x28, 0xDF,
-        0x8C, 0xA1, 0x89, 0x0D, 0xBF, 0xE6, 0x42, 0x68, 0x41, 0x99, 0x2D, 0x0F, 0xB0, 0x54, 0xBB, 0x16
+    /**
+     * Word-oriented alternative to state: column c is one word holding rows 0..3 from its most to its least significant byte.
+     * This is the layout of the key schedule words, so AddRoundKey is four word XORs, and a block is loaded column after
+     * column exactly as it is stored, without the transposition convert_block_to_state performs.
+     */
+    struct alignas(16) column_state {
+        std::array<word, NB> columns;
     };
 
-    alignas(16) constexpr const std::array<byte, 256>  INV_S_BOX = {
-        0x52, 0x09, 0x6a, 0xd5, 0x30, 0x36, 0xa5, 0x38, 0xbf, 0x40, 0xa3, 0x9e, 0x81, 0xf3, 0xd7, 0xfb,
-        0x7c, 0xe3, 0x39, 0x82, 0x9b, 0x2f, 0xff, 0x87, 0x34, 0x8e, 0x43, 0x44, 0xc4, 0xde, 0xe9, 0xcb,
-        0x54, 0x7b, 0x94, 0x32, 0xa6, 0xc2, 0x23, 0x3d, 0xee, 0x4c, 0x95, 0x0b, 0x42, 0xfa, 0xc3, 0x4e,
-        0x08, 0x2e, 0xa1, 0x66, 0x28, 0xd9, 0x24, 0xb2, 0x76, 0x5b, 0xa2, 0x49, 0x6d, 0x8b, 0xd1, 0x25,
-        0x72, 0xf8, 0xf6, 0x64, 0x86, 0x68, 0x98, 0x16, 0xd4, 0xa4, 0x5c, 0xcc, 0x5d, 0x65, 0xb6, 0x92,
-        0x6c, 0x70, 0x48, 0x50, 0xfd, 0xed, 0xb9, 0xda, 0x5e, 0x15, 0x46, 0x57, 0xa7, 0x8d, 0x9d, 0x84,
-        0x90, 0xd8, 0xab, 0x00, 0x8c, 0xbc, 0xd3, 0x0a, 0xf7, 0xe4, 0x58, 0x05, 0xb8, 0xb3, 0x45, 0x06,
-        0xd0, 0x2c, 0x1e, 0x8f, 0xca, 0x3f, 0x0f, 0x02, 0xc1, 0xaf, 0xbd, 0x03, 0x01, 0x13, 0x8a, 0x6b,
-        0x3a, 0x91, 0x11, 0x41, 0x4f, 0x67, 0xdc, 0xea, 0x97, 0xf2, 0xcf, 0xce, 0xf0, 0xb4, 0xe6, 0x73,
-        0x96, 0xac, 0x74, 0x22, 0xe7, 0xad, 0x35, 0x85, 0xe2, 0xf9, 0x37, 0xe8, 0x1c, 0x75, 0xdf, 0x6e,
-        0x47, 0xf1, 0x1a, 0x71, 0x1d, 0x29, 0xc5, 0x89, 0x6f, 0xb7, 0x62, 0x0e, 0xaa, 0x18, 0xbe, 0x1b,
-        0xfc, 0x56, 0x3e, 0x4b, 0xc6, 0xd2, 0x79, 0x20, 0x9a, 0xdb, 0xc0, 0xfe, 0x78, 0xcd, 0x5a, 0xf4,
-        0x1f, 0xdd, 0xa8, 0x33, 0x88, 0x07, 0xc7, 0x31, 0xb1, 0x12, 0x10, 0x59, 0x27, 0x80, 0xec, 0x5f,
-        0x60, 0x51, 0x7f, 0xa9, 0x19, 0xb5, 0x4a, 0x0d, 0x2d, 0xe5, 0x7a, 0x9f, 0x93, 0xc9, 0x9c, 0xef,
-        0xa0, 0xe0, 0x3b, 0x4d, 0xae, 0x2a, 0xf5, 0xb0, 0xc8, 0xeb, 0xbb, 0x3c, 0x83, 0x53, 0x99, 0x61,
-        0x17, 0x2b, 0x04, 0x7e, 0xba, 0x77, 0xd6, 0x26, 0xe1, 0x69, 0x14, 0x63, 0x55, 0x21, 0x0c, 0x7d
+    constexpr const unsigned int MAX_NR = 14; // Round count of AES-256, bounds the size of every key schedule
+
+    /**
+     * Expanded cipher key, computed once per key and shared by every block processed with it.
+     * The round keys are stored in the native layout of each engine, so no round key is converted while blocks are processed:
+     * words for the fused portable rounds and the bitsliced engine, 16-byte aligned blocks in stored byte order for the SIMD
+     * engines. The decryption keys are laid out in the order the inverse cipher consumes them, round Nr first, and are the
+     * keys of the equivalent inverse cipher: every key but the first and last one has InvMixColumns applied, so that decryption
+     * rounds have the same shape as encryption rounds.
+     */
+    struct KeySchedule {
+        /**
+         * @brief Expands a cipher key
+         * @param key_bytes: bytes of the 128, 192 or 256 bit cipher key
+         */
+        explicit KeySchedule(const std::vector<byte>& key_bytes);
+
+        /**
+         * @brief Lays out a key that was already expanded by key_expansion
+         * @param Nr: Number of rounds, which is a function of Nk and Nb
+         * @param w: vector of aes::NB*(Nr+1) words holding the expanded key
+         */
+        KeySchedule(unsigned int Nr, const std::vector<word>& w);
+
+        unsigned int Nr;
+        alignas(16) std::array<word, NB * (MAX_NR + 1)> encryption_words;
+        alignas(16) std::array<word, NB * (MAX_NR + 1)> decryption_words;
+        alignas(16) std::array<byte, 16 * (MAX_NR + 1)> encryption_blocks;
+        alignas(16) std::array<byte, 16 * (MAX_NR + 1)> decryption_blocks;
     };
+
+    /**
+     * Cipher key kept without its expansion, for populations of keys too large to keep a KeySchedule each (68 bytes
+     * instead of about 1 KB). The round keys are generated while the rounds run, from the cipher key when encrypting and
+     * backwards from the end of the schedule when decrypting: the recurrence w[i] = w[i - Nk] ^ f(w[i - 1]) can be solved for
+     * w[i - Nk] as well, so the last Nk words of the schedule are enough to regenerate every earlier one.
+     */
+    struct CompactKey {
+        /**
+         * @brief Stores a cipher key and the end of its schedule
+         * @param key_bytes: bytes of the 128, 192 or 256 bit cipher key
+         */
+        explicit CompactKey(const std::vector<byte>& key_bytes);
+
+        unsigned int Nk;
+        std::array<byte, 32> key;      // The cipher key (words 0 .. Nk - 1 of the schedule), in its first 4 * Nk bytes
+        std::array<byte, 32> last_key; // Words NB * (Nr + 1) - Nk .. NB * (Nr + 1) - 1 of the schedule, in the same byte order
+    };
+
+    /**
+     *@brief Retrieves the inverse modulo x^8+x^4+x^3+x+1 of the given polynomial
+     *The inverse is s^254, computed by gf256::inverse with a fixed chain of multiplications so the time does not depend on s
+     *
+     *@param s: byte that represents an element in the finite field modulo x^8+x^4+x^3+x+1
+     *@return byte: the inverse polynomial of the given polynomial given in byte form (0 for 0)
+     */
+    constexpr auto get_inverse(byte s) -> byte {
+        return gf256::inverse(s);
+    }
+
+    /**
+     * @brief Rotates the bits of a byte left, bit i moves to bit i + count modulo 8
+     *
+     * @param s: Byte being rotated
+     * @param count: Number of positions, between 1 and 7
+     * @return byte: The rotated byte
+     */
+    constexpr auto rotate_byte(byte s, unsigned int count) -> byte {
+        return static_cast<byte>((s << count) | (s >> (8U - count))); // NOLINT(hicpp-signed-bitwise)
+    }
+
+    /**
+     * @brief Applies the affine transformation of SubBytes (the matrix multiplication followed by the addition of 0x63)
+     *
+     * @param s: Byte being transformed
+     * @return byte: The transformed byte
+     */
+    constexpr auto affine_transform(byte s) -> byte {
+        //Bit i of the product is b_i ^ b_(i+4) ^ b_(i+5) ^ b_(i+6) ^ b_(i+7), every row of the matrix is the previous one rotated,
+        //so the matrix multiplication is the xor of the byte with its rotations by 1 to 4
+        return rotate_byte(s, 1U) ^ rotate_byte(s, 2U) ^ rotate_byte(s, 3U) ^ rotate_byte(s, 4U) ^ s ^ 0x63U; // NOLINT(hicpp-signed-bitwise)
+    }
+
+    /**
+     * @brief Undoes affine_transform (the removal of 0x63 followed by the inverse matrix multiplication)
+     *
+     * @param s: Byte being transformed
+     * @return byte: The byte affine_transform maps to s
+     */
+    constexpr auto inverse_affine_transform(byte s) -> byte {
+        //Bit i of the product is b_(i+2) ^ b_(i+5) ^ b_(i+7), the rotations by 6, 3 and 1
+        const byte temp = s ^ 0x63U;
+        return rotate_byte(temp, 1U) ^ rotate_byte(temp, 3U) ^ rotate_byte(temp, 6U); // NOLINT(hicpp-signed-bitwise)
+    }
+
+    /**
+     * @brief Calculates the S-Box value of the given byte
+     *
+     * @param s: Byte whose S-Box value we want to find
+     * @return byte: The S-Box value associated with the given byte
+     */
+    constexpr auto get_S_BOX_value(byte s) -> byte {
+        return affine_transform(get_inverse(s));
+    }
+
+    /**
+     * @brief Calculates the inverse S-Box value of the given byte
+     *
+     * @param s: Byte whose inverse S-Box value we want to find
+     * @return byte: The inverse S-Box value associated with the given byte
+     */
+    constexpr auto get_inverse_S_BOX_value(byte s) -> byte {
+        return get_inverse(inverse_affine_transform(s));
+    }
+
+    /**
+     * @brief rotate_byte applied to all 16 bytes of a register (SSE2 has no byte shifts, so 16-bit shifts are masked)
+     *
+     * @param s: Register holding 16 bytes
+     * @return __m128i: Every byte rotated left by Count
+     */
+    template <unsigned int Count>
+    inline auto rotate_state(__m128i s) -> __m128i {
+        const __m128i high = _mm_and_si128(_mm_slli_epi16(s, Count), _mm_set1_epi8(static_cast<char>((0xffU << Count) & 0xffU)));
+        const __m128i low = _mm_and_si128(_mm_srli_epi16(s, 8U - Count), _mm_set1_epi8(static_cast<char>(0xffU >> (8U - Count))));
+        return _mm_or_si128(high, low);
+    }
+
+    /**
+     * @brief Computes the S-Box value of 16 bytes at once without any table, an on-the-fly SubBytes for secret data
+     *
+     * @param s: Register holding the 16 bytes being substituted
+     * @return __m128i: The 16 S-Box values
+     */
+    inline auto get_S_BOX_state(__m128i s) -> __m128i {
+        const __m128i inverse = gf256::inverse_state(s);
+        const __m128i rotations = _mm_xor_si128(_mm_xor_si128(rotate_state<1>(inverse), rotate_state<2>(inverse)),
+                                                _mm_xor_si128(rotate_state<3>(inverse), rotate_state<4>(inverse)));
+        return _mm_xor_si128(_mm_xor_si128(rotations, inverse), _mm_set1_epi8(0x63));
+    }
+
+    /**
+     * @brief Computes the inverse S-Box value of 16 bytes at once without any table
+     *
+     * @param s: Register holding the 16 bytes being substituted
+     * @return __m128i: The 16 inverse S-Box values
+     */
+    inline auto get_inverse_S_BOX_state(__m128i s) -> __m128i {
+        const __m128i temp = _mm_xor_si128(s, _mm_set1_epi8(0x63));
+        const __m128i linear = _mm_xor_si128(_mm_xor_si128(rotate_state<1>(temp), rotate_state<3>(temp)), rotate_state<6>(temp));
+        return gf256::inverse_state(linear);
+    }
+
+    /**
+     * @brief Evaluates a byte function over all 256 bytes, used to build the substitution tables at compile time
+     *
+     * @param value: Callable mapping a byte to its table entry
+     * @return std::array<byte, 256>: The table indexed by byte
+     */
+    template <class Function>
+    constexpr auto tabulate(Function value) -> std::array<byte, 256> {
+        std::array<byte, 256> table{};
+        for (std::size_t i = 0; i < table.size(); i++) {
+            table[i] = value(static_cast<byte>(i));
+        }
+        return table;
+    }
+
+    alignas(16) constexpr const std::array<byte, 256> S_BOX = tabulate(get_S_BOX_value);
+    alignas(16) constexpr const std::array<byte, 256> INV_S_BOX = tabulate(get_inverse_S_BOX_value);
+
+    /**
+     * @brief Checks that INV_S_BOX undoes S_BOX for every byte
+     * @return bool: true if both tables are inverse permutations of each other
+     */
+    constexpr auto s_boxes_are_inverse() -> bool {
+        for (std::size_t i = 0; i < S_BOX.size(); i++) {
+            if (INV_S_BOX[S_BOX[i]] != i || S_BOX[INV_S_BOX[i]] != i) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Corners and the worked example (0x53 -> 0xed) of FIPS-197 section 5.1.1
+    static_assert(S_BOX[0x00] == 0x63 && S_BOX[0x53] == 0xed && S_BOX[0x0f] == 0x76 && S_BOX[0xf0] == 0x8c && S_BOX[0xff] == 0x16, "S_BOX does not match FIPS-197");
+    static_assert(INV_S_BOX[0x00] == 0x52 && INV_S_BOX[0x0f] == 0xfb && INV_S_BOX[0xf0] == 0x17 && INV_S_BOX[0xff] == 0x7d, "INV_S_BOX does not match FIPS-197");
+    static_assert(s_boxes_are_inverse(), "INV_S_BOX is not the inverse of S_BOX");
     
     
     /**
@@ -166,6 +385,37 @@ namespace aes
      */
     void inv_mix_columns(state &state);
 
+    /**
+     * @brief Drop-in SSE2 replacement for mix_columns
+     * Every row of the state is one 32-bit lane, so the columns are mixed in parallel with lane rotations and a vector xtime
+     *
+     * @param state: reference to the AES state being operated upon
+     */
+    void mix_columns_sse(state &state);
+
+    /**
+     * @brief Drop-in SSE2 replacement for inv_mix_columns
+     *
+     * @param state: reference to the AES state being operated upon
+     */
+    void inv_mix_columns_sse(state &state);
+
+    /**
+     * @brief Performs the mix columns AES operation on two states, with AVX2 when the processor supports it
+     *
+     * @param first: reference to the first AES state being operated upon
+     * @param second: reference to the second AES state being operated upon
+     */
+    void mix_columns_pair(state &first, state &second);
+
+    /**
+     * @brief Performs the inverse mix columns AES operation on two states, with AVX2 when the processor supports it
+     *
+     * @param first: reference to the first AES state being operated upon
+     * @param second: reference to the second AES state being operated upon
+     */
+    void inv_mix_columns_pair(state &first, state &second);
+
     /**
      * @brief Splits a 32bit word into an array of 4 8bit bytes
      * 
@@ -201,12 +451,88 @@ namespace aes
     /**
      * @brief Performs the AES key expanstion routine
      * A cipher key is expanded to generate a key schedule
+     * Dispatches to the aeskeygenassist expansion when the processor supports AES-NI, otherwise to key_expansion_portable
      * @param keyBytes: bytes of the cipher key being used
      * @param w: vector of words of size aes::NB*(nk_nr[1]+1) to store the expanded key
      * @param Nk: Number of 32-bit words comprising the Cipher Key
      * @param Nr: Number of rounds, which is a function of Nk and Nb
      */
-    void key_expansion(std::vector<byte> keyBytes, std::vector<word>& w, unsigned int Nk, unsigned int Nr);
+    void key_expansion(const std::vector<byte>& keyBytes, std::vector<word>& w, unsigned int Nk, unsigned int Nr);
+
+    /**
+     * @brief Performs the AES key expanstion routine with subword (no_cache_lookup based)
+     * @param keyBytes: bytes of the cipher key being used
+     * @param w: vector of words of size aes::NB*(nk_nr[1]+1) to store the expanded key
+     * @param Nk: Number of 32-bit words comprising the Cipher Key
+     * @param Nr: Number of rounds, which is a function of Nk and Nb
+     */
+    void key_expansion_portable(const std::vector<byte>& keyBytes, std::vector<word>& w, unsigned int Nk, unsigned int Nr);
+
+    constexpr const std::size_t KEY_EXPANSION_LANES = 4; // keys expanded together by expand_keys, one word of each per 32-bit lane
+
+    /**
+     * @brief Expands many cipher keys at once
+     * With AES-NI every key goes through aeskeygenassist. Otherwise keys of the same size are expanded KEY_EXPANSION_LANES at a
+     * time with the words of each key in their own SIMD lane, so a single no_cache_lookup_state substitutes SubWord for all of them.
+     * @param keys: cipher keys of 128, 192 or 256 bits, the sizes may be mixed
+     * @return std::vector<KeySchedule>: the schedule of every key, in the order of keys
+     */
+    auto expand_keys(const std::vector<std::vector<byte>>& keys) -> std::vector<KeySchedule>;
+
+    /**
+     * @brief Compile-time form of key_expansion, used to expand the fixed self-test keys while building
+     * SubWord indexes S_BOX directly instead of going through no_cache_lookup, so it is not meant for secret keys at runtime
+     * @tparam Nk: Number of 32-bit words comprising the Cipher Key
+     * @param key_bytes: bytes of the cipher key being used
+     * @return std::array<word, NB*(Nk+7)>: the expanded key, since Nr = Nk + 6
+     */
+    template <unsigned int Nk>
+    constexpr auto constexpr_key_expansion(const std::array<byte, 4 * Nk>& key_bytes) -> std::array<word, NB * (Nk + 7)> {
+        auto substitute = [](word w) -> word {
+            return (word{S_BOX[(w >> 24U) & 0xffU]} << 24U) | (word{S_BOX[(w >> 16U) & 0xffU]} << 16U) |
+                   (word{S_BOX[(w >> 8U) & 0xffU]} << 8U) | word{S_BOX[w & 0xffU]};
+        };
+        std::array<word, NB * (Nk + 7)> w{};
+
+        //the first Nk words of the expanded key are filled with the cipher key
+        for (unsigned int i = 0; i < Nk; i++) {
+            w[i] = (word{key_bytes[4 * i]} << 24U) | (word{key_bytes[4 * i + 1]} << 16U) | (word{key_bytes[4 * i + 2]} << 8U) | word{key_bytes[4 * i + 3]};
+        }
+
+        //same recurrence as key_expansion, RotWord is a rotation by one byte
+        for (unsigned int i = Nk; i < w.size(); i++) {
+            word temp = w[i - 1];
+            if (i % Nk == 0) {
+                temp = substitute((temp << 8U) | (temp >> 24U)) ^ Rcon[i / Nk];
+            } else if (Nk > 6 && (i % Nk == 4)) {
+                temp = substitute(temp);
+            }
+            w[i] = w[i - Nk] ^ temp;
+        }
+        return w;
+    }
+
+    /// Cipher keys of the key expansion examples in FIPS-197 Appendix A, expanded at compile time for the self tests
+    constexpr const std::array<byte, 16> SELF_TEST_KEY_128 = {
+        0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6, 0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c
+    };
+    constexpr const std::array<byte, 24> SELF_TEST_KEY_192 = {
+        0x8e, 0x73, 0xb0, 0xf7, 0xda, 0x0e, 0x64, 0x52, 0xc8, 0x10, 0xf3, 0x2b,
+        0x80, 0x90, 0x79, 0xe5, 0x62, 0xf8, 0xea, 0xd2, 0x52, 0x2c, 0x6b, 0x7b
+    };
+    constexpr const std::array<byte, 32> SELF_TEST_KEY_256 = {
+        0x60, 0x3d, 0xeb, 0x10, 0x15, 0xca, 0x71, 0xbe, 0x2b, 0x73, 0xae, 0xf0, 0x85, 0x7d, 0x77, 0x81,
+        0x1f, 0x35, 0x2c, 0x07, 0x3b, 0x61, 0x08, 0xd7, 0x2d, 0x98, 0x10, 0xa3, 0x09, 0x14, 0xdf, 0xf4
+    };
+
+    constexpr const auto SELF_TEST_SCHEDULE_128 = constexpr_key_expansion<4>(SELF_TEST_KEY_128);
+    constexpr const auto SELF_TEST_SCHEDULE_192 = constexpr_key_expansion<6>(SELF_TEST_KEY_192);
+    constexpr const auto SELF_TEST_SCHEDULE_256 = constexpr_key_expansion<8>(SELF_TEST_KEY_256);
+
+    // First derived word and last word of every expansion in FIPS-197 Appendix A
+    static_assert(SELF_TEST_SCHEDULE_128[4] == 0xa0fafe17U && SELF_TEST_SCHEDULE_128[43] == 0xb6630ca6U, "AES-128 key expansion does not match FIPS-197");
+    static_assert(SELF_TEST_SCHEDULE_192[6] == 0xfe0c91f7U && SELF_TEST_SCHEDULE_192[51] == 0x01002202U, "AES-192 key expansion does not match FIPS-197");
+    static_assert(SELF_TEST_SCHEDULE_256[8] == 0x9ba35411U && SELF_TEST_SCHEDULE_256[59] == 0x706c631eU, "AES-256 key expansion does not match FIPS-197");
 
     /**
      * @brief Performs a substition of a word using the Sbox
@@ -226,62 +552,293 @@ namespace aes
 
     /**
      * @brief Performs the AES encryption
+     * Dispatches to the active engine, engines without a state form go through their block routine
      * @param Nr: Number of rounds, which is a function of Nk and Nb
      * @param state: Reference to AES state being operated upon
      * @param w: Reference to the expanded key
      */
     void encrypt(unsigned int Nr, state& state, const std::vector<word>& w);
-    
+
     /**
      * @brief Performs the AES decryption
+     * Dispatches to the active engine, engines without a state form go through their block routine
      * @param Nr: Number of rounds, which is a function of Nk and Nb
      * @param state: Reference to AES state being operated upon
      * @param w: Reference to the expanded key
      */
-    void decrypt(unsigned int Nr, state& state, const std::vector<word>& w);    
-    
+    void decrypt(unsigned int Nr, state& state, const std::vector<word>& w);
+
     /**
-     *@brief Calculate the position of the most signicant (right-most) bit of the byte given
+     * @brief Loads a 16-byte block into a column_state
      *
-     *@param s: byte being operated upon
-     *@return uint8_t: unsigned integer with the position of the most significant bit
+     * @param block: Pointer to the 16 bytes of the block
+     * @return column_state: The block, one column per word
      */
-    auto get_most_sig_bit(byte s) -> uint8_t;
+    auto load_columns(const byte* block) -> column_state;
 
+    /**
+     * @brief Stores a column_state as a 16-byte block
+     *
+     * @param state: Constant reference to the state being stored
+     * @param block: Pointer to where the 16 bytes of the block are written
+     */
+    void store_columns(const column_state& state, byte* block);
 
     /**
-     *@brief Retrieves the inverse modulo x^8+x^4+x^3+x+1 of the given polynomial
+     * @brief Performs SubBytes, ShiftRows, MixColumns and AddRoundKey as a single round
+     * All 16 bytes are substituted by one no_cache_lookup_state call, every output column is then gathered from the
+     * substituted words, mixed and keyed without writing any intermediate state
      *
-     *@param s: byte that represents an element in the finite field modulo x^8+x^4+x^3+x+1
-     *@return byte: the inverse polynomial of the given polynomial given in byte form
+     * @param state: Reference to the column_state being operated upon
+     * @param round_key: Pointer to the 4 words of the round key
      */
-    auto get_inverse(byte s) -> byte;
+    void fused_round(column_state& state, const word* round_key);
 
     /**
-     * @brief Implementation of the Extended Euclidean algorithm which finds r,t such that r(left)+t(right)=gcd(left,right) where gcd is the greatest common divisor
+     * @brief Performs SubBytes, ShiftRows and AddRoundKey, the last round of the cipher
      *
-     * @param left: One of the bytes whose greatest common divisor will be found. NOTE, left must be greater than right
-     * @param right: One of the bytes whose greatest common divisor will be found. NOTE, right must be less than right
-     * @param sigbit: Unsigned integer that represents the most significant bit location of left.
-     * @return array<byte,2>: Array that contains the value of r in index 0 and the value of t in index 1
+     * @param state: Reference to the column_state being operated upon
+     * @param round_key: Pointer to the 4 words of the round key
      */
-    auto extended_euclidean_algorithm(byte left, byte right, uint8_t sigbit) -> std::array<byte, 2>;
+    void fused_final_round(column_state& state, const word* round_key);
 
     /**
-     * @brief Calculates the S-Box value of the given byte
+     * @brief Performs InvShiftRows, InvSubBytes, InvMixColumns and AddRoundKey as a single round
+     * This is the round of the equivalent inverse cipher (FIPS-197 5.3.5), it expects a round key that had InvMixColumns
+     * applied, such as the middle words of KeySchedule::decryption_words
      *
-     * @param s: Byte whose S-Box value we want to find
-     * @return byte: The S-Box value associated with the given byte
+     * @param state: Reference to the column_state being operated upon
+     * @param round_key: Pointer to the 4 words of the round key
      */
-    auto get_S_BOX_value(byte s) -> byte;
+    void inv_fused_round(column_state& state, const word* round_key);
 
     /**
-     * @brief Calculates the inverse S-Box value of the given byte
+     * @brief Performs InvShiftRows, InvSubBytes and AddRoundKey, the last round of the inverse cipher
      *
-     * @param s: Byte whose inverse S-Box value we want to find
-     * @return byte: The inverse S-Box value associated with the given byte
+     * @param state: Reference to the column_state being operated upon
+     * @param round_key: Pointer to the 4 words of the round key
+     */
+    void inv_fused_final_round(column_state& state, const word* round_key);
+
+    /**
+     * @brief Performs the AES encryption of a column_state with the fused round functions
+     * @param state: Reference to the column_state being operated upon
+     * @param schedule: Reference to the expanded key
+     */
+    void encrypt_columns(column_state& state, const KeySchedule& schedule);
+
+    /**
+     * @brief Performs the AES decryption of a column_state with the fused round functions
+     * @param state: Reference to the column_state being operated upon
+     * @param schedule: Reference to the expanded key
+     */
+    void decrypt_columns(column_state& state, const KeySchedule& schedule);
+
+    /**
+     * @brief encrypt_columns specialized for a round count, with the rounds unrolled at compile time
+     * Instantiated for Nr = 10, 12 and 14, schedule.Nr must be equal to Nr
+     * @param state: Reference to the column_state being operated upon
+     * @param schedule: Reference to the expanded key
+     */
+    template <unsigned int Nr>
+    void encrypt_columns(column_state& state, const KeySchedule& schedule);
+
+    /**
+     * @brief decrypt_columns specialized for a round count, with the rounds unrolled at compile time
+     * Instantiated for Nr = 10, 12 and 14, schedule.Nr must be equal to Nr
+     * @param state: Reference to the column_state being operated upon
+     * @param schedule: Reference to the expanded key
+     */
+    template <unsigned int Nr>
+    void decrypt_columns(column_state& state, const KeySchedule& schedule);
+
+    /// Encrypts or decrypts one 16-byte block in its stored order with a schedule, in and out may be the same
+    using block_function = void (*)(const KeySchedule& schedule, const byte* in, byte* out);
+
+    /// Encrypts or decrypts block_count consecutive blocks with a schedule, in and out may be the same
+    using blocks_function = void (*)(const KeySchedule& schedule, const byte* in, byte* out, std::size_t block_count);
+
+    /// Encrypts or decrypts an aes::state with an expanded key, the form of encrypt and decrypt
+    using state_function = void (*)(unsigned int Nr, state& state, const std::vector<word>& w);
+
+    /// Encrypts or decrypts one 16-byte block in its stored order with a compact key, in and out may be the same
+    using compact_function = void (*)(const CompactKey& key, const byte* in, byte* out);
+
+    /// Encrypts or decrypts block_count consecutive blocks, block k with schedules[k], all of the same Nr; in and out may be the same
+    using multi_function = void (*)(const KeySchedule* const* schedules, const byte* in, byte* out, std::size_t block_count);
+
+    /**
+     * Describes one block cipher backend. Every engine computes the same cipher, they differ in speed, in the processor
+     * features they need and in whether their memory accesses and branches depend on the data being encrypted.
+     **/
+    struct engine {
+        const char* name;                                 // Value of the --engine option
+        const char* requirements;                         // Processor features the engine is built on
+        bool constant_time;                               // No secret-dependent table lookups or branches
+        std::size_t block_width;                          // Blocks the engine processes together in encrypt_blocks
+        auto (*supported)() -> bool;                      // Whether this processor provides the requirements
+        std::array<block_function, 3> encrypt_block;      // Indexed by (Nr - 10) / 2, rounds unrolled for that Nr
+        std::array<block_function, 3> decrypt_block;
+        blocks_function encrypt_blocks;                   // nullptr if the engine has no bulk form, encrypt_block is looped
+        blocks_function decrypt_blocks;
+        state_function encrypt_state;                     // nullptr if the engine has no state form, blocks are used
+        state_function decrypt_state;
+        compact_function encrypt_compact;                 // Round keys generated from a CompactKey as the rounds run
+        compact_function decrypt_compact;
+        std::array<multi_function, 3> encrypt_multi;      // Indexed by (Nr - 10) / 2, nullptr if encrypt_block is looped
+        std::array<multi_function, 3> decrypt_multi;
+    };
+
+    /**
+     * @brief Lists every engine built into the program, in order of preference
+     * The default engine is the first one that is supported and constant-time
+     * @return const std::vector<engine>&: The registry, which lives for the whole program
+     */
+    auto engines() -> const std::vector<engine>&;
+
+    /**
+     * @brief Looks an engine up by name
+     * @param name: Name of the engine, as listed by engines
+     * @return const engine*: The engine, or nullptr if there is none with that name
+     */
+    auto find_engine(const std::string& name) -> const engine*;
+
+    /**
+     * @brief Selects the engine used by encrypt, decrypt, the block functions and the cipher modes from now on
+     * Meant to be called before any encryption starts, schedules do not depend on the engine and stay valid
+     * @param name: Name of the engine, as listed by engines
+     * @throws aes_error: If there is no engine with that name or this processor does not support it
      */
-    auto get_inverse_S_BOX_value(byte s) -> byte;
+    void set_engine(const std::string& name);
+
+    /**
+     * @brief The engine selected by set_engine, or the default one
+     * @return const engine&: The active engine
+     */
+    auto active_engine() -> const engine&;
+
+    /**
+     * @brief Selects the block encryption routine for a schedule, so that a cipher mode dispatches once per message
+     * The routine belongs to the active engine and is specialized for schedule.Nr, with its rounds unrolled
+     * @param schedule: Reference to the expanded key the routine will be called with
+     * @return block_function: The routine, equivalent to encrypt_block for this schedule
+     */
+    auto select_encrypt_block(const KeySchedule& schedule) -> block_function;
+
+    /**
+     * @brief Selects the block decryption routine for a schedule, so that a cipher mode dispatches once per message
+     * The routine belongs to the active engine and is specialized for schedule.Nr, with its rounds unrolled
+     * @param schedule: Reference to the expanded key the routine will be called with
+     * @return block_function: The routine, equivalent to decrypt_block for this schedule
+     */
+    auto select_decrypt_block(const KeySchedule& schedule) -> block_function;
+
+    /**
+     * @brief Encrypts one 16-byte block in its stored (column-major) order, used by the cipher modes
+     * Dispatches to the active engine, the portable one runs on a column_state. in and out may be the same.
+     * @param schedule: Reference to the expanded key
+     * @param in: Pointer to the plaintext block
+     * @param out: Pointer to where the ciphertext block is written
+     */
+    void encrypt_block(const KeySchedule& schedule, const byte* in, byte* out);
+
+    /**
+     * @brief Decrypts one 16-byte block in its stored (column-major) order, used by the cipher modes
+     * Dispatches to the active engine, the portable one runs on a column_state. in and out may be the same.
+     * @param schedule: Reference to the expanded key
+     * @param in: Pointer to the ciphertext block
+     * @param out: Pointer to where the plaintext block is written
+     */
+    void decrypt_block(const KeySchedule& schedule, const byte* in, byte* out);
+
+    /**
+     * @brief Encrypts one 16-byte block in its stored (column-major) order with a compact key
+     * The active engine generates the round keys on the fly, no schedule is stored. in and out may be the same.
+     * @param key: Reference to the compact key
+     * @param in: Pointer to the plaintext block
+     * @param out: Pointer to where the ciphertext block is written
+     */
+    void encrypt_block(const CompactKey& key, const byte* in, byte* out);
+
+    /**
+     * @brief Decrypts one 16-byte block in its stored (column-major) order with a compact key
+     * The active engine generates the round keys on the fly, starting from the end of the schedule. in and out may be the same.
+     * @param key: Reference to the compact key
+     * @param in: Pointer to the ciphertext block
+     * @param out: Pointer to where the plaintext block is written
+     */
+    void decrypt_block(const CompactKey& key, const byte* in, byte* out);
+
+    /**
+     * @brief Performs the AES encryption of a state with a compact key, the round keys are generated as the rounds run
+     * @param key: Reference to the compact key
+     * @param state: Reference to AES state being operated upon
+     */
+    void encrypt(const CompactKey& key, state& state);
+
+    /**
+     * @brief Performs the AES decryption of a state with a compact key, the round keys are generated as the rounds run
+     * @param key: Reference to the compact key
+     * @param state: Reference to AES state being operated upon
+     */
+    void decrypt(const CompactKey& key, state& state);
+
+    /**
+     * @brief Encrypts consecutive independent blocks with one schedule, used by the modes whose blocks do not chain
+     * Engines with a bulk form process engine::block_width blocks together (aesni keeps aesni::PIPELINE_BLOCKS in flight so
+     * that the rounds of different blocks overlap), the others run their block routine in a loop. in and out may be the same.
+     * @param schedule: Reference to the expanded key
+     * @param in: Pointer to the plaintext blocks
+     * @param out: Pointer to where the ciphertext blocks are written
+     * @param block_count: Number of 16-byte blocks to encrypt
+     */
+    void encrypt_blocks(const KeySchedule& schedule, const byte* in, byte* out, std::size_t block_count);
+
+    /**
+     * @brief Decrypts consecutive independent blocks with one schedule, the inverse of encrypt_blocks
+     * @param schedule: Reference to the expanded key
+     * @param in: Pointer to the ciphertext blocks
+     * @param out: Pointer to where the plaintext blocks are written (may be in)
+     * @param block_count: Number of 16-byte blocks to decrypt
+     */
+    void decrypt_blocks(const KeySchedule& schedule, const byte* in, byte* out, std::size_t block_count);
+
+    /**
+     * @brief Encrypts a batch of blocks that each have their own key schedule, for workloads with few blocks per key
+     * With the aesni engine, aesni::MULTI_LANES blocks are processed at once as interleaved aesenc streams with one key per
+     * lane; other engines run their block routine on every block. Blocks are grouped by the round count of their schedules first.
+     * @param schedules: schedules[k] is the expanded key of block k, the same schedule may appear more than once
+     * @param in: Pointer to schedules.size() consecutive plaintext blocks
+     * @param out: Pointer to where the ciphertext blocks are written (may be in)
+     */
+    void encrypt_multi(const std::vector<const KeySchedule*>& schedules, const byte* in, byte* out);
+
+    /**
+     * @brief Decrypts a batch of blocks that each have their own key schedule, the inverse of encrypt_multi
+     * @param schedules: schedules[k] is the expanded key of block k, the same schedule may appear more than once
+     * @param in: Pointer to schedules.size() consecutive ciphertext blocks
+     * @param out: Pointer to where the plaintext blocks are written (may be in)
+     */
+    void decrypt_multi(const std::vector<const KeySchedule*>& schedules, const byte* in, byte* out);
+
+    /**
+     * @brief Performs the AES encryption with the portable round functions (no_cache_lookup based)
+     * This is the step-by-step reference the testbench checks the engines against, no engine dispatches to it.
+     * @param Nr: Number of rounds, which is a function of Nk and Nb
+     * @param state: Reference to AES state being operated upon
+     * @param w: Reference to the expanded key
+     */
+    void encrypt_portable(unsigned int Nr, state& state, const std::vector<word>& w);
+
+    /**
+     * @brief Performs the AES decryption with the portable round functions (no_cache_lookup based)
+     * Reference only: InvMixColumns runs on the state every round, the engines use the equivalent inverse cipher instead.
+     * @param Nr: Number of rounds, which is a function of Nk and Nb
+     * @param state: Reference to AES state being operated upon
+     * @param w: Reference to the expanded key
+     */
+    void decrypt_portable(unsigned int Nr, state& state, const std::vector<word>& w);
+    
 
     /**
      * @brief Used to print the current contents of the state, for debugging purposes
@@ -22,7 +22,21 @@ enum class Tests {
   CBC,
   ECB,
   CTR,
-  CFB
+  CFB,
+  AESNI,
+  BITSLICE,
+  VPERM,
+  COLUMN_STATE,
+  GF256,
+  MIX_COLUMNS,
+  MULTI_KEY,
+  ENGINES,
+  CALIBRATION,
+  COMPACT_KEY,
+  KEY_CACHE,
+  SPAN_MODES,
+  CALLER_BUFFERS,
+  PARALLEL_MODES
 };
 
 const std::unordered_map<Tests, std::string> tests_to_str {
@@ -34,6 +48,20 @@ const std::unordered_map<Tests, std::string> tests_to_str {
     {Tests::ECB, "ECB Accuracy"},
     {Tests::CTR, "CTR Accuracy"},
     {Tests::CFB, "CFB Accuracy"},
+    {Tests::AESNI, "AES-NI Accuracy"},
+    {Tests::BITSLICE, "Bitslice Accuracy"},
+    {Tests::VPERM, "Vperm Accuracy"},
+    {Tests::COLUMN_STATE, "Column State Accuracy"},
+    {Tests::GF256, "GF256 Accuracy"},
+    {Tests::MIX_COLUMNS, "Mix Columns Accuracy"},
+    {Tests::MULTI_KEY, "Multi Key Accuracy"},
+    {Tests::ENGINES, "Engine Accuracy"},
+    {Tests::CALIBRATION, "Engine Calibration"},
+    {Tests::COMPACT_KEY, "Compact Key Accuracy"},
+    {Tests::KEY_CACHE, "Key Cache"},
+    {Tests::SPAN_MODES, "Span Modes Accuracy"},
+    {Tests::CALLER_BUFFERS, "Caller Buffers Accuracy"},
+    {Tests::PARALLEL_MODES, "Parallel Modes Accuracy"},
 };
 
 class testbench_error : public std::runtime_error {
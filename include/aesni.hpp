@@ -0,0 +1,166 @@
+#ifndef AESNI_HPP
+#define AESNI_HPP
+
+/**
+ * Defines the hardware (AES-NI) block engine that is used in place of the portable no_cache_lookup path
+ * whenever the processor supports it.
+ *
+ * The aesenc/aesdec family performs SubBytes, ShiftRows, MixColumns and AddRoundKey inside the execution units,
+ * so no lookup table is ever touched and the runtime is independent of both the key and the data.
+ **/
+
+#include "aes.hpp"
+
+namespace aesni {
+    constexpr const std::size_t MULTI_LANES = 8; // blocks encrypt_multi keeps in flight, enough to cover the latency of aesenc
+    constexpr const std::size_t PIPELINE_BLOCKS = 8; // blocks encrypt_blocks keeps in flight, the tail goes 4 and then 1 at a time
+
+    /**
+     * @brief Queries CPUID for the AES-NI and SSSE3 extensions required by this engine
+     * The query is only performed once, the result is cached for the remainder of the process
+     *
+     * @return bool: true if the hardware engine can be used on this processor
+     */
+    auto supported() -> bool;
+
+    /**
+     * @brief Performs the AES encryption using the aesenc/aesenclast instructions
+     * @param Nr: Number of rounds, which is a function of Nk and Nb
+     * @param state: Reference to AES state being operated upon
+     * @param w: Reference to the expanded key
+     */
+    void encrypt(unsigned int Nr, aes::state& state, const std::vector<aes::word>& w);
+
+    /**
+     * @brief Performs the AES decryption using the aesdec/aesdeclast instructions
+     * @param Nr: Number of rounds, which is a function of Nk and Nb
+     * @param state: Reference to AES state being operated upon
+     * @param w: Reference to the expanded key
+     */
+    void decrypt(unsigned int Nr, aes::state& state, const std::vector<aes::word>& w);
+
+    /**
+     * @brief Performs the AES key expansion with aeskeygenassist, producing the same words as aes::key_expansion
+     * @param key_bytes: Pointer to the 16, 24 or 32 bytes of the cipher key
+     * @param Nk: Number of 32-bit words comprising the Cipher Key
+     * @param w: Pointer to the aes::NB*(Nk+7) words of the expanded key
+     */
+    void key_expansion(const aes::byte* key_bytes, unsigned int Nk, aes::word* w);
+
+    /**
+     * @brief Encrypts one block with a compact key, each aeskeygenassist step feeding the aesenc that uses its round key
+     * @param key: Reference to the compact key
+     * @param in: Pointer to the plaintext block
+     * @param out: Pointer to where the ciphertext block is written (may be in)
+     */
+    void encrypt_compact(const aes::CompactKey& key, const aes::byte* in, aes::byte* out);
+
+    /**
+     * @brief Decrypts one block with a compact key, running the key expansion recurrence backwards from last_key as the
+     * rounds consume the keys, with aesimc applied to each middle round key on the way
+     * @param key: Reference to the compact key
+     * @param in: Pointer to the ciphertext block
+     * @param out: Pointer to where the plaintext block is written (may be in)
+     */
+    void decrypt_compact(const aes::CompactKey& key, const aes::byte* in, aes::byte* out);
+
+    /**
+     * @brief Encrypts one 16-byte block in its stored (column-major) order, without going through aes::state
+     * @param schedule: Reference to the expanded key, whose aligned round key blocks are loaded directly
+     * @param in: Pointer to the plaintext block
+     * @param out: Pointer to where the ciphertext block is written (may be in)
+     */
+    void encrypt_block(const aes::KeySchedule& schedule, const aes::byte* in, aes::byte* out);
+
+    /**
+     * @brief Decrypts one 16-byte block in its stored (column-major) order, without going through aes::state
+     * @param schedule: Reference to the expanded key, whose aligned round key blocks are loaded directly
+     * @param in: Pointer to the ciphertext block
+     * @param out: Pointer to where the plaintext block is written (may be in)
+     */
+    void decrypt_block(const aes::KeySchedule& schedule, const aes::byte* in, aes::byte* out);
+
+    /**
+     * @brief encrypt_block specialized for a round count, with the rounds unrolled at compile time
+     * Instantiated for Nr = 10, 12 and 14, schedule.Nr must be equal to Nr
+     * @param schedule: Reference to the expanded key, whose aligned round key blocks are loaded directly
+     * @param in: Pointer to the plaintext block
+     * @param out: Pointer to where the ciphertext block is written (may be in)
+     */
+    template <unsigned int Nr>
+    void encrypt_block(const aes::KeySchedule& schedule, const aes::byte* in, aes::byte* out);
+
+    /**
+     * @brief decrypt_block specialized for a round count, with the rounds unrolled at compile time
+     * Instantiated for Nr = 10, 12 and 14, schedule.Nr must be equal to Nr
+     * @param schedule: Reference to the expanded key, whose aligned round key blocks are loaded directly
+     * @param in: Pointer to the ciphertext block
+     * @param out: Pointer to where the plaintext block is written (may be in)
+     */
+    template <unsigned int Nr>
+    void decrypt_block(const aes::KeySchedule& schedule, const aes::byte* in, aes::byte* out);
+
+    /**
+     * @brief Encrypts consecutive blocks with one key, interleaving the rounds of PIPELINE_BLOCKS independent blocks
+     * Instantiated for Nr = 10, 12 and 14, schedule.Nr must be equal to Nr. The input and output buffers may be the same.
+     * @param schedule: Reference to the expanded key, whose aligned round key blocks are loaded directly
+     * @param in: Pointer to the plaintext blocks
+     * @param out: Pointer to where the ciphertext blocks are written
+     * @param block_count: Number of 16-byte blocks to encrypt
+     */
+    template <unsigned int Nr>
+    void encrypt_blocks(const aes::KeySchedule& schedule, const aes::byte* in, aes::byte* out, std::size_t block_count);
+
+    /**
+     * @brief Decrypts consecutive blocks with one key, interleaving the rounds of PIPELINE_BLOCKS independent blocks
+     * Instantiated for Nr = 10, 12 and 14, schedule.Nr must be equal to Nr. The input and output buffers may be the same.
+     * @param schedule: Reference to the expanded key, whose aligned round key blocks are loaded directly
+     * @param in: Pointer to the ciphertext blocks
+     * @param out: Pointer to where the plaintext blocks are written
+     * @param block_count: Number of 16-byte blocks to decrypt
+     */
+    template <unsigned int Nr>
+    void decrypt_blocks(const aes::KeySchedule& schedule, const aes::byte* in, aes::byte* out, std::size_t block_count);
+
+    /**
+     * @brief encrypt_blocks for the round count of the schedule
+     * @param schedule: Reference to the expanded key
+     * @param in: Pointer to the plaintext blocks
+     * @param out: Pointer to where the ciphertext blocks are written (may be in)
+     * @param block_count: Number of 16-byte blocks to encrypt
+     */
+    void encrypt_blocks(const aes::KeySchedule& schedule, const aes::byte* in, aes::byte* out, std::size_t block_count);
+
+    /**
+     * @brief decrypt_blocks for the round count of the schedule
+     * @param schedule: Reference to the expanded key
+     * @param in: Pointer to the ciphertext blocks
+     * @param out: Pointer to where the plaintext blocks are written (may be in)
+     * @param block_count: Number of 16-byte blocks to decrypt
+     */
+    void decrypt_blocks(const aes::KeySchedule& schedule, const aes::byte* in, aes::byte* out, std::size_t block_count);
+
+    /**
+     * @brief Encrypts consecutive blocks that each have their own key, interleaving the rounds of MULTI_LANES blocks
+     * Instantiated for Nr = 10, 12 and 14. The input and output buffers may be the same.
+     * @param schedules: Pointer to block_count schedules, schedules[k] is the key of block k; all must have Nr rounds
+     * @param in: Pointer to the plaintext blocks
+     * @param out: Pointer to where the ciphertext blocks are written
+     * @param block_count: Number of 16-byte blocks to encrypt
+     */
+    template <unsigned int Nr>
+    void encrypt_multi(const aes::KeySchedule* const* schedules, const aes::byte* in, aes::byte* out, std::size_t block_count);
+
+    /**
+     * @brief Decrypts consecutive blocks that each have their own key, interleaving the rounds of MULTI_LANES blocks
+     * Instantiated for Nr = 10, 12 and 14. The input and output buffers may be the same.
+     * @param schedules: Pointer to block_count schedules, schedules[k] is the key of block k; all must have Nr rounds
+     * @param in: Pointer to the ciphertext blocks
+     * @param out: Pointer to where the plaintext blocks are written
+     * @param block_count: Number of 16-byte blocks to decrypt
+     */
+    template <unsigned int Nr>
+    void decrypt_multi(const aes::KeySchedule* const* schedules, const aes::byte* in, aes::byte* out, std::size_t block_count);
+} // end of namespace aesni
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef AVX2_HPP
+#define AVX2_HPP
+
+/**
+ * Defines the AVX2 kernels, which process two AES states at once: one in each 128-bit half of a ymm register.
+ * This translation unit is compiled with -mavx2, its functions must only be called once supported() returned true.
+ **/
+
+#include "aes.hpp"
+
+namespace avx2 {
+    /**
+     * @brief Queries CPUID for AVX2, and XGETBV for operating system support of the ymm registers
+     * The query is only performed once, the result is cached for the remainder of the process
+     *
+     * @return bool: true if the AVX2 kernels can be used on this processor
+     */
+    auto supported() -> bool;
+
+    /**
+     * @brief Performs the mix columns AES operation on two states at once
+     *
+     * @param first: reference to the first AES state being operated upon
+     * @param second: reference to the second AES state being operated upon
+     */
+    void mix_columns(aes::state& first, aes::state& second);
+
+    /**
+     * @brief Performs the inverse mix columns AES operation on two states at once
+     *
+     * @param first: reference to the first AES state being operated upon
+     * @param second: reference to the second AES state being operated upon
+     */
+    void inv_mix_columns(aes::state& first, aes::state& second);
+} // end of namespace avx2
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef BITSLICE_HPP
+#define BITSLICE_HPP
+
+/**
+ * Defines the bitsliced multi-block AES engine.
+ *
+ * Eight independent blocks are transposed so that every 32-bit word holds one bit position of one state row for all
+ * of them (bit 8*c + k is column c of block k). The S-box is evaluated with the Boyar-Peralta boolean circuit, while
+ * ShiftRows and MixColumns reduce to word rotations and XORs, so no lookup table is ever indexed by secret data.
+ * It is the batch-oriented constant-time engine: a single block costs as much as a full batch of eight.
+ **/
+
+#include "aes.hpp"
+
+namespace bitslice {
+    constexpr const std::size_t BLOCKS_PER_BATCH = 8; // One bit of every 32-bit slice word per block and column
+
+    /// Bitsliced representation of BLOCKS_PER_BATCH states, indexed as [row][bit]
+    using bitsliced_state = std::array<std::array<uint32_t, 8>, aes::NB>;
+
+    /**
+     * @brief Transposes up to BLOCKS_PER_BATCH consecutive 16-byte blocks into the bitsliced representation
+     *
+     * @param blocks: Pointer to the first byte of the blocks
+     * @param block_count: Number of blocks to load, the remaining lanes are zero
+     */
+    auto pack(const aes::byte* blocks, std::size_t block_count) -> bitsliced_state;
+
+    /**
+     * @brief Transposes the bitsliced representation back into consecutive 16-byte blocks
+     *
+     * @param state: Bitsliced state to unpack
+     * @param blocks: Pointer to the output blocks
+     * @param block_count: Number of blocks to store
+     */
+    void unpack(const bitsliced_state& state, aes::byte* blocks, std::size_t block_count);
+
+    /**
+     * @brief Boyar-Peralta circuit for the AES S-box applied to 32 bytes in parallel
+     *
+     * @param slice: The 8 bit-planes of the bytes being substituted (slice[0] holds the least significant bits)
+     */
+    void sbox(std::array<uint32_t, 8>& slice);
+
+    /**
+     * @brief Inverse S-box, computed as the forward circuit surrounded by the inverse affine transformation
+     *
+     * @param slice: The 8 bit-planes of the bytes being substituted (slice[0] holds the least significant bits)
+     */
+    void inv_sbox(std::array<uint32_t, 8>& slice);
+
+    /**
+     * @brief Encrypts consecutive blocks, BLOCKS_PER_BATCH at a time
+     * The input and output buffers may be the same.
+     *
+     * @param schedule: Reference to the expanded key
+     * @param in: Pointer to the plaintext blocks
+     * @param out: Pointer to where the ciphertext blocks are written
+     * @param block_count: Number of 16-byte blocks to encrypt
+     */
+    void encrypt_blocks(const aes::KeySchedule& schedule, const aes::byte* in, aes::byte* out, std::size_t block_count);
+
+    /**
+     * @brief Decrypts consecutive blocks, BLOCKS_PER_BATCH at a time
+     * The input and output buffers may be the same.
+     *
+     * @param schedule: Reference to the expanded key
+     * @param in: Pointer to the ciphertext blocks
+     * @param out: Pointer to where the plaintext blocks are written
+     * @param block_count: Number of 16-byte blocks to decrypt
+     */
+    void decrypt_blocks(const aes::KeySchedule& schedule, const aes::byte* in, aes::byte* out, std::size_t block_count);
+} // end of namespace bitslice
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef CALIBRATION_HPP
+#define CALIBRATION_HPP
+
+/**
+ * Defines the startup calibration that picks the fastest engine for the host.
+ *
+ * Which engine wins depends on more than the CPUID feature bits (the latency of pshufb and aesenc, the width of the
+ * execution ports), so every candidate engine is timed on a few hundred blocks and the fastest one is activated. The
+ * decision is stored per CPU model in a small text file, one "<cpu model>\t<ct|any>\t<engine>" line per entry, so a
+ * host only pays for the measurement the first time it runs a given binary.
+ **/
+
+#include "aes.hpp"
+#include <string>
+
+namespace calibration {
+    constexpr const std::size_t CALIBRATION_BLOCKS = 256; // blocks timed per run, enough to fill every engine's batches
+    constexpr const unsigned int CALIBRATION_RUNS = 5;    // the best run is kept, the others absorb interrupts and cache misses
+    constexpr const char* CACHE_FILE_NAME = ".aes_exec_engines";
+
+    /**
+     * @brief Identifies the processor by its CPUID brand string, falling back to the vendor and signature
+     * The result is cached for the remainder of the process
+     *
+     * @return const std::string&: CPU model, e.g. "Intel(R) Xeon(R) Platinum 8375C CPU @ 2.90GHz"
+     */
+    auto cpu_model() -> const std::string&;
+
+    /**
+     * @brief Default location of the calibration cache: $AES_ENGINE_CACHE if set, else ~/.aes_exec_engines,
+     * else .aes_exec_engines in the working directory
+     *
+     * @return std::string: Path of the cache file
+     */
+    auto cache_path() -> std::string;
+
+    /**
+     * @brief Times one engine on CALIBRATION_BLOCKS blocks of encryption and decryption with a 256-bit key
+     * The active engine is left unchanged
+     *
+     * @param engine: Engine being measured, must be supported by this processor
+     * @return double: Best time over CALIBRATION_RUNS runs, in nanoseconds per block
+     */
+    auto measure(const aes::engine& engine) -> double;
+
+    /**
+     * @brief Measures every supported engine and returns the fastest one, without activating it
+     *
+     * @param require_constant_time: Only consider the constant-time engines
+     * @return const aes::engine&: The fastest eligible engine
+     */
+    auto calibrate(bool require_constant_time) -> const aes::engine&;
+
+    /**
+     * @brief Activates the engine recorded for this CPU model in the cache file, calibrating and recording one first
+     * if there is no usable entry. An unreadable or unwritable cache file only means the calibration is repeated
+     *
+     * @param cache_file: Path of the cache file
+     * @param require_constant_time: Only consider the constant-time engines
+     * @param recalibrate: Ignore the recorded entry and measure again
+     * @return const aes::engine&: The engine that is now active
+     */
+    auto select_engine(const std::string& cache_file, bool require_constant_time, bool recalibrate = false) -> const aes::engine&;
+} // end of namespace calibration
+
+#endif
@@ -3,11 +3,49 @@
 
 /**
  * Defines functionality and data-types required for the implementation of cipher modes of operation
+ * The overloads taking key_bytes look the expanded key up in keycache, so a key used repeatedly is only expanded once
+ * Every mode reads its input through an aes::span and writes the output vector once, at its final size
+ *
+ * Every mode also has an overload writing into a caller-owned buffer, which allocates nothing, and a pair of functions giving
+ * the output size for an input length so the buffer can be sized (or taken from a pool) beforehand. The output may be the
+ * input buffer itself: an encryption reads the plaintext from the start of out and shifts it behind the IV or nonce, a
+ * decryption leaves the plaintext at the start of the ciphertext. Otherwise the two buffers must not overlap.
+ *
+ * Modes whose blocks do not depend on each other (ECB, CTR, and the decryption of CBC and CFB) split large messages into
+ * contiguous ranges of blocks, one per worker thread, and each thread writes its range of the output directly. The output
+ * is byte-identical to the serial one.
  **/
 
 #include "aes.hpp"
 
 namespace ciphermodes {
+    constexpr const std::size_t PARALLEL_MIN_BLOCKS = 16384; // 256 KB, the least a worker thread is given: starting one costs ~20 us
+
+    /**
+     * @brief Sets the number of threads a parallel mode may split a message over, 1 keeps every mode on the calling thread
+     *
+     * @param threads: Maximum number of threads, including the calling one. 0 restores the default, one per hardware thread
+     */
+    void set_thread_count(unsigned int threads);
+
+    /**
+     * @brief Number of threads a parallel mode may split a message over
+     */
+    auto thread_count() -> unsigned int;
+
+    /**
+     * @brief Sets the least number of blocks a worker thread is given, so a message needs twice as many to be split at all.
+     * Smaller values spread medium-sized messages over more threads at the cost of starting them
+     *
+     * @param blocks: Blocks per thread, 0 restores PARALLEL_MIN_BLOCKS
+     */
+    void set_chunk_blocks(std::size_t blocks);
+
+    /**
+     * @brief Least number of blocks a worker thread is given
+     */
+    auto chunk_blocks() -> std::size_t;
+
      /**
      * @brief Pads plaintext according to PKCS #7 [Add hex representation of b repeated b times]
      * 
@@ -18,17 +56,17 @@ namespace ciphermodes {
      /**
      * @brief Unpads plaintext according to PKCS #7 [Add hex representation of b repeated b times]
      * 
-     * @param ciphertext_bytes: Vector containing the bytes of the ciphertext
+     * @param ciphertext_bytes: Contiguous bytes of the ciphertext
      */
     void unpad_ciphertext(std::vector<aes::byte>& ciphertext_bytes);
 
      /**
-     * @brief Helper function to xor 2 blocks
+     * @brief Helper function to xor a block into another, in place
      * 
-     * @param block1: first 128 bit block to XOR
-     * @param block2: second 128 bit block to XOR
+     * @param target: bytes that are xored with source, only the bytes both spans have are changed
+     * @param source: bytes xored into target
      */
-    auto xor_blocks(std::vector<aes::byte> block1,std::vector<aes::byte> block2) -> std::vector<aes::byte>;
+    void xor_blocks(aes::span<aes::byte> target, aes::span<const aes::byte> source);
     
     /**
      * @brief Helper function to print the content of a block
@@ -38,28 +76,11 @@ namespace ciphermodes {
     void print_blocks(std::vector<aes::byte> vec);
 
     /**
-     * @brief Populate vector of blocks;
-     * A new block is created every 128 bits, it is possible that the final block is not a complete 128 bits since
-     * not all modes of operation require padding
-     * 
-     * @param plaintext_blocks: Vector of Vectors where each subvector contains 128 bits from the plaintext/padding
-     * @param plaintext_bytes: Vector containing the bytes of the plaintext
-     */
-    auto create_blocks(std::vector<aes::byte> plaintext_bytes) -> std::vector<std::vector<aes::byte> >;
-
-    /**
-     * @brief Merge vector of blocks into a single vector of bytes;
-     * 
-     * @param ciphertext_blocks: Vector of Vectors where each subvector contains 128 bits from the ciphertext
-     */
-    auto merge_blocks(const std::vector<std::vector<aes::byte>>& ciphertext_blocks) -> std::vector<aes::byte>;
-
-    /**
-     * @brief Converts a block (byte vector) into as AES State (4x4 array)
+     * @brief Converts a block (16 contiguous bytes) into as AES State (4x4 array)
      * 
      * @param block: desired block to convert into an AES state
      */
-    auto convert_block_to_state(std::vector<aes::byte> block) -> aes::state;
+    auto convert_block_to_state(aes::span<const aes::byte> block) -> aes::state;
 
     
     template <std::size_t BIT_SIZE>
@@ -83,122 +104,363 @@ namespace ciphermodes {
 
     
     /**
-     * @brief Merges the IV bytes and the blocks of the ciphertext into a single vector of bytes with the IV bytes in the front
-     *
-     * @param IV: array containing the random bytes of the IV
-     * @param ciphertext_blocks: vector of blocks containing the ciphertext after encryption
-     */
-    template <int SIZE>
-	auto merge_IV_blocks(const std::array<aes::byte,SIZE>& IV, const std::vector<std::vector<aes::byte>>& ciphertext_blocks) -> std::vector<aes::byte>{
-        	std:: vector<aes::byte> ciphertext_bytes;
-          std::size_t merge_size = sizeof(aes::byte) * (IV.size() + (ciphertext_blocks.size() * ciphertext_blocks[0].size()));
-          ciphertext_bytes.reserve(merge_size);
-        	for(auto byte : IV){
-                	ciphertext_bytes.push_back(byte);
-        	}
-        	for(const auto& block: ciphertext_blocks){
-                	for(auto byte : block){
-                        	ciphertext_bytes.push_back(byte);
-                	}
-        	}
-		return ciphertext_bytes;
-	}
-    
-    /**
-     * @brief Creates merges a nonce with a counter to create the state that will be encrypted with AES for CTR Mode
+     * @brief Creates merges a nonce with a counter to create the block that will be encrypted with AES for CTR Mode
      *
      * @param nonce: 96 bit random nonce 
-     * @param counter: counter that is increased with number of blocks being encrypted
+     * @param counter: counter that is increased with number of blocks being encrypted, stored big-endian after the nonce
      */
-    auto create_CTR(std::array<aes::byte,12> nonce, aes::word counter)->aes::state;
+    auto create_CTR(const std::array<aes::byte,12>& nonce, aes::word counter)->aes::block;
 
     
     /**
-     * @brief Extracts the 96bit nonce from the ciphertext and separates the remaining bytes into blocks of length 128 bits
-     *
-     * @param ciphertext_bytes: the ciphertext being decrypted
+     * @brief Electronic Codebook Encryption;
+     * 
+     * @param plaintext_bytes: Contiguous bytes of the plaintext (a vector, an array or a span of a larger buffer)
+     * @param key_bytes: Vector containing the bytes of the key
      */
-    auto create_nonce_blocks(std::vector<aes::byte> ciphertext_bytes) ->aes::Tuple<std::array<aes::byte, 12>, std::vector<std::vector<aes::byte>>>;
+    auto ECB_Encrypt(aes::span<const aes::byte> plaintext_bytes, const std::vector<aes::byte>& key_bytes) -> std::vector<aes::byte>;
 
     /**
      * @brief Electronic Codebook Encryption;
-     * 
-     * @param plaintext_bytes: Vector containing the bytes of the plaintext
-     * @param key_bytes: Vector containing the bytes of the key
+     * Overload for callers that process several messages with one key, the key is only expanded once
+     *
+     * @param plaintext_bytes: Contiguous bytes of the plaintext (a vector, an array or a span of a larger buffer)
+     * @param schedule: Expanded key
      */
-    auto ECB_Encrypt(std::vector<aes::byte> plaintext_bytes, const std::vector<aes::byte>& key_bytes) -> std::vector<aes::byte>;
+    auto ECB_Encrypt(aes::span<const aes::byte> plaintext_bytes, const aes::KeySchedule& schedule) -> std::vector<aes::byte>;
 
     /**
      * @brief Electronic Codebook Decryption;
      * 
-     * @param ciphertext_bytes: Vector containing the bytes of the plaintext
+     * @param ciphertext_bytes: Contiguous bytes of the ciphertext
      * @param key_bytes: Vector containing the bytes of the key
      */
-    auto ECB_Decrypt(std::vector<aes::byte> ciphertext_bytes, const std::vector<aes::byte>& key_bytes) -> std::vector<aes::byte>;
+    auto ECB_Decrypt(aes::span<const aes::byte> ciphertext_bytes, const std::vector<aes::byte>& key_bytes) -> std::vector<aes::byte>;
+
+    /**
+     * @brief Electronic Codebook Decryption;
+     * Overload for callers that process several messages with one key, the key is only expanded once
+     *
+     * @param ciphertext_bytes: Contiguous bytes of the ciphertext
+     * @param schedule: Expanded key
+     */
+    auto ECB_Decrypt(aes::span<const aes::byte> ciphertext_bytes, const aes::KeySchedule& schedule) -> std::vector<aes::byte>;
 
     /**
      * @brief Counter Mode Encryption;
      *
-     * @param plaintext_bytes: Vector containing the bytes of the plaintext
+     * @param plaintext_bytes: Contiguous bytes of the plaintext (a vector, an array or a span of a larger buffer)
      * @param key_bytes: Vector containing the bytes of the key
      */
-    auto CTR_Encrypt(std::vector<aes::byte> plaintext_bytes, const std::vector<aes::byte>& key_bytes) -> std::vector<aes::byte>;
+    auto CTR_Encrypt(aes::span<const aes::byte> plaintext_bytes, const std::vector<aes::byte>& key_bytes) -> std::vector<aes::byte>;
+
+    /**
+     * @brief Counter Mode Encryption;
+     * Overload for callers that process several messages with one key, the key is only expanded once
+     *
+     * @param plaintext_bytes: Contiguous bytes of the plaintext (a vector, an array or a span of a larger buffer)
+     * @param schedule: Expanded key
+     */
+    auto CTR_Encrypt(aes::span<const aes::byte> plaintext_bytes, const aes::KeySchedule& schedule) -> std::vector<aes::byte>;
     
     /**
      * @brief Counter Mode Decryption;
      *
-     * @param ciphertext_bytes: Vector containing the bytes of the ciphertext
+     * @param ciphertext_bytes: Contiguous bytes of the ciphertext
      * @param key_bytes: Vector containing the bytes of the key
      */
-    auto CTR_Decrypt(std::vector<aes::byte> ciphertext_bytes, const std::vector<aes::byte>& key_bytes) -> std::vector<aes::byte>;
+    auto CTR_Decrypt(aes::span<const aes::byte> ciphertext_bytes, const std::vector<aes::byte>& key_bytes) -> std::vector<aes::byte>;
+
+    /**
+     * @brief Counter Mode Decryption;
+     * Overload for callers that process several messages with one key, the key is only expanded once
+     *
+     * @param ciphertext_bytes: Contiguous bytes of the ciphertext
+     * @param schedule: Expanded key
+     */
+    auto CTR_Decrypt(aes::span<const aes::byte> ciphertext_bytes, const aes::KeySchedule& schedule) -> std::vector<aes::byte>;
 
     /**
      * @brief Cipher Block Chaining Mode Encryption;
      *
-     * @param plaintext_bytes: Vector containing the bytes of the plaintext
+     * @param plaintext_bytes: Contiguous bytes of the plaintext (a vector, an array or a span of a larger buffer)
      * @param key_bytes: Vector containing the bytes of the key
      */
-    auto CBC_Encrypt(std::vector<aes::byte> plaintext_bytes, const std::vector<aes::byte>& key_bytes) ->std::vector<aes::byte>;
+    auto CBC_Encrypt(aes::span<const aes::byte> plaintext_bytes, const std::vector<aes::byte>& key_bytes) ->std::vector<aes::byte>;
+
+    /**
+     * @brief Cipher Block Chaining Mode Encryption;
+     * Overload for callers that process several messages with one key, the key is only expanded once
+     *
+     * @param plaintext_bytes: Contiguous bytes of the plaintext (a vector, an array or a span of a larger buffer)
+     * @param schedule: Expanded key
+     */
+    auto CBC_Encrypt(aes::span<const aes::byte> plaintext_bytes, const aes::KeySchedule& schedule) -> std::vector<aes::byte>;
 
     /**
      * @brief Cipher Block Mode Decryption;
      *
-     * @param ciphertext_bytes: Vector containing the bytes of the ciphertext
+     * @param ciphertext_bytes: Contiguous bytes of the ciphertext
      * @param key_bytes: Vector containing the bytes of the key
      */
-    auto CBC_Decrypt(std::vector<aes::byte> ciphertext_bytes, const std::vector<aes::byte>& key_bytes) -> std::vector<aes::byte>;
+    auto CBC_Decrypt(aes::span<const aes::byte> ciphertext_bytes, const std::vector<aes::byte>& key_bytes) -> std::vector<aes::byte>;
+
+    /**
+     * @brief Cipher Block Mode Decryption;
+     * Overload for callers that process several messages with one key, the key is only expanded once
+     *
+     * @param ciphertext_bytes: Contiguous bytes of the ciphertext
+     * @param schedule: Expanded key
+     */
+    auto CBC_Decrypt(aes::span<const aes::byte> ciphertext_bytes, const aes::KeySchedule& schedule) -> std::vector<aes::byte>;
 
     /**
      * @brief Cipher Feedback Mode Encryption;
      *
-     * @param plaintext_bytes: Vector containing the bytes of the plaintext
+     * @param plaintext_bytes: Contiguous bytes of the plaintext (a vector, an array or a span of a larger buffer)
      * @param key_bytes: Vector containing the bytes of the key
      */
-    auto CFB_Encrypt(std::vector<aes::byte> plaintext_bytes, const std::vector<aes::byte>& key_bytes) -> std::vector<aes::byte>;
+    auto CFB_Encrypt(aes::span<const aes::byte> plaintext_bytes, const std::vector<aes::byte>& key_bytes) -> std::vector<aes::byte>;
+
+    /**
+     * @brief Cipher Feedback Mode Encryption;
+     * Overload for callers that process several messages with one key, the key is only expanded once
+     *
+     * @param plaintext_bytes: Contiguous bytes of the plaintext (a vector, an array or a span of a larger buffer)
+     * @param schedule: Expanded key
+     */
+    auto CFB_Encrypt(aes::span<const aes::byte> plaintext_bytes, const aes::KeySchedule& schedule) -> std::vector<aes::byte>;
     
     /**
      * @brief Cipher Feedback Mode Decryption;
      *
-     * @param ciphertext_bytes: Vector containing the bytes of the ciphertext
+     * @param ciphertext_bytes: Contiguous bytes of the ciphertext
      * @param key_bytes: Vector containing the bytes of the key
      */
-    auto CFB_Decrypt(std::vector<aes::byte> ciphertext_bytes, const std::vector<aes::byte>& key_bytes) -> std::vector<aes::byte>;
+    auto CFB_Decrypt(aes::span<const aes::byte> ciphertext_bytes, const std::vector<aes::byte>& key_bytes) -> std::vector<aes::byte>;
+
+    /**
+     * @brief Cipher Feedback Mode Decryption;
+     * Overload for callers that process several messages with one key, the key is only expanded once
+     *
+     * @param ciphertext_bytes: Contiguous bytes of the ciphertext
+     * @param schedule: Expanded key
+     */
+    auto CFB_Decrypt(aes::span<const aes::byte> ciphertext_bytes, const aes::KeySchedule& schedule) -> std::vector<aes::byte>;
 
     /**
      * @brief Outback Feedback Mode Encryption;
      *
-     * @param plaintext_bytes: Vector containing the bytes of the plaintext
+     * @param plaintext_bytes: Contiguous bytes of the plaintext (a vector, an array or a span of a larger buffer)
      * @param key_bytes: Vector containing the bytes of the key
      */
-    auto OFM_Encrypt(const std::vector<aes::byte>& plaintext_bytes, const std::vector<aes::byte>& key_bytes) -> std::vector<aes::byte>;
+    auto OFM_Encrypt(aes::span<const aes::byte> plaintext_bytes, const std::vector<aes::byte>& key_bytes) -> std::vector<aes::byte>;
+
+    /**
+     * @brief Outback Feedback Mode Encryption;
+     * Overload for callers that process several messages with one key, the key is only expanded once
+     *
+     * @param plaintext_bytes: Contiguous bytes of the plaintext (a vector, an array or a span of a larger buffer)
+     * @param schedule: Expanded key
+     */
+    auto OFM_Encrypt(aes::span<const aes::byte> plaintext_bytes, const aes::KeySchedule& schedule) -> std::vector<aes::byte>;
 
     /**
      * @brief Outback Feedback Mode Decryption;
      *
-     * @param ciphertext_bytes: Vector containing the bytes of the ciphertext
+     * @param ciphertext_bytes: Contiguous bytes of the ciphertext
      * @param key_bytes: Vector containing the bytes of the key
      */
-    auto OFM_Decrypt(const std::vector<aes::byte>& ciphertext_bytes, const std::vector<aes::byte>& key_bytes) -> std::vector<aes::byte>;
+    auto OFM_Decrypt(aes::span<const aes::byte> ciphertext_bytes, const std::vector<aes::byte>& key_bytes) -> std::vector<aes::byte>;
+
+    /**
+     * @brief Outback Feedback Mode Decryption;
+     * Overload for callers that process several messages with one key, the key is only expanded once
+     *
+     * @param ciphertext_bytes: Contiguous bytes of the ciphertext
+     * @param schedule: Expanded key
+     */
+    auto OFM_Decrypt(aes::span<const aes::byte> ciphertext_bytes, const aes::KeySchedule& schedule) -> std::vector<aes::byte>;
+
+    /**
+     * @brief Size of the ECB ciphertext of a plaintext: the plaintext padded to a whole number of blocks, always at least one byte longer
+     *
+     * @param plaintext_length: Length of the plaintext in bytes
+     */
+    auto ECB_Encrypted_size(std::size_t plaintext_length) -> std::size_t;
+
+    /**
+     * @brief Largest ECB plaintext a ciphertext can decrypt to: the ciphertext length, the padding is only known once it has been decrypted
+     *
+     * @param ciphertext_length: Length of the ciphertext in bytes
+     */
+    auto ECB_Decrypted_size(std::size_t ciphertext_length) -> std::size_t;
+
+    /**
+     * @brief Electronic Codebook Encryption into a caller-owned buffer;
+     *
+     * @param plaintext_bytes: Contiguous bytes of the plaintext, or the start of ciphertext_out to encrypt in place
+     * @param ciphertext_out: Buffer of at least ECB_Encrypted_size(plaintext_bytes.size()) bytes
+     * @param schedule: Expanded key
+     * @return std::size_t: Number of bytes written to ciphertext_out
+     * @throws aes_error: If ciphertext_out is too small
+     */
+    auto ECB_Encrypt(aes::span<const aes::byte> plaintext_bytes, aes::span<aes::byte> ciphertext_out, const aes::KeySchedule& schedule) -> std::size_t;
+
+    /**
+     * @brief Electronic Codebook Decryption into a caller-owned buffer;
+     *
+     * @param ciphertext_bytes: Contiguous bytes of the ciphertext, may start at plaintext_out to decrypt in place
+     * @param plaintext_out: Buffer of at least ECB_Decrypted_size(ciphertext_bytes.size()) bytes
+     * @param schedule: Expanded key
+     * @return std::size_t: Length of the plaintext written to the start of plaintext_out
+     * @throws aes_error: If plaintext_out is too small or the ciphertext is malformed
+     */
+    auto ECB_Decrypt(aes::span<const aes::byte> ciphertext_bytes, aes::span<aes::byte> plaintext_out, const aes::KeySchedule& schedule) -> std::size_t;
+
+    /**
+     * @brief Size of the CTR ciphertext of a plaintext: the 12-byte nonce followed by the plaintext length
+     *
+     * @param plaintext_length: Length of the plaintext in bytes
+     */
+    auto CTR_Encrypted_size(std::size_t plaintext_length) -> std::size_t;
+
+    /**
+     * @brief Largest CTR plaintext a ciphertext can decrypt to: the ciphertext length less the 12-byte nonce
+     *
+     * @param ciphertext_length: Length of the ciphertext in bytes
+     */
+    auto CTR_Decrypted_size(std::size_t ciphertext_length) -> std::size_t;
+
+    /**
+     * @brief Counter Mode Encryption into a caller-owned buffer;
+     *
+     * @param plaintext_bytes: Contiguous bytes of the plaintext, or the start of ciphertext_out to encrypt in place
+     * @param ciphertext_out: Buffer of at least CTR_Encrypted_size(plaintext_bytes.size()) bytes
+     * @param schedule: Expanded key
+     * @return std::size_t: Number of bytes written to ciphertext_out
+     * @throws aes_error: If ciphertext_out is too small
+     */
+    auto CTR_Encrypt(aes::span<const aes::byte> plaintext_bytes, aes::span<aes::byte> ciphertext_out, const aes::KeySchedule& schedule) -> std::size_t;
+
+    /**
+     * @brief Counter Mode Decryption into a caller-owned buffer;
+     *
+     * @param ciphertext_bytes: Contiguous bytes of the ciphertext, may start at plaintext_out to decrypt in place
+     * @param plaintext_out: Buffer of at least CTR_Decrypted_size(ciphertext_bytes.size()) bytes
+     * @param schedule: Expanded key
+     * @return std::size_t: Length of the plaintext written to the start of plaintext_out
+     * @throws aes_error: If plaintext_out is too small or the ciphertext is malformed
+     */
+    auto CTR_Decrypt(aes::span<const aes::byte> ciphertext_bytes, aes::span<aes::byte> plaintext_out, const aes::KeySchedule& schedule) -> std::size_t;
+
+    /**
+     * @brief Size of the CBC ciphertext of a plaintext: the 16-byte IV followed by the padded plaintext
+     *
+     * @param plaintext_length: Length of the plaintext in bytes
+     */
+    auto CBC_Encrypted_size(std::size_t plaintext_length) -> std::size_t;
+
+    /**
+     * @brief Largest CBC plaintext a ciphertext can decrypt to: the ciphertext length less the 16-byte IV, the padding is only known once it has been decrypted
+     *
+     * @param ciphertext_length: Length of the ciphertext in bytes
+     */
+    auto CBC_Decrypted_size(std::size_t ciphertext_length) -> std::size_t;
+
+    /**
+     * @brief Cipher Block Chaining Encryption into a caller-owned buffer;
+     *
+     * @param plaintext_bytes: Contiguous bytes of the plaintext, or the start of ciphertext_out to encrypt in place
+     * @param ciphertext_out: Buffer of at least CBC_Encrypted_size(plaintext_bytes.size()) bytes
+     * @param schedule: Expanded key
+     * @return std::size_t: Number of bytes written to ciphertext_out
+     * @throws aes_error: If ciphertext_out is too small
+     */
+    auto CBC_Encrypt(aes::span<const aes::byte> plaintext_bytes, aes::span<aes::byte> ciphertext_out, const aes::KeySchedule& schedule) -> std::size_t;
+
+    /**
+     * @brief Cipher Block Chaining Decryption into a caller-owned buffer;
+     *
+     * @param ciphertext_bytes: Contiguous bytes of the ciphertext, may start at plaintext_out to decrypt in place
+     * @param plaintext_out: Buffer of at least CBC_Decrypted_size(ciphertext_bytes.size()) bytes
+     * @param schedule: Expanded key
+     * @return std::size_t: Length of the plaintext written to the start of plaintext_out
+     * @throws aes_error: If plaintext_out is too small or the ciphertext is malformed
+     */
+    auto CBC_Decrypt(aes::span<const aes::byte> ciphertext_bytes, aes::span<aes::byte> plaintext_out, const aes::KeySchedule& schedule) -> std::size_t;
+
+    /**
+     * @brief Size of the CFB ciphertext of a plaintext: the 16-byte IV followed by the plaintext length
+     *
+     * @param plaintext_length: Length of the plaintext in bytes
+     */
+    auto CFB_Encrypted_size(std::size_t plaintext_length) -> std::size_t;
+
+    /**
+     * @brief Largest CFB plaintext a ciphertext can decrypt to: the ciphertext length less the 16-byte IV
+     *
+     * @param ciphertext_length: Length of the ciphertext in bytes
+     */
+    auto CFB_Decrypted_size(std::size_t ciphertext_length) -> std::size_t;
+
+    /**
+     * @brief Cipher Feedback Encryption into a caller-owned buffer;
+     *
+     * @param plaintext_bytes: Contiguous bytes of the plaintext, or the start of ciphertext_out to encrypt in place
+     * @param ciphertext_out: Buffer of at least CFB_Encrypted_size(plaintext_bytes.size()) bytes
+     * @param schedule: Expanded key
+     * @return std::size_t: Number of bytes written to ciphertext_out
+     * @throws aes_error: If ciphertext_out is too small
+     */
+    auto CFB_Encrypt(aes::span<const aes::byte> plaintext_bytes, aes::span<aes::byte> ciphertext_out, const aes::KeySchedule& schedule) -> std::size_t;
+
+    /**
+     * @brief Cipher Feedback Decryption into a caller-owned buffer;
+     *
+     * @param ciphertext_bytes: Contiguous bytes of the ciphertext, may start at plaintext_out to decrypt in place
+     * @param plaintext_out: Buffer of at least CFB_Decrypted_size(ciphertext_bytes.size()) bytes
+     * @param schedule: Expanded key
+     * @return std::size_t: Length of the plaintext written to the start of plaintext_out
+     * @throws aes_error: If plaintext_out is too small or the ciphertext is malformed
+     */
+    auto CFB_Decrypt(aes::span<const aes::byte> ciphertext_bytes, aes::span<aes::byte> plaintext_out, const aes::KeySchedule& schedule) -> std::size_t;
+
+    /**
+     * @brief Size of the OFM ciphertext of a plaintext: the 16-byte IV followed by the plaintext length
+     *
+     * @param plaintext_length: Length of the plaintext in bytes
+     */
+    auto OFM_Encrypted_size(std::size_t plaintext_length) -> std::size_t;
+
+    /**
+     * @brief Largest OFM plaintext a ciphertext can decrypt to: the ciphertext length less the 16-byte IV
+     *
+     * @param ciphertext_length: Length of the ciphertext in bytes
+     */
+    auto OFM_Decrypted_size(std::size_t ciphertext_length) -> std::size_t;
+
+    /**
+     * @brief Outback Feedback Mode Encryption into a caller-owned buffer;
+     *
+     * @param plaintext_bytes: Contiguous bytes of the plaintext, or the start of ciphertext_out to encrypt in place
+     * @param ciphertext_out: Buffer of at least OFM_Encrypted_size(plaintext_bytes.size()) bytes
+     * @param schedule: Expanded key
+     * @return std::size_t: Number of bytes written to ciphertext_out
+     * @throws aes_error: If ciphertext_out is too small
+     */
+    auto OFM_Encrypt(aes::span<const aes::byte> plaintext_bytes, aes::span<aes::byte> ciphertext_out, const aes::KeySchedule& schedule) -> std::size_t;
+
+    /**
+     * @brief Outback Feedback Mode Decryption into a caller-owned buffer;
+     *
+     * @param ciphertext_bytes: Contiguous bytes of the ciphertext, may start at plaintext_out to decrypt in place
+     * @param plaintext_out: Buffer of at least OFM_Decrypted_size(ciphertext_bytes.size()) bytes
+     * @param schedule: Expanded key
+     * @return std::size_t: Length of the plaintext written to the start of plaintext_out
+     * @throws aes_error: If plaintext_out is too small or the ciphertext is malformed
+     */
+    auto OFM_Decrypt(aes::span<const aes::byte> ciphertext_bytes, aes::span<aes::byte> plaintext_out, const aes::KeySchedule& schedule) -> std::size_t;
 
     /**
      * @brief Genearates a secure AES key of a given key size
@@ -0,0 +1,224 @@
+#ifndef GF256_HPP
+#define GF256_HPP
+
+/**
+ * Defines arithmetic in GF(2^8) modulo x^8+x^4+x^3+x+1, the field AES operates in.
+ *
+ * Every function is branch-free and allocation-free: conditional reductions are replaced by masks derived from the bits
+ * being shifted out and inversion is a fixed exponentiation, so the running time does not depend on the operands. The
+ * scalar functions are constexpr so they can also be used to build tables at compile time. The *_word variants act on
+ * the four bytes of a 32-bit word and the *_state variants on the 16 bytes of an xmm register (SSE2, available on every
+ * x86-64 processor).
+ **/
+
+#include <cstdint>
+#include <emmintrin.h> // SSE2
+#include <utility>
+
+namespace gf256 {
+    using byte = uint8_t;
+    using word = uint32_t;
+
+    constexpr const byte REDUCTION = 0x1b; // x^8 mod x^8+x^4+x^3+x+1
+
+    /**
+     * @brief Multiplies by x (0x02), reducing when the top bit is shifted out
+     *
+     * @param a: byte representing the polynomial being multiplied
+     * @return byte: a * x
+     */
+    constexpr auto xtime(byte a) -> byte {
+        return static_cast<byte>((a << 1U) ^ ((0U - (a >> 7U)) & REDUCTION));
+    }
+
+    /// Fixed xtime chains for the InvMixColumns coefficients: 0x09 = x^3+1, 0x0b = x^3+x+1, 0x0d = x^3+x^2+1, 0x0e = x^3+x^2+x
+    constexpr auto mul9(byte a) -> byte {
+        return static_cast<byte>(xtime(xtime(xtime(a))) ^ a);
+    }
+
+    constexpr auto mulb(byte a) -> byte {
+        return static_cast<byte>(xtime(xtime(xtime(a))) ^ xtime(a) ^ a);
+    }
+
+    constexpr auto muld(byte a) -> byte {
+        return static_cast<byte>(xtime(xtime(xtime(a))) ^ xtime(xtime(a)) ^ a);
+    }
+
+    constexpr auto mule(byte a) -> byte {
+        return static_cast<byte>(xtime(xtime(xtime(a))) ^ xtime(xtime(a)) ^ xtime(a));
+    }
+
+    /**
+     * @brief Reduces a carry-less product of at most 15 bits modulo x^8+x^4+x^3+x+1
+     * The bits above x^7 are folded back twice as multiples of x^8 = 0x1b, which always leaves at most 8 bits
+     *
+     * @param product: polynomial of degree 14 or less
+     * @return byte: product modulo x^8+x^4+x^3+x+1
+     */
+    constexpr auto reduce(unsigned int product) -> byte {
+        unsigned int high = product >> 8U;
+        product = (product & 0xffU) ^ high ^ (high << 1U) ^ (high << 3U) ^ (high << 4U);
+        high = product >> 8U;
+        return static_cast<byte>(product ^ high ^ (high << 1U) ^ (high << 3U) ^ (high << 4U));
+    }
+
+    /**
+     * @brief General multiplication, always accumulating the 8 shifted copies of a selected by the bits of b
+     * The copies do not depend on each other, so only the reduction is sequential
+     *
+     * @param a: byte representing a polynomial in the field
+     * @param b: byte representing another polynomial in the field
+     * @param Bit: the sequence 0 .. 7, the fold expression writes out one copy per bit of b
+     * @return byte: a * b
+     */
+    template <std::size_t... Bit>
+    constexpr auto multiply(byte a, byte b, std::index_sequence<Bit...> /*bits*/) -> byte {
+        return reduce((((0U - ((b >> Bit) & 1U)) & (static_cast<unsigned int>(a) << Bit)) ^ ...));
+    }
+
+    constexpr auto multiply(byte a, byte b) -> byte {
+        return multiply(a, b, std::make_index_sequence<8>{});
+    }
+
+    /**
+     * @brief Squaring, which only moves bit i of a to bit 2i before the reduction
+     *
+     * @param a: byte representing the polynomial being squared
+     * @return byte: a * a
+     */
+    constexpr auto square(byte a) -> byte {
+        unsigned int spread = a;
+        spread = (spread | (spread << 4U)) & 0x0f0fU;
+        spread = (spread | (spread << 2U)) & 0x3333U;
+        spread = (spread | (spread << 1U)) & 0x5555U;
+        return reduce(spread);
+    }
+
+    /**
+     * @brief Multiplicative inverse as a^254 (a^255 = 1 for every non-zero a), with 0 mapping to 0 as SubBytes requires
+     * The fixed addition chain 2, 3, 6, 12, 14, 15, 30, 60, 120, 240, 254 takes 11 multiplications whatever the input
+     *
+     * @param a: byte representing the polynomial being inverted
+     * @return byte: a^-1, or 0 if a is 0
+     */
+    constexpr auto inverse(byte a) -> byte {
+        const byte a2 = square(a);
+        const byte a3 = multiply(a2, a);
+        const byte a6 = square(a3);
+        const byte a12 = square(a6);
+        const byte a14 = multiply(a12, a2);
+        byte a240 = multiply(a12, a3); // a^15, squared four times below
+        for (int i = 0; i < 4; i++) {
+            a240 = square(a240);
+        }
+        return multiply(a240, a14);
+    }
+
+    // Worked examples of FIPS-197 section 4.2
+    static_assert(multiply(0x57, 0x83) == 0xc1, "GF(2^8) multiplication does not match FIPS-197");
+    static_assert(multiply(0x57, 0x13) == 0xfe, "GF(2^8) multiplication does not match FIPS-197");
+    static_assert(xtime(0x57) == 0xae && xtime(0xae) == 0x47 && xtime(0x47) == 0x8e && xtime(0x8e) == 0x07, "xtime does not match FIPS-197");
+    static_assert(square(0x57) == multiply(0x57, 0x57) && square(0xff) == multiply(0xff, 0xff), "squaring does not match multiplication");
+    static_assert(multiply(inverse(0x53), 0x53) == 0x01 && inverse(0x53) == 0xca && inverse(0x00) == 0x00, "inverse does not match FIPS-197");
+
+    /**
+     * @brief Multiplies the four bytes of a word by x at once, the reduction is a multiply by the extracted top bits
+     *
+     * @param a: word holding four field elements
+     * @return word: every byte of a multiplied by x
+     */
+    constexpr auto xtime_word(word a) -> word {
+        return ((a & 0x7f7f7f7fU) << 1U) ^ (((a >> 7U) & 0x01010101U) * REDUCTION);
+    }
+
+    /**
+     * @brief Multiplies all 16 bytes of a register by x: a doubling plus 0x1b wherever the top bit was set
+     *
+     * @param a: register holding 16 field elements
+     * @return __m128i: every byte of a multiplied by x
+     */
+    inline auto xtime_state(__m128i a) -> __m128i {
+        const __m128i overflow = _mm_cmplt_epi8(a, _mm_setzero_si128());
+        return _mm_xor_si128(_mm_add_epi8(a, a), _mm_and_si128(overflow, _mm_set1_epi8(REDUCTION)));
+    }
+
+    inline auto mul9_state(__m128i a) -> __m128i {
+        return _mm_xor_si128(xtime_state(xtime_state(xtime_state(a))), a);
+    }
+
+    inline auto mulb_state(__m128i a) -> __m128i {
+        const __m128i a2 = xtime_state(a);
+        return _mm_xor_si128(_mm_xor_si128(xtime_state(xtime_state(a2)), a2), a);
+    }
+
+    inline auto muld_state(__m128i a) -> __m128i {
+        const __m128i a4 = xtime_state(xtime_state(a));
+        return _mm_xor_si128(_mm_xor_si128(xtime_state(a4), a4), a);
+    }
+
+    inline auto mule_state(__m128i a) -> __m128i {
+        const __m128i a2 = xtime_state(a);
+        const __m128i a4 = xtime_state(a2);
+        return _mm_xor_si128(_mm_xor_si128(xtime_state(a4), a4), a2);
+    }
+
+    /**
+     * @brief Multiplies the 16 bytes of a by the corresponding 16 bytes of b
+     *
+     * @param a: register holding 16 field elements
+     * @param b: register holding the 16 multipliers
+     * @return __m128i: the 16 products
+     */
+    inline auto multiply_state(__m128i a, __m128i b) -> __m128i {
+        __m128i product = _mm_setzero_si128();
+        for (int i = 0; i < 8; i++) {
+            // Moves bit i of every byte of b into its sign bit, then widens the sign into a byte mask
+            const __m128i bit = _mm_slli_epi16(b, 7 - i);
+            const __m128i mask = _mm_cmplt_epi8(bit, _mm_setzero_si128());
+            product = _mm_xor_si128(product, _mm_and_si128(mask, a));
+            a = xtime_state(a);
+        }
+        return product;
+    }
+
+    /**
+     * @brief Squares all 16 bytes of a register. Squaring is linear over the bits, so the result is the sum of the squares
+     * of the set bits, each selected by a mask independently of the others
+     *
+     * @param a: register holding 16 field elements
+     * @param Bit: the sequence 0 .. 7, the fold expression writes out one term per bit
+     * @return __m128i: the 16 squares
+     */
+    template <std::size_t... Bit>
+    inline auto square_state(__m128i a, std::index_sequence<Bit...> /*bits*/) -> __m128i {
+        __m128i result = _mm_setzero_si128();
+        ((result = _mm_xor_si128(result, _mm_and_si128(_mm_cmplt_epi8(_mm_slli_epi16(a, 7 - Bit), _mm_setzero_si128()),
+                                                       _mm_set1_epi8(static_cast<char>(square(static_cast<byte>(1U << Bit))))))), ...);
+        return result;
+    }
+
+    inline auto square_state(__m128i a) -> __m128i {
+        return square_state(a, std::make_index_sequence<8>{});
+    }
+
+    /**
+     * @brief Inverts all 16 bytes of a register with the addition chain of inverse, zero bytes stay zero
+     *
+     * @param a: register holding 16 field elements
+     * @return __m128i: the 16 inverses
+     */
+    inline auto inverse_state(__m128i a) -> __m128i {
+        const __m128i a2 = square_state(a);
+        const __m128i a3 = multiply_state(a2, a);
+        const __m128i a6 = square_state(a3);
+        const __m128i a12 = square_state(a6);
+        const __m128i a14 = multiply_state(a12, a2);
+        __m128i a240 = multiply_state(a12, a3); // a^15, squared four times below
+        for (int i = 0; i < 4; i++) {
+            a240 = square_state(a240);
+        }
+        return multiply_state(a240, a14);
+    }
+} // end of namespace gf256
+
+#endif
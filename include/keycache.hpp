@@ -0,0 +1,70 @@
+#ifndef KEYCACHE_HPP
+#define KEYCACHE_HPP
+
+/**
+ * Defines the process-wide cache of expanded keys consulted by the cipher modes.
+ *
+ * Entries are found by a SipHash-2-4 fingerprint of the key bytes, computed with a random 128-bit key drawn once per process,
+ * so neither the fingerprints nor the bucket layout reveal anything about the keys or can be steered by whoever chooses them.
+ * A fingerprint match is confirmed by comparing the key with the first round key of the cached schedule, in constant time.
+ * The cache keeps the capacity most recently used schedules; a schedule is zeroized as soon as it has been evicted and the
+ * last caller using it has released it. Every function is thread-safe.
+ **/
+
+#include "aes.hpp"
+#include <memory>
+
+namespace keycache {
+    constexpr const std::size_t DEFAULT_CAPACITY = 64; // schedules kept, about 64 KB
+
+    struct statistics {
+        std::size_t hits;
+        std::size_t misses;
+        std::size_t evictions;
+    };
+
+    /**
+     * @brief SipHash-2-4 of a message
+     *
+     * @param key: 128-bit SipHash key, as two little-endian 64-bit halves
+     * @param data: Pointer to the message
+     * @param length: Length of the message in bytes
+     * @return uint64_t: The 64-bit tag
+     */
+    auto siphash(const std::array<uint64_t, 2>& key, const aes::byte* data, std::size_t length) -> uint64_t;
+
+    /**
+     * @brief Returns the expanded key for key_bytes, from the cache or expanded and inserted as the most recently used entry
+     *
+     * @param key_bytes: bytes of the 128, 192 or 256 bit cipher key
+     * @return std::shared_ptr<const aes::KeySchedule>: The schedule, which stays valid while it is held even if it is evicted
+     * @throws aes_error: If the key length is invalid
+     */
+    auto schedule(const std::vector<aes::byte>& key_bytes) -> std::shared_ptr<const aes::KeySchedule>;
+
+    /**
+     * @brief Changes the number of schedules kept, evicting the least recently used ones above it. 0 disables the cache
+     *
+     * @param capacity: Maximum number of schedules
+     */
+    void set_capacity(std::size_t capacity);
+
+    auto capacity() -> std::size_t;
+
+    /**
+     * @brief Number of schedules currently cached
+     */
+    auto size() -> std::size_t;
+
+    /**
+     * @brief Evicts every schedule, for example once the keys they were expanded from are retired
+     */
+    void clear();
+
+    /**
+     * @brief Hits, misses and evictions since the start of the process
+     */
+    auto stats() -> statistics;
+} // end of namespace keycache
+
+#endif
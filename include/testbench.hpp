@@ -28,6 +28,19 @@ namespace tb {
 	TEST_OFB = 4096,
 	TEST_CTR = 8192,
 	TEST_GENERIC = 16384,
+	TEST_AESNI = 32768,
+	TEST_BITSLICE = 65536,
+	TEST_VPERM = 131072,
+	TEST_COLUMN_STATE = 262144,
+	TEST_GF256 = 524288,
+	TEST_MULTI_KEY = 1048576,
+	TEST_ENGINES = 2097152,
+	TEST_CALIBRATION = 4194304,
+	TEST_COMPACT_KEY = 8388608,
+	TEST_KEY_CACHE = 16777216,
+	TEST_SPAN_MODES = 33554432,
+	TEST_CALLER_BUFFERS = 67108864,
+	TEST_PARALLEL_MODES = 134217728,
     };
 
     /**
@@ -51,6 +64,12 @@ namespace tb {
     */
     void test_no_cache_lookup_timing();
 
+    /**
+     * @brief Used to verify no_cache_lookup_state against the S-box and compare its runtime with 16 scalar no_cache_lookup calls
+    *
+    */
+    void test_no_cache_lookup_state_timing();
+
     /**
      * @brief Used to test the encryption, decryption process of OFM to ensure equality
      * 
@@ -102,6 +121,92 @@ namespace tb {
     void test_aes256_key_timing();
     
     void test_aes();
+
+    /**
+     * @brief Used to verify that the AES-NI engine produces the same blocks as the portable engine, for every key size
+     *
+     */
+    void test_aesni_accuracy();
+
+    /**
+     * @brief Used to verify that the bitsliced engine produces the same blocks as the portable engine, for full and partial batches
+     *
+     */
+    void test_bitslice_accuracy();
+
+    /**
+     * @brief Used to verify that the vector-permute engine produces the same blocks as the portable engine, for every key size
+     *
+     */
+    void test_vperm_accuracy();
+
+    /**
+     * @brief Used to verify that the fused rounds on aes::column_state and the block entry point match the portable engine
+     *
+     */
+    void test_column_state_accuracy();
+
+    /**
+     * @brief Used to verify the scalar, word and vector GF(2^8) arithmetic against textbook multiplication, for every pair of bytes
+     *
+     */
+    void test_gf256_accuracy();
+
+    /**
+     * @brief Used to verify encrypt_multi/decrypt_multi against per-block calls, for batches mixing 128, 192 and 256-bit keys
+     *
+     */
+    void test_multi_key_accuracy();
+
+    /**
+     * @brief Used to verify every engine this processor supports against the FIPS-197 vectors and the table engine,
+     * through the block, bulk and state entry points
+     *
+     */
+    void test_engines();
+
+    /**
+     * @brief Used to verify that calibration picks a supported constant-time engine, records it for this CPU model and
+     * reuses the recorded choice, with the cache file in the working directory
+     *
+     */
+    void test_calibration();
+
+    /**
+     * @brief Used to verify the on-the-fly key schedule of CompactKey against KeySchedule on every supported engine, and to
+     * compare their memory footprint and speed
+     *
+     */
+    void test_compact_key();
+
+    /**
+     * @brief Used to verify SipHash against its reference vectors and the hits, LRU evictions and thread safety of keycache,
+     * and to time small messages with and without it
+     *
+     */
+    void test_key_cache();
+
+    /**
+     * @brief Used to verify that every mode gives the same result for a span into a larger buffer as for a copy of those
+     * bytes, and that arrays of aes::block are accepted as contiguous bytes
+     *
+     */
+    void test_span_modes();
+
+    /**
+     * @brief Used to verify the caller-buffer overloads of every mode, in place and into a separate buffer, against the
+     * output sizes they report, and to time small messages through them and through the vector API
+     *
+     */
+    void test_caller_buffers();
+
+    /**
+     * @brief Used to verify that the modes split over several threads give the same bytes as on one thread, and to compare
+     * their throughput on a large message
+     *
+     */
+    void test_parallel_modes();
+
     /**
      * @brief Function to call to test specific modules within the program
     * 
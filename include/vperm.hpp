@@ -0,0 +1,260 @@
+#ifndef VPERM_HPP
+#define VPERM_HPP
+
+/**
+ * Defines the vector-permute (SSSE3) block engine, after "Accelerating AES with Vector Permute Instructions" by Mike Hamburg.
+ *
+ * The whole round stays in an xmm register. SubBytes maps every byte into GF((2^4)^2) with two nibble lookups, inverts it
+ * with nibble-indexed pshufb tables of GF(2^4) inverses, and maps the result back (through the affine transformation for
+ * encryption) with two more lookups. ShiftRows and MixColumns are byte shuffles and XORs. Every table is 16 bytes wide and
+ * lives in a register, so the lookups are constant-time in the same way as no_cache_lookup.
+ *
+ * Tower field used by the tables: GF(2^4) = GF(2)[u]/(u^4+u+1), GF(2^8) = GF(2^4)[t]/(t^2+t+1/a) with a = 0x2, and the AES
+ * generator x mapped to 0x2c (t coordinate in the high nibble). A byte (h, l) of the tower field is stored as (h/a, l).
+ **/
+
+#include "aes.hpp"
+
+namespace vperm {
+    constexpr const aes::byte TOWER_A = 0x2;     // a, the tower field is GF(2^4)[t]/(t^2+t+1/a)
+    constexpr const aes::byte TOWER_X = 0x2c;    // image (h, l) of the AES generator x in the tower field
+
+    /**
+     * @brief Multiplication in GF(2^4) = GF(2)[u]/(u^4+u+1)
+     * @param a: nibble representing a polynomial in the field
+     * @param b: nibble representing another polynomial in the field
+     * @return byte: a * b
+     */
+    constexpr auto gf16_multiply(aes::byte a, aes::byte b) -> aes::byte {
+        unsigned int product = 0;
+        for (unsigned int i = 0; i < 4; i++) {
+            product ^= ((b >> i) & 1U) * (unsigned{a} << i);
+        }
+        for (unsigned int i = 7; i > 3; i--) {
+            product ^= ((product >> i) & 1U) * (0x13U << (i - 4));
+        }
+        return static_cast<aes::byte>(product);
+    }
+
+    /**
+     * @brief Inversion in GF(2^4) as a^14, mapping 0 to 0
+     * @param a: nibble being inverted
+     * @return byte: 1/a
+     */
+    constexpr auto gf16_inverse(aes::byte a) -> aes::byte {
+        aes::byte a2 = gf16_multiply(a, a);
+        aes::byte a4 = gf16_multiply(a2, a2);
+        aes::byte a8 = gf16_multiply(a4, a4);
+        return gf16_multiply(gf16_multiply(a8, a4), a2);
+    }
+
+    /**
+     * @brief Multiplication in the tower field, elements are stored as (h << 4) | l for h*t + l
+     * @param x: element of the tower field
+     * @param y: another element of the tower field
+     * @return byte: x * y, reduced with t^2 = t + 1/a
+     */
+    constexpr auto tower_multiply(aes::byte x, aes::byte y) -> aes::byte {
+        const aes::byte h = x >> 4U;
+        const aes::byte l = x & 0x0fU;
+        const aes::byte h2 = y >> 4U;
+        const aes::byte l2 = y & 0x0fU;
+        const aes::byte hh = gf16_multiply(h, h2);
+        const aes::byte high = hh ^ gf16_multiply(h, l2) ^ gf16_multiply(l, h2);
+        const aes::byte low = gf16_multiply(hh, gf16_inverse(TOWER_A)) ^ gf16_multiply(l, l2);
+        return static_cast<aes::byte>((high << 4U) | low);
+    }
+
+    /**
+     * @brief Field isomorphism from the AES polynomial basis into the tower field, x^b maps to TOWER_X^b
+     * @param s: byte in the AES representation
+     * @return byte: the same element in the tower field
+     */
+    constexpr auto to_tower(aes::byte s) -> aes::byte {
+        aes::byte image = 0;
+        aes::byte power = 0x01;
+        for (unsigned int b = 0; b < 8; b++) {
+            image ^= ((s >> b) & 1U) != 0 ? power : 0;
+            power = tower_multiply(power, TOWER_X);
+        }
+        return image;
+    }
+
+    /**
+     * @brief Inverse of to_tower, only used while building the tables
+     * @param t: element of the tower field
+     * @return byte: the same element in the AES representation
+     */
+    constexpr auto from_tower(aes::byte t) -> aes::byte {
+        for (unsigned int s = 0; s < 256; s++) {
+            if (to_tower(static_cast<aes::byte>(s)) == t) {
+                return static_cast<aes::byte>(s);
+            }
+        }
+        return 0;
+    }
+
+    /**
+     * @brief Representation of a byte inside the engine: the tower element with its high half divided by a
+     * @param s: byte in the AES representation
+     * @return byte: the register encoding (h/a, l)
+     */
+    constexpr auto tower_code(aes::byte s) -> aes::byte {
+        const aes::byte t = to_tower(s);
+        return static_cast<aes::byte>((gf16_multiply(t >> 4U, gf16_inverse(TOWER_A)) << 4U) | (t & 0x0fU));
+    }
+
+    /**
+     * @brief Evaluates a nibble function over all 16 nibbles
+     * @param value: Callable mapping a nibble to its table entry
+     * @return std::array<byte, 16>: The pshufb table
+     */
+    template <class Function>
+    constexpr auto nibble_table(Function value) -> std::array<aes::byte, 16> {
+        std::array<aes::byte, 16> table{};
+        for (unsigned int n = 0; n < 16; n++) {
+            table[n] = value(static_cast<aes::byte>(n));
+        }
+        return table;
+    }
+
+    // The inversion outputs io, jo are GF(2^4) elements; these are the tower elements they contribute before the change of basis
+    constexpr auto first_output(aes::byte u) -> aes::byte {
+        const aes::byte inverse = gf16_inverse(u);
+        return from_tower(static_cast<aes::byte>((gf16_multiply(1U ^ gf16_inverse(TOWER_A), inverse) << 4U) | inverse));
+    }
+
+    constexpr auto second_output(aes::byte u) -> aes::byte {
+        return from_tower(static_cast<aes::byte>(gf16_multiply(gf16_inverse(TOWER_A), gf16_inverse(u)) << 4U));
+    }
+
+    /// Linear map from the AES polynomial basis into the tower representation, indexed by the low / high nibble
+    alignas(16) constexpr const std::array<aes::byte, 16> IPT_LO = nibble_table([](aes::byte n) { return tower_code(n); });
+    alignas(16) constexpr const std::array<aes::byte, 16> IPT_HI = nibble_table([](aes::byte n) { return tower_code(n << 4U); });
+
+    /// Inverse affine transformation (including the 0x63 constant) followed by the map into the tower representation
+    alignas(16) constexpr const std::array<aes::byte, 16> DIPT_LO = nibble_table([](aes::byte n) {
+        return tower_code(aes::inverse_affine_transform(n));
+    });
+    alignas(16) constexpr const std::array<aes::byte, 16> DIPT_HI = nibble_table([](aes::byte n) {
+        return tower_code(aes::inverse_affine_transform((n << 4U) ^ 0x63U));
+    });
+
+    /// 1/x and a/x in GF(2^4); 0 maps to 0x80 so that a later pshufb indexed by the result produces 0
+    alignas(16) constexpr const std::array<aes::byte, 16> INV = nibble_table([](aes::byte n) {
+        return n == 0 ? aes::byte{0x80} : gf16_inverse(n);
+    });
+    alignas(16) constexpr const std::array<aes::byte, 16> A_OVER = nibble_table([](aes::byte n) {
+        return n == 0 ? aes::byte{0x80} : gf16_multiply(TOWER_A, gf16_inverse(n));
+    });
+
+    /// Back to the AES basis through the affine transformation (without the 0x63 constant), one table per inversion output
+    alignas(16) constexpr const std::array<aes::byte, 16> SBO_1 = nibble_table([](aes::byte n) {
+        return static_cast<aes::byte>(aes::affine_transform(first_output(n)) ^ 0x63U);
+    });
+    alignas(16) constexpr const std::array<aes::byte, 16> SBO_2 = nibble_table([](aes::byte n) {
+        return static_cast<aes::byte>(aes::affine_transform(second_output(n)) ^ 0x63U);
+    });
+
+    /// Back to the AES basis without the affine transformation, used by InvSubBytes
+    alignas(16) constexpr const std::array<aes::byte, 16> DSBO_1 = nibble_table(first_output);
+    alignas(16) constexpr const std::array<aes::byte, 16> DSBO_2 = nibble_table(second_output);
+
+    /**
+     * @brief Scalar model of the engine's SubBytes / InvSubBytes, with pshufb's rule that an index with bit 7 set reads 0
+     * @param s: byte being substituted
+     * @param inverse: true to model InvSubBytes
+     * @return byte: the substituted byte
+     */
+    constexpr auto model_substitution(aes::byte s, bool inverse) -> aes::byte {
+        auto lookup = [](const std::array<aes::byte, 16>& table, aes::byte index) -> aes::byte {
+            return (index & 0x80U) != 0 ? aes::byte{0} : table[index & 0x0fU];
+        };
+        const aes::byte code = inverse ? (DIPT_LO[s & 0x0fU] ^ DIPT_HI[s >> 4U]) : (IPT_LO[s & 0x0fU] ^ IPT_HI[s >> 4U]);
+        const aes::byte k = code & 0x0fU;
+        const aes::byte i = code >> 4U;
+        const aes::byte ak = lookup(A_OVER, k);
+        const aes::byte j = i ^ k;
+        const aes::byte io = lookup(INV, lookup(INV, i) ^ ak) ^ j;
+        const aes::byte jo = lookup(INV, lookup(INV, j) ^ ak) ^ i;
+        if (inverse) {
+            return lookup(DSBO_1, io) ^ lookup(DSBO_2, jo);
+        }
+        return lookup(SBO_1, io) ^ lookup(SBO_2, jo) ^ 0x63U;
+    }
+
+    constexpr auto tables_match_s_boxes() -> bool {
+        for (unsigned int s = 0; s < 256; s++) {
+            if (model_substitution(static_cast<aes::byte>(s), false) != aes::S_BOX[s] ||
+                model_substitution(static_cast<aes::byte>(s), true) != aes::INV_S_BOX[s]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static_assert(tower_code(0x02) == 0x1c, "x must map to 0x2c, stored as (0x2c >> 4) / a = 1 in the high nibble");
+    static_assert(tables_match_s_boxes(), "The vector-permute tables do not reproduce S_BOX and INV_S_BOX");
+
+    /**
+     * @brief Queries CPUID for the SSSE3 extension required by this engine
+     * The query is only performed once, the result is cached for the remainder of the process
+     *
+     * @return bool: true if the vector-permute engine can be used on this processor
+     */
+    auto supported() -> bool;
+
+    /**
+     * @brief Performs the AES encryption with the vector-permute round
+     * @param Nr: Number of rounds, which is a function of Nk and Nb
+     * @param state: Reference to AES state being operated upon
+     * @param w: Reference to the expanded key
+     */
+    void encrypt(unsigned int Nr, aes::state& state, const std::vector<aes::word>& w);
+
+    /**
+     * @brief Performs the AES decryption with the vector-permute round
+     * @param Nr: Number of rounds, which is a function of Nk and Nb
+     * @param state: Reference to AES state being operated upon
+     * @param w: Reference to the expanded key
+     */
+    void decrypt(unsigned int Nr, aes::state& state, const std::vector<aes::word>& w);
+
+    /**
+     * @brief Encrypts one 16-byte block in its stored (column-major) order, without going through aes::state
+     * @param schedule: Reference to the expanded key, whose aligned round key blocks are loaded directly
+     * @param in: Pointer to the plaintext block
+     * @param out: Pointer to where the ciphertext block is written (may be in)
+     */
+    void encrypt_block(const aes::KeySchedule& schedule, const aes::byte* in, aes::byte* out);
+
+    /**
+     * @brief Decrypts one 16-byte block in its stored (column-major) order, without going through aes::state
+     * @param schedule: Reference to the expanded key, whose aligned round key blocks are loaded directly
+     * @param in: Pointer to the ciphertext block
+     * @param out: Pointer to where the plaintext block is written (may be in)
+     */
+    void decrypt_block(const aes::KeySchedule& schedule, const aes::byte* in, aes::byte* out);
+
+    /**
+     * @brief encrypt_block specialized for a round count, with the rounds unrolled at compile time
+     * Instantiated for Nr = 10, 12 and 14, schedule.Nr must be equal to Nr
+     * @param schedule: Reference to the expanded key, whose aligned round key blocks are loaded directly
+     * @param in: Pointer to the plaintext block
+     * @param out: Pointer to where the ciphertext block is written (may be in)
+     */
+    template <unsigned int Nr>
+    void encrypt_block(const aes::KeySchedule& schedule, const aes::byte* in, aes::byte* out);
+
+    /**
+     * @brief decrypt_block specialized for a round count, with the rounds unrolled at compile time
+     * Instantiated for Nr = 10, 12 and 14, schedule.Nr must be equal to Nr
+     * @param schedule: Reference to the expanded key, whose aligned round key blocks are loaded directly
+     * @param in: Pointer to the ciphertext block
+     * @param out: Pointer to where the plaintext block is written (may be in)
+     */
+    template <unsigned int Nr>
+    void decrypt_block(const aes::KeySchedule& schedule, const aes::byte* in, aes::byte* out);
+} // end of namespace vperm
+
+#endif
@@ -19,6 +19,11 @@ void cpuid(unsigned int info[4], int InfoType); // NOLINT(hicpp-avoid-c-arrays,
 #include <iostream>
 
 constexpr const uint64_t RDSEED_FLAG = 0x40000; // 18th bit asserted
+constexpr const uint64_t SSSE3_FLAG = 0x200;     // CPUID leaf 1, ECX 9th bit asserted
+constexpr const uint64_t AESNI_FLAG = 0x2000000; // CPUID leaf 1, ECX 25th bit asserted
+constexpr const uint64_t OSXSAVE_FLAG = 0x8000000; // CPUID leaf 1, ECX 27th bit asserted (XGETBV usable)
+constexpr const uint64_t AVX2_FLAG = 0x20;         // CPUID leaf 7, EBX 5th bit asserted
+constexpr const uint64_t XCR0_AVX_STATE = 0x6;     // XCR0 bits 1 and 2: the OS saves the xmm and ymm registers
 
 /**
  * @brief Preferred solution for RNG (Hardware based solution)
@@ -1,14 +1,522 @@
 #include "aes.hpp"
 #include "aes_exceptions.hpp"
+#include "aesni.hpp"
+#include "avx2.hpp"
+#include "bitslice.hpp"
+#include "gf256.hpp"
+#include "vperm.hpp"
+#include <algorithm>
+#include <utility>
 
-void aes::swap_bytes(state &state, const std::array<byte, 256> &sub_source) {
-  for (std::size_t r = 0; r < NB; ++r) {
-    for (std::size_t c = 0; c < NB; ++c) {
-      byte curr_byte = state[r][c];
-      state[r][c] = no_cache_lookup(curr_byte & 0xF0U, curr_byte & 0xFU,
-                                    sub_source.data());
+namespace {
+  // The key expansion and MixColumns kernels are chosen once at startup so CPUID is not queried for every call,
+  // the block engine is chosen through the registry (aes::engines)
+  const bool USE_AESNI = aesni::supported();
+  const bool USE_AVX2 = avx2::supported();
+  const bool USE_LOOKUP = vperm::supported(); // no_cache_lookup_state needs pshufb
+
+  // Moves row r + n into row r of a column word (row 0 is the most significant byte)
+  auto rotate_rows(aes::word column, unsigned int n) -> aes::word {
+    return (column << (8U * n)) | (column >> (32U - 8U * n));
+  }
+
+  // Same rewrite of MixColumns as the vector-permute engine: xtime(t_r) ^ a_(r+1) ^ t_(r+2) with t_r = a_r ^ a_(r+1)
+  auto mix_column_word(aes::word column) -> aes::word {
+    aes::word rotated = rotate_rows(column, 1U);
+    aes::word t = column ^ rotated;
+    return gf256::xtime_word(t) ^ rotated ^ rotate_rows(t, 2U);
+  }
+
+  // InvMixColumns is MixColumns after adding 4(a_r ^ a_(r+2)) to every byte
+  auto inv_mix_column_word(aes::word column) -> aes::word {
+    return mix_column_word(column ^ gf256::xtime_word(gf256::xtime_word(column ^ rotate_rows(column, 2U))));
+  }
+
+  // Column c of ShiftRows(state): row r comes from column c + r
+  auto shifted_column(const aes::column_state &state, std::size_t c) -> aes::word {
+    return (state.columns[c] & 0xff000000U) | (state.columns[(c + 1) % aes::NB] & 0x00ff0000U) |
+           (state.columns[(c + 2) % aes::NB] & 0x0000ff00U) | (state.columns[(c + 3) % aes::NB] & 0x000000ffU);
+  }
+
+  // Column c of InvShiftRows(state): row r comes from column c - r
+  auto inv_shifted_column(const aes::column_state &state, std::size_t c) -> aes::word {
+    return (state.columns[c] & 0xff000000U) | (state.columns[(c + 3) % aes::NB] & 0x00ff0000U) |
+           (state.columns[(c + 2) % aes::NB] & 0x0000ff00U) | (state.columns[(c + 1) % aes::NB] & 0x000000ffU);
+  }
+
+  // Writes through a volatile pointer so the stores are not removed as dead before the key material goes out of scope
+  void zeroize(void *data, std::size_t length) {
+    volatile aes::byte *bytes = static_cast<volatile aes::byte *>(data);
+    for (std::size_t i = 0; i < length; i++) {
+      bytes[i] = 0;
+    }
+  }
+
+  // Runs key_expansion for a cipher key of any supported size
+  auto expand_key(const std::vector<aes::byte> &key_bytes) -> std::vector<aes::word> {
+    std::array<int, 2> nk_nr = aes::get_Nk_Nr(static_cast<int>(key_bytes.size()));
+    std::vector<aes::word> w(aes::NB * (nk_nr[1] + 1));
+    aes::key_expansion(key_bytes, w, nk_nr[0], nk_nr[1]);
+    return w;
+  }
+
+  // Row-major state: row r is the 32-bit lane r, so moving row r + n into row r is a lane shuffle
+  auto load_rows(const aes::state &state) -> __m128i {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i *>(state.data()));
+  }
+
+  void store_rows(aes::state &state, __m128i rows) {
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(state.data()), rows);
+  }
+
+  auto mix_rows(__m128i rows) -> __m128i {
+    const __m128i rotated = _mm_shuffle_epi32(rows, 0x39); // row r + 1
+    const __m128i t = _mm_xor_si128(rows, rotated);
+    return _mm_xor_si128(_mm_xor_si128(gf256::xtime_state(t), rotated), _mm_shuffle_epi32(t, 0x4e)); // t of row r + 2
+  }
+
+  // Substitutes the 16 bytes of the words in place, the S-box acts on bytes so their order in memory does not matter
+  void substitute_columns(aes::column_state &state, const std::array<aes::byte, 256> &sub_source) {
+    static_assert(sizeof(aes::column_state) == 16, "aes::column_state must be 16 contiguous bytes");
+    no_cache_lookup_state(reinterpret_cast<uint8_t *>(state.columns.data()), sub_source.data());
+  }
+
+  // The S-box circuit of the bitsliced engine on 16 bytes, byte i in bit i of every plane. Constant-time like the
+  // pshufb lookup, but built on plain integer instructions
+  void circuit_substitute(aes::byte *bytes, bool inverse) {
+    std::array<uint32_t, 8> slice{};
+    for (std::size_t i = 0; i < 16; i++) {
+      for (unsigned int b = 0; b < 8; b++) {
+        slice.at(b) |= static_cast<uint32_t>((bytes[i] >> b) & 1U) << i;
+      }
+    }
+    if (inverse) {
+      bitslice::inv_sbox(slice);
+    } else {
+      bitslice::sbox(slice);
+    }
+    for (std::size_t i = 0; i < 16; i++) {
+      uint32_t value = 0;
+      for (unsigned int b = 0; b < 8; b++) {
+        value |= ((slice.at(b) >> i) & 1U) << b;
+      }
+      bytes[i] = static_cast<aes::byte>(value);
     }
   }
+
+  // SubBytes of the compact-key rounds of the bitsliced engine, which must not need SSSE3 any more than its blocks do:
+  // the pshufb lookup when the processor has it, the slower S-box circuit otherwise
+  void fallback_substitute_columns(aes::column_state &state, const std::array<aes::byte, 256> &sub_source) {
+    if (USE_LOOKUP) {
+      substitute_columns(state, sub_source);
+    } else {
+      circuit_substitute(reinterpret_cast<aes::byte *>(state.columns.data()), &sub_source == &aes::INV_S_BOX);
+    }
+  }
+
+  // SubWord of the key expansion on 16 bytes: the pshufb lookup when the processor has it, the S-box circuit otherwise,
+  // so that the portable engines can expand their keys on any processor
+  void substitute_key_bytes(aes::byte *bytes) {
+    if (USE_LOOKUP) {
+      no_cache_lookup_state(bytes, aes::S_BOX.data());
+    } else {
+      circuit_substitute(bytes, false);
+    }
+  }
+
+  // Applies the Nr - 1 middle rounds, Round is the sequence 0 .. Nr - 2 and the fold expression unrolls them
+  template <class RoundFunction, std::size_t... Round>
+  void unrolled_rounds(aes::column_state &state, const aes::word *w, std::index_sequence<Round...> /*rounds*/, RoundFunction round) {
+    (round(state, w + aes::NB * (Round + 1)), ...);
+  }
+
+  // Substitutes the 16 bytes by indexing the table directly: the reference engine, whose memory accesses depend on the data
+  void table_substitute(aes::column_state &state, const std::array<aes::byte, 256> &sub_source) {
+    for (aes::word &column : state.columns) {
+      std::array<aes::byte, 4> bytes = aes::splitWord(column);
+      column = aes::buildWord(sub_source[bytes[0]], sub_source[bytes[1]], sub_source[bytes[2]], sub_source[bytes[3]]);
+    }
+  }
+
+  // The fused rounds on a column_state, Substitute is the SubBytes step so that the portable and table engines share them
+  template <void (*Substitute)(aes::column_state &, const std::array<aes::byte, 256> &)>
+  struct column_rounds {
+    static void round(aes::column_state &state, const aes::word *round_key) {
+      Substitute(state, aes::S_BOX);
+      aes::column_state result{};
+      for (std::size_t c = 0; c < aes::NB; c++) {
+        result.columns[c] = mix_column_word(shifted_column(state, c)) ^ round_key[c];
+      }
+      state = result;
+    }
+
+    static void final_round(aes::column_state &state, const aes::word *round_key) {
+      Substitute(state, aes::S_BOX);
+      aes::column_state result{};
+      for (std::size_t c = 0; c < aes::NB; c++) {
+        result.columns[c] = shifted_column(state, c) ^ round_key[c];
+      }
+      state = result;
+    }
+
+    static void inv_round(aes::column_state &state, const aes::word *round_key) {
+      Substitute(state, aes::INV_S_BOX);
+      aes::column_state result{};
+      for (std::size_t c = 0; c < aes::NB; c++) {
+        result.columns[c] = inv_mix_column_word(inv_shifted_column(state, c)) ^ round_key[c];
+      }
+      state = result;
+    }
+
+    static void inv_final_round(aes::column_state &state, const aes::word *round_key) {
+      Substitute(state, aes::INV_S_BOX);
+      aes::column_state result{};
+      for (std::size_t c = 0; c < aes::NB; c++) {
+        result.columns[c] = inv_shifted_column(state, c) ^ round_key[c];
+      }
+      state = result;
+    }
+
+    template <unsigned int Nr>
+    static void encrypt(aes::column_state &state, const aes::KeySchedule &schedule) {
+      const aes::word *w = schedule.encryption_words.data();
+
+      //Performs an AddRoundkey before the 10,12, or 14 rounds of AES
+      for (std::size_t c = 0; c < aes::NB; c++) {
+        state.columns[c] ^= w[c];
+      }
+
+      unrolled_rounds(state, w, std::make_index_sequence<Nr - 1>{}, round);
+      final_round(state, w + aes::NB * Nr);
+    }
+
+    template <unsigned int Nr>
+    static void decrypt(aes::column_state &state, const aes::KeySchedule &schedule) {
+      //the decryption keys start with the last round key
+      const aes::word *w = schedule.decryption_words.data();
+
+      for (std::size_t c = 0; c < aes::NB; c++) {
+        state.columns[c] ^= w[c];
+      }
+
+      unrolled_rounds(state, w, std::make_index_sequence<Nr - 1>{}, inv_round);
+      inv_final_round(state, w + aes::NB * Nr);
+    }
+
+    template <unsigned int Nr>
+    static void encrypt_block(const aes::KeySchedule &schedule, const aes::byte *in, aes::byte *out) {
+      aes::column_state state = aes::load_columns(in);
+      encrypt<Nr>(state, schedule);
+      aes::store_columns(state, out);
+    }
+
+    template <unsigned int Nr>
+    static void decrypt_block(const aes::KeySchedule &schedule, const aes::byte *in, aes::byte *out) {
+      aes::column_state state = aes::load_columns(in);
+      decrypt<Nr>(state, schedule);
+      aes::store_columns(state, out);
+    }
+  };
+
+  using portable_rounds = column_rounds<substitute_columns>;
+  using table_rounds = column_rounds<table_substitute>;
+  using fallback_rounds = column_rounds<fallback_substitute_columns>;
+
+  // Generates key schedule words one at a time in a ring of Nk words, word i in slot i % Nk. Stepping word i turns the
+  // slot from w[i - Nk] into w[i] when running forwards and from w[i] back into w[i - Nk] when running backwards: both
+  // directions XOR the same f(w[i - 1]) into it, and w[i - 1] is in the ring either way
+  template <unsigned int Nk>
+  struct key_stream {
+    std::array<aes::word, Nk> ring;
+
+    void step(unsigned int i) {
+      aes::word temp = ring[(i - 1) % Nk];
+      if (i % Nk == 0) {
+        temp = aes::rotword(aes::subword(temp)) ^ aes::Rcon.at(i / Nk);
+      } else if (Nk > 6 && i % Nk == 4) {
+        temp = aes::subword(temp);
+      }
+      ring[i % Nk] ^= temp;
+    }
+
+    auto at(unsigned int i) const -> aes::word {
+      return ring[i % Nk];
+    }
+  };
+
+  // Loads Nk key bytes into the ring, first_word being the schedule index of the first of them
+  template <unsigned int Nk>
+  auto load_stream(const std::array<aes::byte, 32> &bytes, unsigned int first_word) -> key_stream<Nk> {
+    key_stream<Nk> stream{};
+    for (unsigned int k = 0; k < Nk; k++) {
+      stream.ring[(first_word + k) % Nk] = aes::buildWord(bytes[4 * k], bytes[4 * k + 1], bytes[4 * k + 2], bytes[4 * k + 3]);
+    }
+    return stream;
+  }
+
+  template <class Rounds, unsigned int Nk>
+  void stream_encrypt_block(const aes::CompactKey &key, const aes::byte *in, aes::byte *out) {
+    constexpr unsigned int Nr = Nk + 6;
+    key_stream<Nk> stream = load_stream<Nk>(key.key, 0);
+    aes::column_state state = aes::load_columns(in);
+
+    //the first round key is part of the cipher key
+    for (std::size_t c = 0; c < aes::NB; c++) {
+      state.columns[c] ^= stream.at(c);
+    }
+
+    std::array<aes::word, aes::NB> round_key{};
+    for (unsigned int round = 1; round <= Nr; round++) {
+      for (unsigned int c = 0; c < aes::NB; c++) {
+        const unsigned int i = aes::NB * round + c;
+        if (i >= Nk) {
+          stream.step(i);
+        }
+        round_key[c] = stream.at(i);
+      }
+      if (round < Nr) {
+        Rounds::round(state, round_key.data());
+      } else {
+        Rounds::final_round(state, round_key.data());
+      }
+    }
+    aes::store_columns(state, out);
+    zeroize(stream.ring.data(), sizeof(stream.ring));
+    zeroize(round_key.data(), sizeof(round_key));
+  }
+
+  template <class Rounds, unsigned int Nk>
+  void stream_decrypt_block(const aes::CompactKey &key, const aes::byte *in, aes::byte *out) {
+    constexpr unsigned int Nr = Nk + 6;
+    constexpr unsigned int WORD_COUNT = aes::NB * (Nr + 1);
+    key_stream<Nk> stream = load_stream<Nk>(key.last_key, WORD_COUNT - Nk);
+    aes::column_state state = aes::load_columns(in);
+
+    //the last round key is part of the stored end of the schedule
+    for (std::size_t c = 0; c < aes::NB; c++) {
+      state.columns[c] ^= stream.at(aes::NB * Nr + c);
+    }
+
+    //lowest is the first schedule word the ring holds, words are regenerated downwards as the rounds need them
+    unsigned int lowest = WORD_COUNT - Nk;
+    std::array<aes::word, aes::NB> round_key{};
+    for (unsigned int round = Nr; round-- > 0;) {
+      for (; lowest > aes::NB * round; lowest--) {
+        stream.step(lowest - 1 + Nk);
+      }
+      for (unsigned int c = 0; c < aes::NB; c++) {
+        //equivalent inverse cipher, as in KeySchedule
+        round_key[c] = round == 0 ? stream.at(aes::NB * round + c) : inv_mix_column_word(stream.at(aes::NB * round + c));
+      }
+      if (round > 0) {
+        Rounds::inv_round(state, round_key.data());
+      } else {
+        Rounds::inv_final_round(state, round_key.data());
+      }
+    }
+    aes::store_columns(state, out);
+    zeroize(stream.ring.data(), sizeof(stream.ring));
+    zeroize(round_key.data(), sizeof(round_key));
+  }
+
+  template <class Rounds>
+  void stream_encrypt(const aes::CompactKey &key, const aes::byte *in, aes::byte *out) {
+    switch (key.Nk) {
+      case 4: stream_encrypt_block<Rounds, 4>(key, in, out); break;
+      case 6: stream_encrypt_block<Rounds, 6>(key, in, out); break;
+      default: stream_encrypt_block<Rounds, 8>(key, in, out); break;
+    }
+  }
+
+  template <class Rounds>
+  void stream_decrypt(const aes::CompactKey &key, const aes::byte *in, aes::byte *out) {
+    switch (key.Nk) {
+      case 4: stream_decrypt_block<Rounds, 4>(key, in, out); break;
+      case 6: stream_decrypt_block<Rounds, 6>(key, in, out); break;
+      default: stream_decrypt_block<Rounds, 8>(key, in, out); break;
+    }
+  }
+
+  // The bitsliced engine only has a bulk form, a single block is a batch of one
+  void bitslice_encrypt_block(const aes::KeySchedule &schedule, const aes::byte *in, aes::byte *out) {
+    bitslice::encrypt_blocks(schedule, in, out, 1);
+  }
+
+  void bitslice_decrypt_block(const aes::KeySchedule &schedule, const aes::byte *in, aes::byte *out) {
+    bitslice::decrypt_blocks(schedule, in, out, 1);
+  }
+
+  // no_cache_lookup_state resolves the S-box with pshufb, the only SSSE3 instruction it needs
+  auto lookup_supported() -> bool {
+    return vperm::supported();
+  }
+
+  // The bitslice and table engines, their compact keys and the key expansion they rely on use no instruction past SSE2
+  auto always_supported() -> bool {
+    return true;
+  }
+
+  // The registry, in order of preference: the first supported constant-time engine is the default
+  auto build_engines() -> std::vector<aes::engine> {
+    return {
+        {"aesni", "AES-NI, SSSE3", true, aesni::PIPELINE_BLOCKS, aesni::supported,
+         {aesni::encrypt_block<10>, aesni::encrypt_block<12>, aesni::encrypt_block<14>},
+         {aesni::decrypt_block<10>, aesni::decrypt_block<12>, aesni::decrypt_block<14>},
+         aesni::encrypt_blocks, aesni::decrypt_blocks, aesni::encrypt, aesni::decrypt, aesni::encrypt_compact, aesni::decrypt_compact,
+         {aesni::encrypt_multi<10>, aesni::encrypt_multi<12>, aesni::encrypt_multi<14>},
+         {aesni::decrypt_multi<10>, aesni::decrypt_multi<12>, aesni::decrypt_multi<14>}},
+        {"vperm", "SSSE3", true, 1, lookup_supported,
+         {vperm::encrypt_block<10>, vperm::encrypt_block<12>, vperm::encrypt_block<14>},
+         {vperm::decrypt_block<10>, vperm::decrypt_block<12>, vperm::decrypt_block<14>},
+         nullptr, nullptr, vperm::encrypt, vperm::decrypt, stream_encrypt<portable_rounds>, stream_decrypt<portable_rounds>,
+         {}, {}},
+        {"no_cache_lookup", "SSSE3", true, 1, lookup_supported,
+         {portable_rounds::encrypt_block<10>, portable_rounds::encrypt_block<12>, portable_rounds::encrypt_block<14>},
+         {portable_rounds::decrypt_block<10>, portable_rounds::decrypt_block<12>, portable_rounds::decrypt_block<14>},
+         nullptr, nullptr, nullptr, nullptr, stream_encrypt<portable_rounds>, stream_decrypt<portable_rounds>,
+         {}, {}},
+        {"bitslice", "none", true, bitslice::BLOCKS_PER_BATCH, always_supported,
+         {bitslice_encrypt_block, bitslice_encrypt_block, bitslice_encrypt_block},
+         {bitslice_decrypt_block, bitslice_decrypt_block, bitslice_decrypt_block},
+         bitslice::encrypt_blocks, bitslice::decrypt_blocks, nullptr, nullptr, stream_encrypt<fallback_rounds>, stream_decrypt<fallback_rounds>,
+         {}, {}},
+        {"table", "none", false, 1, always_supported,
+         {table_rounds::encrypt_block<10>, table_rounds::encrypt_block<12>, table_rounds::encrypt_block<14>},
+         {table_rounds::decrypt_block<10>, table_rounds::decrypt_block<12>, table_rounds::decrypt_block<14>},
+         nullptr, nullptr, nullptr, nullptr, stream_encrypt<table_rounds>, stream_decrypt<table_rounds>,
+         {}, {}},
+    };
+  }
+
+  auto default_engine() -> const aes::engine * {
+    for (const aes::engine &candidate : aes::engines()) {
+      if (candidate.constant_time && candidate.supported()) {
+        return &candidate;
+      }
+    }
+    return &aes::engines().back();
+  }
+
+  // The engine every entry point dispatches to, replaced by set_engine
+  auto active_slot() -> const aes::engine *& {
+    static const aes::engine *active = default_engine();
+    return active;
+  }
+
+  auto round_index(unsigned int Nr) -> std::size_t {
+    return (Nr - 10U) / 2U;
+  }
+
+  // aes::state is stored row after row, a block column after column
+  auto state_to_block(const aes::state &state) -> std::array<aes::byte, 16> {
+    std::array<aes::byte, 16> block{};
+    for (std::size_t c = 0; c < aes::NB; c++) {
+      for (std::size_t r = 0; r < 4; r++) {
+        block.at(4 * c + r) = state[r][c];
+      }
+    }
+    return block;
+  }
+
+  void block_to_state(const std::array<aes::byte, 16> &block, aes::state &state) {
+    for (std::size_t c = 0; c < aes::NB; c++) {
+      for (std::size_t r = 0; r < 4; r++) {
+        state[r][c] = block.at(4 * c + r);
+      }
+    }
+  }
+
+  // Runs a state through a block routine of the engine, for engines that have no state form
+  void run_state_as_block(unsigned int Nr, aes::state &state, const std::vector<aes::word> &w, bool decryption) {
+    const aes::KeySchedule schedule(Nr, w);
+    const aes::engine &engine = aes::active_engine();
+    std::array<aes::byte, 16> block = state_to_block(state);
+    (decryption ? engine.decrypt_block : engine.encrypt_block).at(round_index(Nr))(schedule, block.data(), block.data());
+    block_to_state(block, state);
+  }
+
+  // Runs the key expansion recurrence for KEY_EXPANSION_LANES keys of Nk words, word i of key k is lane k of a register
+  void expand_lanes(const std::array<const aes::byte *, aes::KEY_EXPANSION_LANES> &keys, unsigned int Nk,
+                    const std::array<aes::word *, aes::KEY_EXPANSION_LANES> &w) {
+    const unsigned int word_count = aes::NB * (Nk + 7);
+    alignas(16) std::array<aes::word, aes::KEY_EXPANSION_LANES> lanes{};
+    alignas(16) std::array<aes::byte, 16 * aes::NB * (aes::MAX_NR + 1)> word_bytes{};
+    auto *words = reinterpret_cast<__m128i *>(word_bytes.data());
+
+    //the first Nk words of the expanded key are filled with the cipher key
+    for (unsigned int i = 0; i < Nk; i++) {
+      for (std::size_t lane = 0; lane < lanes.size(); lane++) {
+        const aes::byte *key = keys.at(lane) + 4 * i;
+        lanes.at(lane) = aes::buildWord(key[0], key[1], key[2], key[3]);
+      }
+      _mm_store_si128(words + i, _mm_load_si128(reinterpret_cast<const __m128i *>(lanes.data())));
+    }
+
+    for (unsigned int i = Nk; i < word_count; i++) {
+      __m128i temp = _mm_load_si128(words + i - 1);
+      if (i % Nk == 0 || (Nk > 6 && i % Nk == 4)) {
+        //SubWord is bytewise, so the four words are substituted by one batched lookup whatever their byte order
+        alignas(16) std::array<aes::byte, 16> bytes{};
+        _mm_store_si128(reinterpret_cast<__m128i *>(bytes.data()), temp);
+        substitute_key_bytes(bytes.data());
+        temp = _mm_load_si128(reinterpret_cast<const __m128i *>(bytes.data()));
+      }
+      if (i % Nk == 0) {
+        //RotWord rotates every lane left by one byte, then the round constant is added
+        temp = _mm_or_si128(_mm_slli_epi32(temp, 8), _mm_srli_epi32(temp, 24));
+        temp = _mm_xor_si128(temp, _mm_set1_epi32(static_cast<int>(aes::Rcon.at(i / Nk))));
+      }
+      _mm_store_si128(words + i, _mm_xor_si128(_mm_load_si128(words + i - Nk), temp));
+    }
+
+    //every lane holds one key, write them out key after key
+    for (unsigned int i = 0; i < word_count; i++) {
+      _mm_store_si128(reinterpret_cast<__m128i *>(lanes.data()), _mm_load_si128(words + i));
+      for (std::size_t lane = 0; lane < lanes.size(); lane++) {
+        w.at(lane)[i] = lanes.at(lane);
+      }
+    }
+  }
+  // Hands the blocks of every round count to a multi-key engine, gathering them first when the round counts are mixed
+  template <class Engine>
+  void run_multi(const std::vector<const aes::KeySchedule *> &schedules, const aes::byte *in, aes::byte *out, Engine engine) {
+    if (schedules.empty()) {
+      return;
+    }
+    const unsigned int first_Nr = schedules.front()->Nr;
+    if (std::all_of(schedules.begin(), schedules.end(), [first_Nr](const aes::KeySchedule *schedule) { return schedule->Nr == first_Nr; })) {
+      engine(first_Nr, schedules.data(), in, out, schedules.size());
+      return;
+    }
+
+    for (unsigned int Nr : {10U, 12U, 14U}) {
+      std::vector<std::size_t> members;
+      for (std::size_t k = 0; k < schedules.size(); k++) {
+        if (schedules[k]->Nr == Nr) {
+          members.push_back(k);
+        }
+      }
+      if (members.empty()) {
+        continue;
+      }
+
+      std::vector<const aes::KeySchedule *> group(members.size());
+      std::vector<aes::byte> blocks(16 * members.size());
+      for (std::size_t i = 0; i < members.size(); i++) {
+        group[i] = schedules[members[i]];
+        std::copy(in + 16 * members[i], in + 16 * (members[i] + 1), blocks.begin() + 16 * i);
+      }
+      engine(Nr, group.data(), blocks.data(), blocks.data(), members.size());
+      for (std::size_t i = 0; i < members.size(); i++) {
+        std::copy(blocks.begin() + 16 * i, blocks.begin() + 16 * (i + 1), out + 16 * members[i]);
+      }
+    }
+  }
+} // namespace
+
+void aes::swap_bytes(state &state, const std::array<byte, 256> &sub_source) {
+  //the state is a contiguous 4x4 matrix, so all 16 bytes are substituted by one call
+  no_cache_lookup_state(state[0].data(), sub_source.data());
 }
 
 void aes::sub_bytes(state &state) { swap_bytes(state, S_BOX); }
@@ -70,48 +578,13 @@ void aes::inv_shift_rows(state &state) {
 }
 
 auto aes::field_multiply_by_2(byte s) -> aes::byte {
-  byte result = s;
-  byte sig_bit = s >> 7U;
-  byte xorByte;
-
-  //if the byte has most significant bit of 0 XORING with 0x1B is not needed so we XOR with 0x00 to maintain same number of operations
-  if (sig_bit == 0x00) {
-    xorByte=0x00U;
-  } 
-  else {
-    xorByte=0x1BU;
-  }
-  byte shifted = s<<1U; 
-  result =shifted ^ xorByte;
-  return result;
+  //the reduction by 0x1B is masked in rather than branched on, so the operation is constant time
+  return gf256::xtime(s);
 }
 
 auto aes::field_multiply(byte s, uint8_t num) -> aes::byte {
-
-  byte result = s;
-  std::vector<int> multiplication_order;
-  
-  //converts the num into a sequence of additions and multiplications by 2
-  //EX: 11 = 1+2(1+2(2)) so 11s = (2(2(2s)+s)+s
-  while (num > 1) {
-    if (num % 2 == 1) {
-      multiplication_order.push_back(1);
-    }
-    multiplication_order.push_back(2);
-    num = num / 2;
-  }
-
-  //traverse the representation created above backwards since that is the correct order
-  for (auto i = static_cast<int64_t>(multiplication_order.size() - 1); i >= 0;
-       i--) {
-    if (multiplication_order[i] == 2) {
-      result = field_multiply_by_2(result);
-    } 
-    else if (multiplication_order[i] == 1) {
-      result = result ^ s;
-    }
-  }
-  return result;
+  //shift-and-add over all 8 bits of num, without allocating or branching on either operand
+  return gf256::multiply(s, num);
 }
 
 void aes::mix_columns(state &state) {
@@ -153,28 +626,28 @@ void aes::inv_mix_columns(state &state) {
     byte s3 = state[3][c];
 
     //multiplies all the bytes in the current column by x^3+1 (0x09)
-    byte s0_mult9 = field_multiply(s0, 9U);
-    byte s1_mult9 = field_multiply(s1, 9U);
-    byte s2_mult9 = field_multiply(s2, 9U);
-    byte s3_mult9 = field_multiply(s3, 9U);
+    byte s0_mult9 = gf256::mul9(s0);
+    byte s1_mult9 = gf256::mul9(s1);
+    byte s2_mult9 = gf256::mul9(s2);
+    byte s3_mult9 = gf256::mul9(s3);
 
     //multiplies all the bytes in the current column by x^3+x+1 (0x0b)
-    byte s0_multB = field_multiply(s0, 0xbU);
-    byte s1_multB = field_multiply(s1, 0xbU);
-    byte s2_multB = field_multiply(s2, 0xbU);
-    byte s3_multB = field_multiply(s3, 0xbU);
+    byte s0_multB = gf256::mulb(s0);
+    byte s1_multB = gf256::mulb(s1);
+    byte s2_multB = gf256::mulb(s2);
+    byte s3_multB = gf256::mulb(s3);
     
     //multiplies all the bytes in the current column by x^3+x^2+1 (0x0d)
-    byte s0_multD = field_multiply(s0, 0xdU);
-    byte s1_multD = field_multiply(s1, 0xdU);
-    byte s2_multD = field_multiply(s2, 0xdU);
-    byte s3_multD = field_multiply(s3, 0xdU);
+    byte s0_multD = gf256::muld(s0);
+    byte s1_multD = gf256::muld(s1);
+    byte s2_multD = gf256::muld(s2);
+    byte s3_multD = gf256::muld(s3);
     
     //multiplies all the bytes in the current column by x^3+x^2+x (0x0e)
-    byte s0_multE = field_multiply(s0, 0xeU);
-    byte s1_multE = field_multiply(s1, 0xeU);
-    byte s2_multE = field_multiply(s2, 0xeU);
-    byte s3_multE = field_multiply(s3, 0xeU);
+    byte s0_multE = gf256::mule(s0);
+    byte s1_multE = gf256::mule(s1);
+    byte s2_multE = gf256::mule(s2);
+    byte s3_multE = gf256::mule(s3);
 
     //collumn vector resulting from multiplying current column with the matrix specified in AES standard
     state[0][c] = static_cast<byte>(s0_multE ^ s1_multB) ^
@@ -199,6 +672,35 @@ void aes::add_round_key(state &currState, state &roundKeyValue) {
   }
 }
 
+void aes::mix_columns_sse(state &state) {
+  store_rows(state, mix_rows(load_rows(state)));
+}
+
+void aes::inv_mix_columns_sse(state &state) {
+  //InvMixColumns is MixColumns after adding 4(a_r ^ a_(r+2)) to every byte
+  const __m128i rows = load_rows(state);
+  const __m128i u = gf256::xtime_state(gf256::xtime_state(_mm_xor_si128(rows, _mm_shuffle_epi32(rows, 0x4e))));
+  store_rows(state, mix_rows(_mm_xor_si128(rows, u)));
+}
+
+void aes::mix_columns_pair(state &first, state &second) {
+  if (USE_AVX2) {
+    avx2::mix_columns(first, second);
+  } else {
+    mix_columns_sse(first);
+    mix_columns_sse(second);
+  }
+}
+
+void aes::inv_mix_columns_pair(state &first, state &second) {
+  if (USE_AVX2) {
+    avx2::inv_mix_columns(first, second);
+  } else {
+    inv_mix_columns_sse(first);
+    inv_mix_columns_sse(second);
+  }
+}
+
 auto aes::splitWord(word word) -> std::array<byte, 4> {
   std::array<byte, 4> split{};
   split[0] = (word & 0xff000000UL) >> 24U;
@@ -222,14 +724,11 @@ auto aes::rotword(word word) -> aes::word {
 auto aes::subword(word word) -> aes::word {
   
   auto split = splitWord(word);
-  auto *sbox_ptr = S_BOX.data();
- //applies the Sbox to each byte of an input word to produce an output word
-  byte b1 = no_cache_lookup(split[0] & 0xF0U, split[0] & 0xFU, sbox_ptr);
-  byte b2 = no_cache_lookup(split[1] & 0xF0U, split[1] & 0xFU, sbox_ptr);
-  byte b3 = no_cache_lookup(split[2] & 0xF0U, split[2] & 0xFU, sbox_ptr);
-  byte b4 = no_cache_lookup(split[3] & 0xF0U, split[3] & 0xFU, sbox_ptr);
+  std::array<byte, 16> bytes = {split[0], split[1], split[2], split[3]};
+  //applies the Sbox to each byte of an input word to produce an output word, the unused 12 bytes are substituted as well
+  substitute_key_bytes(bytes.data());
 
-  return buildWord(b1, b2, b3, b4);
+  return buildWord(bytes[0], bytes[1], bytes[2], bytes[3]);
 }
 
 auto aes::get_Nk_Nr(int keySize) -> std::array<int, 2> {
@@ -251,7 +750,15 @@ auto aes::get_Nk_Nr(int keySize) -> std::array<int, 2> {
   return nk_nr;
 }
 
-void aes::key_expansion(std::vector<byte> keyBytes, std::vector<word> &w, unsigned int Nk, unsigned int Nr) {
+void aes::key_expansion(const std::vector<byte> &keyBytes, std::vector<word> &w, unsigned int Nk, unsigned int Nr) {
+  if (USE_AESNI) {
+    aesni::key_expansion(keyBytes.data(), Nk, w.data());
+  } else {
+    key_expansion_portable(keyBytes, w, Nk, Nr);
+  }
+}
+
+void aes::key_expansion_portable(const std::vector<byte> &keyBytes, std::vector<word> &w, unsigned int Nk, unsigned int Nr) {
   word temp = -1;
   unsigned int i = 0;
 
@@ -280,6 +787,41 @@ void aes::key_expansion(std::vector<byte> keyBytes, std::vector<word> &w, unsign
   }
 }
 
+auto aes::expand_keys(const std::vector<std::vector<byte>> &keys) -> std::vector<KeySchedule> {
+  std::vector<std::vector<word>> expanded(keys.size());
+  std::array<std::vector<std::size_t>, 3> by_size; // indices of the 128, 192 and 256 bit keys
+  for (std::size_t k = 0; k < keys.size(); k++) {
+    std::array<int, 2> nk_nr = get_Nk_Nr(static_cast<int>(keys[k].size()));
+    expanded[k].resize(NB * (nk_nr[1] + 1));
+    if (USE_AESNI) {
+      aesni::key_expansion(keys[k].data(), nk_nr[0], expanded[k].data());
+    } else {
+      by_size.at((nk_nr[0] - 4) / 2).push_back(k);
+    }
+  }
+
+  for (const std::vector<std::size_t> &group : by_size) {
+    for (std::size_t first = 0; first < group.size(); first += KEY_EXPANSION_LANES) {
+      std::array<const byte *, KEY_EXPANSION_LANES> lane_keys{};
+      std::array<word *, KEY_EXPANSION_LANES> lane_words{};
+      for (std::size_t lane = 0; lane < KEY_EXPANSION_LANES; lane++) {
+        //lanes past the end of the group repeat its last key
+        std::size_t k = group[std::min(first + lane, group.size() - 1)];
+        lane_keys.at(lane) = keys[k].data();
+        lane_words.at(lane) = expanded[k].data();
+      }
+      expand_lanes(lane_keys, static_cast<unsigned int>(keys[group[first]].size() / 4), lane_words);
+    }
+  }
+
+  std::vector<KeySchedule> schedules;
+  schedules.reserve(keys.size());
+  for (const std::vector<word> &w : expanded) {
+    schedules.emplace_back(static_cast<unsigned int>(w.size() / NB - 1), w);
+  }
+  return schedules;
+}
+
 auto aes::spliceKey(unsigned int round, const std::vector<word> &key) -> aes::state {
   state roundKey;
   for (std::size_t i = 0; i < 4; i++) {
@@ -297,6 +839,249 @@ auto aes::spliceKey(unsigned int round, const std::vector<word> &key) -> aes::st
 }
 
 void aes::encrypt(unsigned int Nr, state &state, const std::vector<word> &w) {
+  const engine &active = active_engine();
+  if (active.encrypt_state != nullptr) {
+    active.encrypt_state(Nr, state, w);
+  } else {
+    run_state_as_block(Nr, state, w, false);
+  }
+}
+
+void aes::decrypt(unsigned int Nr, state &state, const std::vector<word> &w) {
+  const engine &active = active_engine();
+  if (active.decrypt_state != nullptr) {
+    active.decrypt_state(Nr, state, w);
+  } else {
+    run_state_as_block(Nr, state, w, true);
+  }
+}
+
+aes::KeySchedule::KeySchedule(const std::vector<byte> &key_bytes)
+    : KeySchedule(static_cast<unsigned int>(get_Nk_Nr(static_cast<int>(key_bytes.size()))[1]), expand_key(key_bytes)) {}
+
+aes::KeySchedule::KeySchedule(unsigned int Nr, const std::vector<word> &w) : Nr(Nr), encryption_words(), decryption_words(), encryption_blocks(), decryption_blocks() {
+  for (std::size_t round = 0; round <= Nr; round++) {
+    //decryption walks the rounds backwards
+    std::size_t inverse_round = Nr - round;
+    for (std::size_t c = 0; c < NB; c++) {
+      word key_word = w[NB * round + c];
+
+      //equivalent inverse cipher: InvMixColumns is applied once to the middle round keys instead of to the state every round
+      word inverse_key_word = (round == 0 || round == Nr) ? key_word : inv_mix_column_word(key_word);
+      encryption_words.at(NB * round + c) = key_word;
+      decryption_words.at(NB * inverse_round + c) = inverse_key_word;
+
+      //the first byte of a word is its most significant one
+      std::array<byte, 4> bytes = splitWord(key_word);
+      std::copy(bytes.begin(), bytes.end(), encryption_blocks.begin() + 16 * round + 4 * c);
+      bytes = splitWord(inverse_key_word);
+      std::copy(bytes.begin(), bytes.end(), decryption_blocks.begin() + 16 * inverse_round + 4 * c);
+    }
+  }
+}
+
+aes::CompactKey::CompactKey(const std::vector<byte> &key_bytes) : Nk(static_cast<unsigned int>(get_Nk_Nr(static_cast<int>(key_bytes.size()))[0])), key(), last_key() {
+  std::copy(key_bytes.begin(), key_bytes.end(), key.begin());
+
+  //the schedule is only expanded here, to keep its end, and is cleared once that has been copied
+  std::vector<word> w = expand_key(key_bytes);
+  for (std::size_t k = 0; k < Nk; k++) {
+    std::array<byte, 4> bytes = splitWord(w[w.size() - Nk + k]);
+    std::copy(bytes.begin(), bytes.end(), last_key.begin() + 4 * k);
+  }
+  zeroize(w.data(), w.size() * sizeof(word));
+}
+
+auto aes::load_columns(const byte *block) -> aes::column_state {
+  column_state state{};
+  for (std::size_t c = 0; c < NB; c++) {
+    state.columns[c] = buildWord(block[4 * c], block[4 * c + 1], block[4 * c + 2], block[4 * c + 3]);
+  }
+  return state;
+}
+
+void aes::store_columns(const column_state &state, byte *block) {
+  for (std::size_t c = 0; c < NB; c++) {
+    std::array<byte, 4> column = splitWord(state.columns[c]);
+    std::copy(column.begin(), column.end(), block + 4 * c);
+  }
+}
+
+void aes::fused_round(column_state &state, const word *round_key) {
+  portable_rounds::round(state, round_key);
+}
+
+void aes::fused_final_round(column_state &state, const word *round_key) {
+  portable_rounds::final_round(state, round_key);
+}
+
+void aes::inv_fused_round(column_state &state, const word *round_key) {
+  portable_rounds::inv_round(state, round_key);
+}
+
+void aes::inv_fused_final_round(column_state &state, const word *round_key) {
+  portable_rounds::inv_final_round(state, round_key);
+}
+
+template <unsigned int Nr>
+void aes::encrypt_columns(column_state &state, const KeySchedule &schedule) {
+  portable_rounds::encrypt<Nr>(state, schedule);
+}
+
+template <unsigned int Nr>
+void aes::decrypt_columns(column_state &state, const KeySchedule &schedule) {
+  portable_rounds::decrypt<Nr>(state, schedule);
+}
+
+template void aes::encrypt_columns<10>(column_state &state, const KeySchedule &schedule);
+template void aes::encrypt_columns<12>(column_state &state, const KeySchedule &schedule);
+template void aes::encrypt_columns<14>(column_state &state, const KeySchedule &schedule);
+template void aes::decrypt_columns<10>(column_state &state, const KeySchedule &schedule);
+template void aes::decrypt_columns<12>(column_state &state, const KeySchedule &schedule);
+template void aes::decrypt_columns<14>(column_state &state, const KeySchedule &schedule);
+
+void aes::encrypt_columns(column_state &state, const KeySchedule &schedule) {
+  switch (schedule.Nr) {
+    case 10: encrypt_columns<10>(state, schedule); break;
+    case 12: encrypt_columns<12>(state, schedule); break;
+    default: encrypt_columns<14>(state, schedule); break;
+  }
+}
+
+void aes::decrypt_columns(column_state &state, const KeySchedule &schedule) {
+  switch (schedule.Nr) {
+    case 10: decrypt_columns<10>(state, schedule); break;
+    case 12: decrypt_columns<12>(state, schedule); break;
+    default: decrypt_columns<14>(state, schedule); break;
+  }
+}
+
+auto aes::engines() -> const std::vector<engine> & {
+  static const std::vector<engine> registry = build_engines();
+  return registry;
+}
+
+auto aes::find_engine(const std::string &name) -> const engine * {
+  for (const engine &candidate : engines()) {
+    if (name == candidate.name) {
+      return &candidate;
+    }
+  }
+  return nullptr;
+}
+
+void aes::set_engine(const std::string &name) {
+  const engine *chosen = find_engine(name);
+  if (chosen == nullptr) {
+    throw aes_error(("Unknown AES engine: " + name + "\n").c_str());
+  }
+  if (!chosen->supported()) {
+    throw aes_error(("AES engine " + name + " needs " + chosen->requirements + ", which this processor does not support\n").c_str());
+  }
+  active_slot() = chosen;
+}
+
+auto aes::active_engine() -> const engine & {
+  return *active_slot();
+}
+
+auto aes::select_encrypt_block(const KeySchedule &schedule) -> block_function {
+  return active_engine().encrypt_block.at(round_index(schedule.Nr));
+}
+
+auto aes::select_decrypt_block(const KeySchedule &schedule) -> block_function {
+  return active_engine().decrypt_block.at(round_index(schedule.Nr));
+}
+
+void aes::encrypt_block(const KeySchedule &schedule, const byte *in, byte *out) {
+  select_encrypt_block(schedule)(schedule, in, out);
+}
+
+void aes::decrypt_block(const KeySchedule &schedule, const byte *in, byte *out) {
+  select_decrypt_block(schedule)(schedule, in, out);
+}
+
+void aes::encrypt_block(const CompactKey &key, const byte *in, byte *out) {
+  active_engine().encrypt_compact(key, in, out);
+}
+
+void aes::decrypt_block(const CompactKey &key, const byte *in, byte *out) {
+  active_engine().decrypt_compact(key, in, out);
+}
+
+void aes::encrypt(const CompactKey &key, state &state) {
+  std::array<byte, 16> block = state_to_block(state);
+  encrypt_block(key, block.data(), block.data());
+  block_to_state(block, state);
+}
+
+void aes::decrypt(const CompactKey &key, state &state) {
+  std::array<byte, 16> block = state_to_block(state);
+  decrypt_block(key, block.data(), block.data());
+  block_to_state(block, state);
+}
+
+void aes::encrypt_blocks(const KeySchedule &schedule, const byte *in, byte *out, std::size_t block_count) {
+  const engine &active = active_engine();
+  if (active.encrypt_blocks != nullptr) {
+    active.encrypt_blocks(schedule, in, out, block_count);
+    return;
+  }
+
+  //engines without a bulk form go block by block
+  const block_function encrypt_one = active.encrypt_block.at(round_index(schedule.Nr));
+  for (std::size_t k = 0; k < block_count; k++) {
+    encrypt_one(schedule, in + 16 * k, out + 16 * k);
+  }
+}
+
+void aes::decrypt_blocks(const KeySchedule &schedule, const byte *in, byte *out, std::size_t block_count) {
+  const engine &active = active_engine();
+  if (active.decrypt_blocks != nullptr) {
+    active.decrypt_blocks(schedule, in, out, block_count);
+    return;
+  }
+
+  const block_function decrypt_one = active.decrypt_block.at(round_index(schedule.Nr));
+  for (std::size_t k = 0; k < block_count; k++) {
+    decrypt_one(schedule, in + 16 * k, out + 16 * k);
+  }
+}
+
+void aes::encrypt_multi(const std::vector<const KeySchedule *> &schedules, const byte *in, byte *out) {
+  const engine &active = active_engine();
+  run_multi(schedules, in, out, [&active](unsigned int Nr, const KeySchedule *const *group, const byte *blocks_in, byte *blocks_out, std::size_t count) {
+    const multi_function encrypt_group = active.encrypt_multi.at(round_index(Nr));
+    if (encrypt_group != nullptr) {
+      encrypt_group(group, blocks_in, blocks_out, count);
+      return;
+    }
+
+    //engines without a multi-key form take the blocks one at a time
+    const block_function encrypt_one = active.encrypt_block.at(round_index(Nr));
+    for (std::size_t k = 0; k < count; k++) {
+      encrypt_one(*group[k], blocks_in + 16 * k, blocks_out + 16 * k);
+    }
+  });
+}
+
+void aes::decrypt_multi(const std::vector<const KeySchedule *> &schedules, const byte *in, byte *out) {
+  const engine &active = active_engine();
+  run_multi(schedules, in, out, [&active](unsigned int Nr, const KeySchedule *const *group, const byte *blocks_in, byte *blocks_out, std::size_t count) {
+    const multi_function decrypt_group = active.decrypt_multi.at(round_index(Nr));
+    if (decrypt_group != nullptr) {
+      decrypt_group(group, blocks_in, blocks_out, count);
+      return;
+    }
+
+    const block_function decrypt_one = active.decrypt_block.at(round_index(Nr));
+    for (std::size_t k = 0; k < count; k++) {
+      decrypt_one(*group[k], blocks_in + 16 * k, blocks_out + 16 * k);
+    }
+  });
+}
+
+void aes::encrypt_portable(unsigned int Nr, state &state, const std::vector<word> &w) {
 
   //Performs an AddRoundkey before the 10,12, or 14 rounds of AES
   aes::state roundKey = spliceKey(0, w);
@@ -318,7 +1103,7 @@ void aes::encrypt(unsigned int Nr, state &state, const std::vector<word> &w) {
   add_round_key(state, roundKey);
 }
 
-void aes::decrypt(unsigned int Nr, state &state, const std::vector<word> &w) {
+void aes::decrypt_portable(unsigned int Nr, state &state, const std::vector<word> &w) {
   
   //reverses the last round of AES
   aes::state roundKey = spliceKey(Nr, w);
@@ -341,148 +1126,6 @@ void aes::decrypt(unsigned int Nr, state &state, const std::vector<word> &w) {
 }
 
 
-auto aes::get_most_sig_bit(byte s) -> uint8_t {
-  uint8_t sig_bit = 0U;
-  for (uint8_t i = 0U; i < 8U; i++) {
-    byte temp = s >> i;
-    if (temp == 1U) { //doesnt not break from for loop in order to keep constant time for any input
-      sig_bit = i;
-    }
-  }
-  return sig_bit;
-}
-
-
-auto aes::get_inverse(byte s) -> byte {
-  return extended_euclidean_algorithm(0x1bU, s, 8U)[1];
-}
-
-//NOTE: larger element MUST be left since there is no way to represent x^8+x^4+x^3+x+1 in 8 bits so first step has left as byte 0x1b with sig bit set to 8 to account for this
-auto aes::extended_euclidean_algorithm(byte left, byte right, uint8_t sigbit)
-    -> std::array<byte, 2> {
-  
-  //0(0x00) does not have an inverse in the finite field 2^8	    
-  if (right == 0U) {
-    std::array<byte, 2> result = {0U, 0U};
-    return result;
-  }
-
-  //base case of recursion.If the right element is 1 return r=0, t=1
-  if (right == 1U) {
-    std::array<byte, 2> result = {0U, 1U};
-    return result;
-  }
-  
-  //performs long division between left and right until the most significant bit of the remainder is strictly less than most significant bit of right 
-  //This is not constant time. Execution depends entirely on the difference between the positions of the most significant bytes of left and right
-  uint8_t quotient = 0U;
-  uint8_t quotient_sig_bit = get_most_sig_bit(right);
-  uint8_t diff = sigbit - quotient_sig_bit;
-  quotient += 1U << diff;
-  uint8_t remainder = left ^ (right << diff); // NOLINT(hicpp-signed-bitwise)
-  uint8_t temp_bit = get_most_sig_bit(remainder);
-  while (quotient_sig_bit <= temp_bit) {
-    diff = temp_bit - quotient_sig_bit;
-    remainder = remainder ^ (right << diff); // NOLINT(hicpp-signed-bitwise)
-    quotient += 1U << diff;
-    temp_bit = get_most_sig_bit(remainder);
-  }
-
-  //Handles the case where left and right have a gcd greater than 1. Does not come into play in this application since we are interested only in inverses modulo x^8+x^4+x^3+x+1
-  if (remainder == 0U) {
-    std::array<byte, 2> result = {0U, 1U};
-    return result;
-  }
-
-  //recursive call with right as the new left and the remainder as the new right
-  //Another part that causes algorithm to not be constant time. Number of recursive calls dependent on input bytes
-  std::array<byte, 2> rt = extended_euclidean_algorithm(right, remainder, quotient_sig_bit);
-  
-  //Performs the reverse of the Euclidean Algorithm to get r and t such that r*left + t*right = gcd(left,right)
-  byte r = rt[1];
-
-  //Another part that causes algorithm to not be constant time. Execution time of field_multiply is dependent on what quotient is
-  byte temp = field_multiply(rt[1], quotient); 
-  byte t = temp ^ rt[0];
-  std::array<byte, 2> result = {r, t};
-  return result;
-}
-
-auto aes::get_S_BOX_value(byte s) -> byte {
-
-  byte inverse = get_inverse(s);
-  
-  //Since there is no bit data type, we calculate the bits by masking the inverse and then shifting the mask so that first bit of new byte corresponds to the bit in position i
-  byte b0 = inverse & 1U;
-  byte b1 = (inverse & 2U) >> 1U;
-  byte b2 = (inverse & 4U) >> 2U;
-  byte b3 = (inverse & 8U) >> 3U;
-  byte b4 = (inverse & 16U) >> 4U;
-  byte b5 = (inverse & 32U) >> 5U;
-  byte b6 = (inverse & 64U) >> 6U;
-  byte b7 = (inverse & 128U) >> 7U;
-  
-  //Performs matrix multiplication specified in SubBytes section of AES standard document
-  byte b_prime0 = b0 ^ b4 ^ b5 ^ b6 ^ b7; // NOLINT(hicpp-signed-bitwise)
-  byte b_prime1 = b0 ^ b1 ^ b5 ^ b6 ^ b7; // NOLINT(hicpp-signed-bitwise)
-  byte b_prime2 = b0 ^ b1 ^ b2 ^ b6 ^ b7; // NOLINT(hicpp-signed-bitwise)
-  byte b_prime3 = b0 ^ b1 ^ b2 ^ b3 ^ b7; // NOLINT(hicpp-signed-bitwise)
-  byte b_prime4 = b0 ^ b1 ^ b2 ^ b3 ^ b4; // NOLINT(hicpp-signed-bitwise)
-  byte b_prime5 = b1 ^ b2 ^ b3 ^ b4 ^ b5; // NOLINT(hicpp-signed-bitwise)
-  byte b_prime6 = b2 ^ b3 ^ b4 ^ b5 ^ b6; // NOLINT(hicpp-signed-bitwise)
-  byte b_prime7 = b3 ^ b4 ^ b5 ^ b6 ^ b7; // NOLINT(hicpp-signed-bitwise)
-  
-  //rebuilds the byte
-  byte temp = b_prime0;
-  temp ^= (b_prime1 << 1U); // NOLINT(hicpp-signed-bitwise)
-  temp ^= (b_prime2 << 2U); // NOLINT(hicpp-signed-bitwise)
-  temp ^= (b_prime3 << 3U); // NOLINT(hicpp-signed-bitwise)
-  temp ^= (b_prime4 << 4U); // NOLINT(hicpp-signed-bitwise)
-  temp ^= (b_prime5 << 5U); // NOLINT(hicpp-signed-bitwise)
-  temp ^= (b_prime6 << 6U); // NOLINT(hicpp-signed-bitwise)
-  temp ^= (b_prime7 << 7U); // NOLINT(hicpp-signed-bitwise)
-  
-  byte result = temp ^ 0x63U;
-  return result;
-}
-
-auto aes::get_inverse_S_BOX_value(byte s) -> byte {
-  byte temp = s ^ 0x63U;
-
-  //Since there is no bit data type, we calculate the bits by masking the inverse and then shifting the mask so that first bit of new byte corresponds to the bit in position i
-  byte b0 = temp & 1U;
-  byte b1 = (temp & 2U) >> 1U;
-  byte b2 = (temp & 4U) >> 2U;
-  byte b3 = (temp & 8U) >> 3U;
-  byte b4 = (temp & 16U) >> 4U;
-  byte b5 = (temp & 32U) >> 5U;
-  byte b6 = (temp & 64U) >> 6U;
-  byte b7 = (temp & 128U) >> 7U;
-  
-  //Performs matrix multiplication specified in InvSubBytes section of AES standard document
-  byte b_prime0 = b2 ^ (b5 ^ b7); // NOLINT(hicpp-signed-bitwise)
-  byte b_prime1 = (b0 ^ b3) ^ b6; // NOLINT(hicpp-signed-bitwise)
-  byte b_prime2 = (b1 ^ b4) ^ b7; // NOLINT(hicpp-signed-bitwise)
-  byte b_prime3 = (b0 ^ b2) ^ b5; // NOLINT(hicpp-signed-bitwise)
-  byte b_prime4 = (b1 ^ b3) ^ b6; // NOLINT(hicpp-signed-bitwise)
-  byte b_prime5 = (b2 ^ b4) ^ b7; // NOLINT(hicpp-signed-bitwise)
-  byte b_prime6 = (b0 ^ b3) ^ b5; // NOLINT(hicpp-signed-bitwise)
-  byte b_prime7 = (b1 ^ b4) ^ b6; // NOLINT(hicpp-signed-bitwise)
-  
-  //Rebuilds the byte
-  temp = b_prime0;
-  temp ^= b_prime1 << 1U; // NOLINT(hicpp-signed-bitwise)
-  temp ^= b_prime2 << 2U; // NOLINT(hicpp-signed-bitwise)
-  temp ^= b_prime3 << 3U; // NOLINT(hicpp-signed-bitwise)
-  temp ^= b_prime4 << 4U; // NOLINT(hicpp-signed-bitwise)
-  temp ^= b_prime5 << 5U; // NOLINT(hicpp-signed-bitwise)
-  temp ^= b_prime6 << 6U; // NOLINT(hicpp-signed-bitwise)
-  temp ^= b_prime7 << 7U; // NOLINT(hicpp-signed-bitwise)
-  
-  byte result = get_inverse(temp);
-  return result;
-}
-
 void aes::debug_print_state(const state &state) {
   for (const auto &row : state) {
     for (byte val : row) {
@@ -0,0 +1,512 @@
+#include "aesni.hpp"
+#include "yandom.hpp"
+#include <algorithm>
+#include <tmmintrin.h> // SSSE3 (pshufb)
+#include <utility>
+#include <wmmintrin.h> // AES-NI
+
+namespace {
+    static_assert(sizeof(aes::state) == 16, "aes::state must be a contiguous 16 byte matrix");
+
+    // aes::state is stored row after row while the hardware operates on the column-major block, this shuffle
+    // transposes the 4x4 matrix (it is its own inverse, so it is used for both loading and storing)
+    auto transpose_mask() -> __m128i {
+        return _mm_setr_epi8(0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15);
+    }
+
+    // Words of the key schedule hold their first byte in the most significant position, this shuffle
+    // reverses every 32-bit lane so that a round key is in block order once loaded
+    auto word_swap_mask() -> __m128i {
+        return _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    }
+
+    auto load_state(const aes::state& state) -> __m128i {
+        return _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(state.data())), transpose_mask());
+    }
+
+    void store_state(aes::state& state, __m128i block) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(state.data()), _mm_shuffle_epi8(block, transpose_mask()));
+    }
+
+    auto load_round_key(const std::vector<aes::word>& w, unsigned int round) -> __m128i {
+        return _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&w[4 * round])), word_swap_mask());
+    }
+
+    // XORs every word of the register with all the words below it, the prefix XOR of the key expansion recurrence
+    auto prefix_xor(__m128i words) -> __m128i {
+        words = _mm_xor_si128(words, _mm_slli_si128(words, 4));
+        words = _mm_xor_si128(words, _mm_slli_si128(words, 4));
+        return _mm_xor_si128(words, _mm_slli_si128(words, 4));
+    }
+
+    // aeskeygenassist of x computes SubWord(x1), RotWord(SubWord(x1)) ^ rcon, SubWord(x3), RotWord(SubWord(x3)) ^ rcon;
+    // the steps below broadcast the term the recurrence needs and add it to the next Nk words
+    auto expand_128(__m128i previous, __m128i assist) -> __m128i {
+        return _mm_xor_si128(prefix_xor(previous), _mm_shuffle_epi32(assist, 0xff));
+    }
+
+    // AES-256 words 8k + 4 .. 8k + 7 only apply SubWord (no rotation, no rcon) to the word before them
+    auto expand_256_odd(__m128i previous, __m128i even) -> __m128i {
+        return _mm_xor_si128(prefix_xor(previous), _mm_shuffle_epi32(_mm_aeskeygenassist_si128(even, 0x00), 0xaa));
+    }
+
+    // AES-192 produces six words per step: four in low, two in the lower half of high
+    void expand_192(__m128i& low, __m128i& high, __m128i assist) {
+        low = _mm_xor_si128(prefix_xor(low), _mm_shuffle_epi32(assist, 0x55));
+        __m128i carry = _mm_shuffle_epi32(low, 0xff);
+        high = _mm_xor_si128(_mm_xor_si128(high, _mm_slli_si128(high, 4)), carry);
+    }
+
+    // Stores round keys, which are in block order, as the big-endian words of aes::key_expansion
+    void store_words(const std::array<aes::byte, 16 * (aes::MAX_NR + 1)>& expanded, std::size_t word_count, aes::word* w) {
+        for (std::size_t i = 0; i < word_count; i += 4) {
+            const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&expanded.at(4 * i)));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(&w[i]), _mm_shuffle_epi8(bytes, word_swap_mask()));
+        }
+    }
+
+    // Runs the cipher on a block that is already in column-major order, with the round keys in block order.
+    // Round is the sequence 0 .. Nr - 2, so the fold expression unrolls the Nr - 1 full rounds at compile time.
+    template <unsigned int Nr, std::size_t... Round>
+    auto encrypt_register(__m128i block, const __m128i* round_keys, std::index_sequence<Round...> /*rounds*/) -> __m128i {
+        //Performs an AddRoundkey before the 10,12, or 14 rounds of AES
+        block = _mm_xor_si128(block, _mm_load_si128(&round_keys[0]));
+
+        //a single aesenc performs SubBytes, ShiftRows, MixColumns and AddRoundKey
+        ((block = _mm_aesenc_si128(block, _mm_load_si128(&round_keys[Round + 1]))), ...);
+
+        //the last round omits mix columns
+        return _mm_aesenclast_si128(block, _mm_load_si128(&round_keys[Nr]));
+    }
+
+    // The decryption round keys are in the order they are consumed, last round key first
+    template <unsigned int Nr, std::size_t... Round>
+    auto decrypt_register(__m128i block, const __m128i* round_keys, std::index_sequence<Round...> /*rounds*/) -> __m128i {
+        //reverses the last round key
+        block = _mm_xor_si128(block, _mm_load_si128(&round_keys[0]));
+
+        //aesdec implements the equivalent inverse cipher, the middle round keys already have InvMixColumns applied
+        ((block = _mm_aesdec_si128(block, _mm_load_si128(&round_keys[Round + 1]))), ...);
+
+        //reverses the first round, which has no mix columns
+        return _mm_aesdeclast_si128(block, _mm_load_si128(&round_keys[Nr]));
+    }
+
+    template <unsigned int Nr>
+    auto encrypt_register(__m128i block, const __m128i* round_keys) -> __m128i {
+        return encrypt_register<Nr>(block, round_keys, std::make_index_sequence<Nr - 1>{});
+    }
+
+    template <unsigned int Nr>
+    auto decrypt_register(__m128i block, const __m128i* round_keys) -> __m128i {
+        return decrypt_register<Nr>(block, round_keys, std::make_index_sequence<Nr - 1>{});
+    }
+
+    auto encrypt_register(unsigned int Nr, __m128i block, const __m128i* round_keys) -> __m128i {
+        switch (Nr) {
+            case 10: return encrypt_register<10>(block, round_keys);
+            case 12: return encrypt_register<12>(block, round_keys);
+            default: return encrypt_register<14>(block, round_keys);
+        }
+    }
+
+    auto decrypt_register(unsigned int Nr, __m128i block, const __m128i* round_keys) -> __m128i {
+        switch (Nr) {
+            case 10: return decrypt_register<10>(block, round_keys);
+            case 12: return decrypt_register<12>(block, round_keys);
+            default: return decrypt_register<14>(block, round_keys);
+        }
+    }
+
+    auto schedule_keys(const std::array<aes::byte, 16 * (aes::MAX_NR + 1)>& blocks) -> const __m128i* {
+        return reinterpret_cast<const __m128i*>(blocks.data());
+    }
+
+    // Round keys of a key expanded into words, in encryption order
+    void load_round_keys(unsigned int Nr, const std::vector<aes::word>& w, std::array<aes::byte, 16 * (aes::MAX_NR + 1)>& blocks) {
+        auto* round_keys = reinterpret_cast<__m128i*>(blocks.data());
+        for (unsigned int i = 0; i <= Nr; i++) {
+            _mm_store_si128(round_keys + i, load_round_key(w, i));
+        }
+    }
+
+    // Round keys of the equivalent inverse cipher, in the order decrypt_register consumes them
+    void load_inverse_round_keys(unsigned int Nr, const std::vector<aes::word>& w, std::array<aes::byte, 16 * (aes::MAX_NR + 1)>& blocks) {
+        auto* round_keys = reinterpret_cast<__m128i*>(blocks.data());
+        _mm_store_si128(round_keys, load_round_key(w, Nr));
+        for (unsigned int i = 1; i < Nr; i++) {
+            _mm_store_si128(round_keys + i, _mm_aesimc_si128(load_round_key(w, Nr - i)));
+        }
+        _mm_store_si128(round_keys + Nr, load_round_key(w, 0));
+    }
+    // Lane blocks share one key: each round key is loaded once and fed to every lane, the aesenc of the lanes are
+    // independent so they issue back to back instead of waiting for the latency of the previous round
+    template <bool Decryption, unsigned int Nr, std::size_t... Lane>
+    void pipeline_lanes(const __m128i* round_keys, const aes::byte* in, aes::byte* out, std::index_sequence<Lane...> /*lanes*/) {
+        const __m128i first_key = _mm_load_si128(round_keys);
+        __m128i blocks[] = {_mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 16 * Lane)), first_key)...};
+        for (unsigned int round = 1; round < Nr; round++) {
+            const __m128i key = _mm_load_si128(round_keys + round);
+            if (Decryption) {
+                ((blocks[Lane] = _mm_aesdec_si128(blocks[Lane], key)), ...);
+            }
+            else {
+                ((blocks[Lane] = _mm_aesenc_si128(blocks[Lane], key)), ...);
+            }
+        }
+        const __m128i last_key = _mm_load_si128(round_keys + Nr);
+        if (Decryption) {
+            ((blocks[Lane] = _mm_aesdeclast_si128(blocks[Lane], last_key)), ...);
+        }
+        else {
+            ((blocks[Lane] = _mm_aesenclast_si128(blocks[Lane], last_key)), ...);
+        }
+        (_mm_storeu_si128(reinterpret_cast<__m128i*>(out + 16 * Lane), blocks[Lane]), ...);
+    }
+
+    template <bool Decryption, unsigned int Nr>
+    void run_pipeline(const __m128i* round_keys, const aes::byte* in, aes::byte* out, std::size_t block_count) {
+        std::size_t done = 0;
+        for (; done + aesni::PIPELINE_BLOCKS <= block_count; done += aesni::PIPELINE_BLOCKS) {
+            pipeline_lanes<Decryption, Nr>(round_keys, in + 16 * done, out + 16 * done, std::make_index_sequence<aesni::PIPELINE_BLOCKS>{});
+        }
+        if (done + aesni::PIPELINE_BLOCKS / 2 <= block_count) {
+            pipeline_lanes<Decryption, Nr>(round_keys, in + 16 * done, out + 16 * done, std::make_index_sequence<aesni::PIPELINE_BLOCKS / 2>{});
+            done += aesni::PIPELINE_BLOCKS / 2;
+        }
+        for (; done < block_count; done++) {
+            pipeline_lanes<Decryption, Nr>(round_keys, in + 16 * done, out + 16 * done, std::make_index_sequence<1>{});
+        }
+    }
+
+    // One round of every lane back to back: the blocks are independent, so each aesenc issues while the others are in flight.
+    // A partial batch repeats its last block in the unused lanes, so that every lane holds valid data, and stores only batch blocks
+    template <bool Decryption, unsigned int Nr, std::size_t... Lane>
+    void run_lanes(const aes::KeySchedule* const* schedules, const aes::byte* in, aes::byte* out, std::size_t batch,
+                   std::index_sequence<Lane...> /*lanes*/) {
+        const std::size_t last = batch - 1;
+        const __m128i* keys[] = {schedule_keys(Decryption ? schedules[std::min(Lane, last)]->decryption_blocks
+                                                          : schedules[std::min(Lane, last)]->encryption_blocks)...};
+        __m128i blocks[] = {_mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 16 * std::min(Lane, last))),
+                                          _mm_load_si128(keys[Lane]))...};
+        for (unsigned int round = 1; round < Nr; round++) {
+            if (Decryption) {
+                ((blocks[Lane] = _mm_aesdec_si128(blocks[Lane], _mm_load_si128(keys[Lane] + round))), ...);
+            }
+            else {
+                ((blocks[Lane] = _mm_aesenc_si128(blocks[Lane], _mm_load_si128(keys[Lane] + round))), ...);
+            }
+        }
+        if (Decryption) {
+            ((blocks[Lane] = _mm_aesdeclast_si128(blocks[Lane], _mm_load_si128(keys[Lane] + Nr))), ...);
+        }
+        else {
+            ((blocks[Lane] = _mm_aesenclast_si128(blocks[Lane], _mm_load_si128(keys[Lane] + Nr))), ...);
+        }
+        ((Lane < batch ? _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 16 * Lane), blocks[Lane]) : void()), ...);
+    }
+
+    template <bool Decryption, unsigned int Nr>
+    void run_multi(const aes::KeySchedule* const* schedules, const aes::byte* in, aes::byte* out, std::size_t block_count) {
+        for (std::size_t done = 0; done < block_count; done += aesni::MULTI_LANES) {
+            run_lanes<Decryption, Nr>(schedules + done, in + 16 * done, out + 16 * done,
+                                      std::min(aesni::MULTI_LANES, block_count - done), std::make_index_sequence<aesni::MULTI_LANES>{});
+        }
+    }
+
+    constexpr const std::array<int, 10> RCON = {0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1b, 0x36};
+
+    // aeskeygenassist with the round constant as a template argument, an immediate even in unoptimized builds
+    template <int Rcon>
+    auto keygen_assist(__m128i words) -> __m128i {
+        return _mm_aeskeygenassist_si128(words, Rcon);
+    }
+
+    // Undoes prefix_xor on words 1 .. 3, word 0 is left holding its term of the recurrence
+    auto unchain(__m128i words) -> __m128i {
+        return _mm_xor_si128(words, _mm_slli_si128(words, 4));
+    }
+
+    auto first_word(__m128i words) -> __m128i {
+        return _mm_and_si128(words, _mm_setr_epi32(-1, 0, 0, 0));
+    }
+
+    // Words 2 and 3 of low followed by words 0 and 1 of high
+    auto middle_words(__m128i low, __m128i high) -> __m128i {
+        return _mm_castpd_si128(_mm_shuffle_pd(_mm_castsi128_pd(low), _mm_castsi128_pd(high), 1));
+    }
+
+    // Inverse of expand_128: the Nk words before key, assist being the aeskeygenassist of the words that produced it
+    auto previous_128(__m128i key, __m128i assist) -> __m128i {
+        return _mm_xor_si128(unchain(key), first_word(_mm_shuffle_epi32(assist, 0xff)));
+    }
+
+    // Inverse of expand_256_odd, even being the round key generated between the two
+    auto previous_256_odd(__m128i odd, __m128i even) -> __m128i {
+        return _mm_xor_si128(unchain(odd), first_word(_mm_shuffle_epi32(_mm_aeskeygenassist_si128(even, 0x00), 0xaa)));
+    }
+
+    // The generators below hand the round keys of a cipher key to use(round_key) one at a time, in order from the first
+    // round key or backwards from the last one. aeskeygenassist takes the round constant as an immediate, so every step is
+    // a fold over a compile-time index, the rounds using each key can then run as soon as it exists
+    template <class Use, std::size_t... Step>
+    void forward_128(__m128i key, Use& use, std::index_sequence<Step...> /*steps*/) {
+        use(key);
+        ((key = expand_128(key, keygen_assist<RCON[Step]>(key)), use(key)), ...);
+    }
+
+    template <class Use, std::size_t... Step>
+    void backward_128(__m128i key, Use& use, std::index_sequence<Step...> /*steps*/) {
+        use(key);
+        ((key = previous_128(key, keygen_assist<RCON[9 - Step]>(unchain(key))), use(key)), ...);
+    }
+
+    // AES-192 steps produce six words, so the round keys straddle them: a pair of steps yields three round keys
+    template <std::size_t Pair, class Use>
+    void forward_192_pair(__m128i& low, __m128i& high, Use& use) {
+        const __m128i previous_high = high;
+        expand_192(low, high, keygen_assist<RCON[2 * Pair]>(high));
+        use(_mm_unpacklo_epi64(previous_high, low));
+        use(middle_words(low, high));
+        expand_192(low, high, keygen_assist<RCON[2 * Pair + 1]>(high));
+        use(low);
+    }
+
+    // Inverse of the high half of expand_192, low being the words of the same step
+    auto previous_192_high(__m128i high, __m128i low) -> __m128i {
+        return _mm_xor_si128(unchain(high), first_word(_mm_shuffle_epi32(low, 0xff)));
+    }
+
+    // Inverse of the low half of expand_192, high being the words of the step before
+    template <int Rcon>
+    auto previous_192_low(__m128i low, __m128i high) -> __m128i {
+        return _mm_xor_si128(unchain(low), first_word(_mm_shuffle_epi32(keygen_assist<Rcon>(high), 0x55)));
+    }
+
+    // Starts from the low words of step 2 * Pair + 2 and the high words of step 2 * Pair + 1, ends on those of steps
+    // 2 * Pair and 2 * Pair - 1
+    template <std::size_t Pair, class Use>
+    void backward_192_pair(__m128i& low, __m128i& high, Use& use) {
+        low = previous_192_low<RCON[2 * Pair + 1]>(low, high);
+        use(middle_words(low, high));
+        high = previous_192_high(high, low);
+        use(_mm_unpacklo_epi64(high, low));
+        low = previous_192_low<RCON[2 * Pair]>(low, high);
+        use(low);
+        if (Pair > 0) {
+            high = previous_192_high(high, low);
+        }
+    }
+
+    template <class Use, std::size_t... Pair>
+    void forward_192(__m128i low, __m128i high, Use& use, std::index_sequence<Pair...> /*pairs*/) {
+        use(low);
+        (forward_192_pair<Pair>(low, high, use), ...);
+    }
+
+    template <class Use, std::size_t... Pair>
+    void backward_192(__m128i low, __m128i high, Use& use, std::index_sequence<Pair...> /*pairs*/) {
+        use(low);
+        (backward_192_pair<sizeof...(Pair) - 1 - Pair>(low, high, use), ...);
+    }
+
+    // AES-256 alternates the rotated step (low) and the SubWord-only step (high), the last step only has the former
+    template <class Use, std::size_t... Step>
+    void forward_256(__m128i low, __m128i high, Use& use, std::index_sequence<Step...> /*steps*/) {
+        use(low);
+        use(high);
+        ((low = expand_128(low, keygen_assist<RCON[Step]>(high)), use(low), high = expand_256_odd(high, low), use(high)), ...);
+        low = expand_128(low, keygen_assist<RCON[sizeof...(Step)]>(high));
+        use(low);
+    }
+
+    // Starts from the last two round keys, the high words of step 6 and the low words of step 7
+    template <class Use, std::size_t... Step>
+    void backward_256(__m128i low, __m128i high, Use& use, std::index_sequence<Step...> /*steps*/) {
+        use(low);
+        use(high);
+        ((low = previous_128(low, keygen_assist<RCON[sizeof...(Step) - Step]>(high)), use(low),
+          high = previous_256_odd(high, low), use(high)), ...);
+        low = previous_128(low, keygen_assist<RCON[0]>(high));
+        use(low);
+    }
+
+    // Hands the Nr + 1 round keys of a cipher key to use, first round key first
+    template <class Use>
+    void forward_round_keys(const aes::byte* key_bytes, unsigned int Nk, Use&& use) {
+        const __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(key_bytes));
+        if (Nk == 4) {
+            forward_128(low, use, std::make_index_sequence<10>{});
+        } else if (Nk == 6) {
+            //the last two key words are in the lower half of high, its upper half is ignored
+            forward_192(low, _mm_loadl_epi64(reinterpret_cast<const __m128i*>(key_bytes + 16)), use, std::make_index_sequence<4>{});
+        } else {
+            forward_256(low, _mm_loadu_si128(reinterpret_cast<const __m128i*>(key_bytes + 16)), use, std::make_index_sequence<6>{});
+        }
+    }
+
+    // Hands the Nr + 1 round keys to use, last round key first, from the last Nk words of the schedule (CompactKey::last_key)
+    template <class Use>
+    void backward_round_keys(const aes::byte* last_key, unsigned int Nk, Use&& use) {
+        if (Nk == 4) {
+            backward_128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(last_key)), use, std::make_index_sequence<10>{});
+        } else if (Nk == 6) {
+            //words 46 and 47 end step 7, words 48 .. 51 are the last round key
+            backward_192(_mm_loadu_si128(reinterpret_cast<const __m128i*>(last_key + 8)), _mm_loadl_epi64(reinterpret_cast<const __m128i*>(last_key)),
+                         use, std::make_index_sequence<4>{});
+        } else {
+            backward_256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(last_key + 16)), _mm_loadu_si128(reinterpret_cast<const __m128i*>(last_key)),
+                         use, std::make_index_sequence<6>{});
+        }
+    }
+} // namespace
+
+auto aesni::supported() -> bool {
+    static const bool has_aesni = []() {
+        std::array<unsigned int, 4> cpu_info{};
+        cpuid(cpu_info.data(), 1);
+
+        // Both feature bits are reported in ECX of leaf 1
+        return (cpu_info[2] & AESNI_FLAG) != 0 && (cpu_info[2] & SSSE3_FLAG) != 0;
+    }();
+    return has_aesni;
+}
+
+void aesni::encrypt(unsigned int Nr, aes::state& state, const std::vector<aes::word>& w) {
+    alignas(16) std::array<aes::byte, 16 * (aes::MAX_NR + 1)> round_keys{};
+    load_round_keys(Nr, w, round_keys);
+    store_state(state, encrypt_register(Nr, load_state(state), schedule_keys(round_keys)));
+}
+
+void aesni::decrypt(unsigned int Nr, aes::state& state, const std::vector<aes::word>& w) {
+    alignas(16) std::array<aes::byte, 16 * (aes::MAX_NR + 1)> round_keys{};
+    load_inverse_round_keys(Nr, w, round_keys);
+    store_state(state, decrypt_register(Nr, load_state(state), schedule_keys(round_keys)));
+}
+
+void aesni::encrypt_block(const aes::KeySchedule& schedule, const aes::byte* in, aes::byte* out) {
+    const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), encrypt_register(schedule.Nr, block, schedule_keys(schedule.encryption_blocks)));
+}
+
+void aesni::decrypt_block(const aes::KeySchedule& schedule, const aes::byte* in, aes::byte* out) {
+    const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), decrypt_register(schedule.Nr, block, schedule_keys(schedule.decryption_blocks)));
+}
+
+void aesni::key_expansion(const aes::byte* key_bytes, unsigned int Nk, aes::word* w) {
+    std::array<aes::byte, 16 * (aes::MAX_NR + 1)> expanded{};
+    std::size_t offset = 0;
+    forward_round_keys(key_bytes, Nk, [&](__m128i round_key) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&expanded.at(offset)), round_key);
+        offset += 16;
+    });
+    store_words(expanded, aes::NB * (Nk + 7), w);
+}
+
+void aesni::encrypt_compact(const aes::CompactKey& key, const aes::byte* in, aes::byte* out) {
+    const unsigned int Nr = key.Nk + 6;
+    __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+
+    //every round runs as soon as its key has been generated, the schedule is never written out
+    unsigned int round = 0;
+    forward_round_keys(key.key.data(), key.Nk, [&](__m128i round_key) {
+        if (round == 0) {
+            block = _mm_xor_si128(block, round_key);
+        } else if (round < Nr) {
+            block = _mm_aesenc_si128(block, round_key);
+        } else {
+            block = _mm_aesenclast_si128(block, round_key);
+        }
+        round++;
+    });
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), block);
+}
+
+void aesni::decrypt_compact(const aes::CompactKey& key, const aes::byte* in, aes::byte* out) {
+    const unsigned int Nr = key.Nk + 6;
+    __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+
+    //the keys are regenerated backwards from the end of the schedule, in the order the equivalent inverse cipher uses them
+    unsigned int round = 0;
+    backward_round_keys(key.last_key.data(), key.Nk, [&](__m128i round_key) {
+        if (round == 0) {
+            block = _mm_xor_si128(block, round_key);
+        } else if (round < Nr) {
+            block = _mm_aesdec_si128(block, _mm_aesimc_si128(round_key));
+        } else {
+            block = _mm_aesdeclast_si128(block, round_key);
+        }
+        round++;
+    });
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), block);
+}
+
+template <unsigned int Nr>
+void aesni::encrypt_block(const aes::KeySchedule& schedule, const aes::byte* in, aes::byte* out) {
+    const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), encrypt_register<Nr>(block, schedule_keys(schedule.encryption_blocks)));
+}
+
+template <unsigned int Nr>
+void aesni::decrypt_block(const aes::KeySchedule& schedule, const aes::byte* in, aes::byte* out) {
+    const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), decrypt_register<Nr>(block, schedule_keys(schedule.decryption_blocks)));
+}
+
+template void aesni::encrypt_block<10>(const aes::KeySchedule& schedule, const aes::byte* in, aes::byte* out);
+template void aesni::encrypt_block<12>(const aes::KeySchedule& schedule, const aes::byte* in, aes::byte* out);
+template void aesni::encrypt_block<14>(const aes::KeySchedule& schedule, const aes::byte* in, aes::byte* out);
+template void aesni::decrypt_block<10>(const aes::KeySchedule& schedule, const aes::byte* in, aes::byte* out);
+template void aesni::decrypt_block<12>(const aes::KeySchedule& schedule, const aes::byte* in, aes::byte* out);
+template void aesni::decrypt_block<14>(const aes::KeySchedule& schedule, const aes::byte* in, aes::byte* out);
+
+template <unsigned int Nr>
+void aesni::encrypt_blocks(const aes::KeySchedule& schedule, const aes::byte* in, aes::byte* out, std::size_t block_count) {
+    run_pipeline<false, Nr>(schedule_keys(schedule.encryption_blocks), in, out, block_count);
+}
+
+template <unsigned int Nr>
+void aesni::decrypt_blocks(const aes::KeySchedule& schedule, const aes::byte* in, aes::byte* out, std::size_t block_count) {
+    run_pipeline<true, Nr>(schedule_keys(schedule.decryption_blocks), in, out, block_count);
+}
+
+template void aesni::encrypt_blocks<10>(const aes::KeySchedule& schedule, const aes::byte* in, aes::byte* out, std::size_t block_count);
+template void aesni::encrypt_blocks<12>(const aes::KeySchedule& schedule, const aes::byte* in, aes::byte* out, std::size_t block_count);
+template void aesni::encrypt_blocks<14>(const aes::KeySchedule& schedule, const aes::byte* in, aes::byte* out, std::size_t block_count);
+template void aesni::decrypt_blocks<10>(const aes::KeySchedule& schedule, const aes::byte* in, aes::byte* out, std::size_t block_count);
+template void aesni::decrypt_blocks<12>(const aes::KeySchedule& schedule, const aes::byte* in, aes::byte* out, std::size_t block_count);
+template void aesni::decrypt_blocks<14>(const aes::KeySchedule& schedule, const aes::byte* in, aes::byte* out, std::size_t block_count);
+
+void aesni::encrypt_blocks(const aes::KeySchedule& schedule, const aes::byte* in, aes::byte* out, std::size_t block_count) {
+    switch (schedule.Nr) {
+        case 10: encrypt_blocks<10>(schedule, in, out, block_count); break;
+        case 12: encrypt_blocks<12>(schedule, in, out, block_count); break;
+        default: encrypt_blocks<14>(schedule, in, out, block_count); break;
+    }
+}
+
+void aesni::decrypt_blocks(const aes::KeySchedule& schedule, const aes::byte* in, aes::byte* out, std::size_t block_count) {
+    switch (schedule.Nr) {
+        case 10: decrypt_blocks<10>(schedule, in, out, block_count); break;
+        case 12: decrypt_blocks<12>(schedule, in, out, block_count); break;
+        default: decrypt_blocks<14>(schedule, in, out, block_count); break;
+    }
+}
+
+template <unsigned int Nr>
+void aesni::encrypt_multi(const aes::KeySchedule* const* schedules, const aes::byte* in, aes::byte* out, std::size_t block_count) {
+    run_multi<false, Nr>(schedules, in, out, block_count);
+}
+
+template <unsigned int Nr>
+void aesni::decrypt_multi(const aes::KeySchedule* const* schedules, const aes::byte* in, aes::byte* out, std::size_t block_count) {
+    run_multi<true, Nr>(schedules, in, out, block_count);
+}
+
+template void aesni::encrypt_multi<10>(const aes::KeySchedule* const* schedules, const aes::byte* in, aes::byte* out, std::size_t block_count);
+template void aesni::encrypt_multi<12>(const aes::KeySchedule* const* schedules, const aes::byte* in, aes::byte* out, std::size_t block_count);
+template void aesni::encrypt_multi<14>(const aes::KeySchedule* const* schedules, const aes::byte* in, aes::byte* out, std::size_t block_count);
+template void aesni::decrypt_multi<10>(const aes::KeySchedule* const* schedules, const aes::byte* in, aes::byte* out, std::size_t block_count);
+template void aesni::decrypt_multi<12>(const aes::KeySchedule* const* schedules, const aes::byte* in, aes::byte* out, std::size_t block_count);
+template void aesni::decrypt_multi<14>(const aes::KeySchedule* const* schedules, const aes::byte* in, aes::byte* out, std::size_t block_count);
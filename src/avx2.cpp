@@ -0,0 +1,54 @@
+#include "avx2.hpp"
+#include "yandom.hpp"
+#include <immintrin.h> // AVX2, XGETBV
+
+namespace {
+    static_assert(sizeof(aes::state) == 16, "aes::state must be a contiguous 16 byte matrix");
+
+    auto load_states(const aes::state& first, const aes::state& second) -> __m256i {
+        return _mm256_loadu2_m128i(reinterpret_cast<const __m128i*>(second.data()), reinterpret_cast<const __m128i*>(first.data()));
+    }
+
+    void store_states(aes::state& first, aes::state& second, __m256i states) {
+        _mm256_storeu2_m128i(reinterpret_cast<__m128i*>(second.data()), reinterpret_cast<__m128i*>(first.data()), states);
+    }
+
+    // Same layout as the SSE kernels: every 32-bit lane is one row of a state, so a row rotation is a lane shuffle
+    auto xtime(__m256i states) -> __m256i {
+        const __m256i overflow = _mm256_cmpgt_epi8(_mm256_setzero_si256(), states);
+        return _mm256_xor_si256(_mm256_add_epi8(states, states), _mm256_and_si256(overflow, _mm256_set1_epi8(0x1b)));
+    }
+
+    auto mix(__m256i states) -> __m256i {
+        const __m256i rotated = _mm256_shuffle_epi32(states, 0x39); // row r + 1
+        const __m256i t = _mm256_xor_si256(states, rotated);
+        return _mm256_xor_si256(_mm256_xor_si256(xtime(t), rotated), _mm256_shuffle_epi32(t, 0x4e)); // t of row r + 2
+    }
+} // namespace
+
+auto avx2::supported() -> bool {
+    static const bool has_avx2 = []() {
+        std::array<unsigned int, 4> cpu_info{};
+        cpuid(cpu_info.data(), 1);
+        if ((cpu_info[2] & OSXSAVE_FLAG) == 0) {
+            return false;
+        }
+        if ((_xgetbv(0) & XCR0_AVX_STATE) != XCR0_AVX_STATE) {
+            return false;
+        }
+        cpuid(cpu_info.data(), 7);
+        return (cpu_info[1] & AVX2_FLAG) != 0;
+    }();
+    return has_avx2;
+}
+
+void avx2::mix_columns(aes::state& first, aes::state& second) {
+    store_states(first, second, mix(load_states(first, second)));
+}
+
+void avx2::inv_mix_columns(aes::state& first, aes::state& second) {
+    //InvMixColumns is MixColumns after adding 4(a_r ^ a_(r+2)) to every byte
+    const __m256i states = load_states(first, second);
+    const __m256i u = xtime(xtime(_mm256_xor_si256(states, _mm256_shuffle_epi32(states, 0x4e))));
+    store_states(first, second, mix(_mm256_xor_si256(states, u)));
+}
@@ -0,0 +1,375 @@
+#include "bitslice.hpp"
+#include <algorithm>
+
+namespace {
+    using slice = std::array<uint32_t, 8>; // One bitsliced byte: bit-plane b of 32 bytes
+
+    auto rotr(uint32_t value, unsigned int amount) -> uint32_t {
+        amount &= 31U;
+        return (amount == 0U) ? value : (value >> amount) | (value << (32U - amount));
+    }
+
+    // Multiplication by x in GF(2^8) for every lane, 0x1b is folded into planes 0, 1, 3 and 4
+    auto xtime(const slice& x) -> slice {
+        return {x[7], x[0] ^ x[7], x[1], x[2] ^ x[7], x[3] ^ x[7], x[4], x[5], x[6]};
+    }
+
+    auto xor_slices(const slice& a, const slice& b) -> slice {
+        slice result{};
+        for (std::size_t i = 0; i < 8; i++) {
+            result.at(i) = a.at(i) ^ b.at(i);
+        }
+        return result;
+    }
+
+    void add_round_key(bitslice::bitsliced_state& state, const bitslice::bitsliced_state& round_key) {
+        for (std::size_t r = 0; r < aes::NB; r++) {
+            state.at(r) = xor_slices(state.at(r), round_key.at(r));
+        }
+    }
+
+    void sub_bytes(bitslice::bitsliced_state& state) {
+        for (auto& row : state) {
+            bitslice::sbox(row);
+        }
+    }
+
+    void inv_sub_bytes(bitslice::bitsliced_state& state) {
+        for (auto& row : state) {
+            bitslice::inv_sbox(row);
+        }
+    }
+
+    // Column c of every block lives in bits 8c..8c+7, so rotating row r by r columns is a rotation by 8r bits
+    void shift_rows(bitslice::bitsliced_state& state) {
+        for (unsigned int r = 1; r < aes::NB; r++) {
+            for (auto& plane : state.at(r)) {
+                plane = rotr(plane, 8U * r);
+            }
+        }
+    }
+
+    void inv_shift_rows(bitslice::bitsliced_state& state) {
+        for (unsigned int r = 1; r < aes::NB; r++) {
+            for (auto& plane : state.at(r)) {
+                plane = rotr(plane, 32U - 8U * r);
+            }
+        }
+    }
+
+    // Row r becomes 2*a[r] ^ 3*a[r+1] ^ a[r+2] ^ a[r+3] for every column of every block at once
+    void mix_columns(bitslice::bitsliced_state& state) {
+        const bitslice::bitsliced_state a = state;
+        for (std::size_t r = 0; r < aes::NB; r++) {
+            const slice& a0 = a.at(r);
+            const slice& a1 = a.at((r + 1) % aes::NB);
+            const slice& a2 = a.at((r + 2) % aes::NB);
+            const slice& a3 = a.at((r + 3) % aes::NB);
+            state.at(r) = xor_slices(xor_slices(xtime(xor_slices(a0, a1)), a1), xor_slices(a2, a3));
+        }
+    }
+
+    // InvMixColumns is MixColumns preceded by the matrix {5,0,4,0}: a[r] ^= 4*(a[r] ^ a[r+2])
+    void inv_mix_columns(bitslice::bitsliced_state& state) {
+        const slice u = xtime(xtime(xor_slices(state[0], state[2])));
+        const slice v = xtime(xtime(xor_slices(state[1], state[3])));
+        state[0] = xor_slices(state[0], u);
+        state[1] = xor_slices(state[1], v);
+        state[2] = xor_slices(state[2], u);
+        state[3] = xor_slices(state[3], v);
+        mix_columns(state);
+    }
+
+    /// Bitsliced round keys of the largest schedule, kept on the stack of the call that uses them
+    using round_key_set = std::array<bitslice::bitsliced_state, aes::MAX_NR + 1>;
+
+    // Round keys are shared by every block, each key bit is broadcast to the 8 lanes of its column
+    void expand_round_keys(unsigned int Nr, const aes::word* w, round_key_set& round_keys) {
+        round_keys = {};
+        for (std::size_t round = 0; round <= Nr; round++) {
+            std::array<uint32_t, aes::NB> rows{}; //byte c of rows[r] is row r of column c
+            for (unsigned int c = 0; c < aes::NB; c++) {
+                auto bytes = aes::splitWord(w[aes::NB * round + c]);
+                for (std::size_t r = 0; r < aes::NB; r++) {
+                    rows.at(r) |= static_cast<uint32_t>(bytes.at(r)) << (8U * c);
+                }
+            }
+            //bit b of every column in the low bit of its byte, times 0xFF fills that byte's 8 lanes without carries
+            for (std::size_t r = 0; r < aes::NB; r++) {
+                for (unsigned int b = 0; b < 8; b++) {
+                    round_keys[round].at(r).at(b) = ((rows.at(r) >> b) & 0x01010101U) * 0xFFU;
+                }
+            }
+        }
+    }
+
+    //volatile stores so the compiler cannot drop the clearing of a buffer that is about to go out of scope
+    void wipe_round_keys(round_key_set& round_keys) {
+        for (auto& round_key : round_keys) {
+            for (auto& row : round_key) {
+                for (auto& plane : row) {
+                    *static_cast<volatile uint32_t*>(&plane) = 0;
+                }
+            }
+        }
+    }
+} // namespace
+
+auto bitslice::pack(const aes::byte* blocks, std::size_t block_count) -> bitsliced_state {
+    bitsliced_state state{};
+    for (std::size_t k = 0; k < block_count; k++) {
+        for (unsigned int c = 0; c < aes::NB; c++) {
+            for (std::size_t r = 0; r < aes::NB; r++) {
+                //in AES, a block's contents are populated column after column
+                uint32_t value = blocks[16 * k + 4 * c + r];
+                for (unsigned int b = 0; b < 8; b++) {
+                    state.at(r).at(b) |= ((value >> b) & 1U) << (8U * c + k);
+                }
+            }
+        }
+    }
+    return state;
+}
+
+void bitslice::unpack(const bitsliced_state& state, aes::byte* blocks, std::size_t block_count) {
+    for (std::size_t k = 0; k < block_count; k++) {
+        for (unsigned int c = 0; c < aes::NB; c++) {
+            for (std::size_t r = 0; r < aes::NB; r++) {
+                uint32_t value = 0;
+                for (unsigned int b = 0; b < 8; b++) {
+                    value |= ((state.at(r).at(b) >> (8U * c + k)) & 1U) << b;
+                }
+                blocks[16 * k + 4 * c + r] = static_cast<aes::byte>(value);
+            }
+        }
+    }
+}
+
+/**
+ * Straight translation of the 113 gate circuit from "A new combinational logic minimization technique with
+ * applications to cryptology" by Joan Boyar and René Peralta. Inputs x0..x7 and outputs s0..s7 are numbered from the
+ * most significant bit down, as in the paper.
+ */
+void bitslice::sbox(std::array<uint32_t, 8>& slice) {
+    const uint32_t x0 = slice[7];
+    const uint32_t x1 = slice[6];
+    const uint32_t x2 = slice[5];
+    const uint32_t x3 = slice[4];
+    const uint32_t x4 = slice[3];
+    const uint32_t x5 = slice[2];
+    const uint32_t x6 = slice[1];
+    const uint32_t x7 = slice[0];
+
+    // Top linear transformation
+    const uint32_t y14 = x3 ^ x5;
+    const uint32_t y13 = x0 ^ x6;
+    const uint32_t y9 = x0 ^ x3;
+    const uint32_t y8 = x0 ^ x5;
+    const uint32_t t0 = x1 ^ x2;
+    const uint32_t y1 = t0 ^ x7;
+    const uint32_t y4 = y1 ^ x3;
+    const uint32_t y12 = y13 ^ y14;
+    const uint32_t y2 = y1 ^ x0;
+    const uint32_t y5 = y1 ^ x6;
+    const uint32_t y3 = y5 ^ y8;
+    const uint32_t t1 = x4 ^ y12;
+    const uint32_t y15 = t1 ^ x5;
+    const uint32_t y20 = t1 ^ x1;
+    const uint32_t y6 = y15 ^ x7;
+    const uint32_t y10 = y15 ^ t0;
+    const uint32_t y11 = y20 ^ y9;
+    const uint32_t y7 = x7 ^ y11;
+    const uint32_t y17 = y10 ^ y11;
+    const uint32_t y19 = y10 ^ y8;
+    const uint32_t y16 = t0 ^ y11;
+    const uint32_t y21 = y13 ^ y16;
+    const uint32_t y18 = x0 ^ y16;
+
+    // Shared non-linear section (inversion in GF(2^8))
+    const uint32_t t2 = y12 & y15;
+    const uint32_t t3 = y3 & y6;
+    const uint32_t t4 = t3 ^ t2;
+    const uint32_t t5 = y4 & x7;
+    const uint32_t t6 = t5 ^ t2;
+    const uint32_t t7 = y13 & y16;
+    const uint32_t t8 = y5 & y1;
+    const uint32_t t9 = t8 ^ t7;
+    const uint32_t t10 = y2 & y7;
+    const uint32_t t11 = t10 ^ t7;
+    const uint32_t t12 = y9 & y11;
+    const uint32_t t13 = y14 & y17;
+    const uint32_t t14 = t13 ^ t12;
+    const uint32_t t15 = y8 & y10;
+    const uint32_t t16 = t15 ^ t12;
+    const uint32_t t17 = t4 ^ t14;
+    const uint32_t t18 = t6 ^ t16;
+    const uint32_t t19 = t9 ^ t14;
+    const uint32_t t20 = t11 ^ t16;
+    const uint32_t t21 = t17 ^ y20;
+    const uint32_t t22 = t18 ^ y19;
+    const uint32_t t23 = t19 ^ y21;
+    const uint32_t t24 = t20 ^ y18;
+
+    const uint32_t t25 = t21 ^ t22;
+    const uint32_t t26 = t21 & t23;
+    const uint32_t t27 = t24 ^ t26;
+    const uint32_t t28 = t25 & t27;
+    const uint32_t t29 = t28 ^ t22;
+    const uint32_t t30 = t23 ^ t24;
+    const uint32_t t31 = t22 ^ t26;
+    const uint32_t t32 = t31 & t30;
+    const uint32_t t33 = t32 ^ t24;
+    const uint32_t t34 = t23 ^ t33;
+    const uint32_t t35 = t27 ^ t33;
+    const uint32_t t36 = t24 & t35;
+    const uint32_t t37 = t36 ^ t34;
+    const uint32_t t38 = t27 ^ t36;
+    const uint32_t t39 = t29 & t38;
+    const uint32_t t40 = t25 ^ t39;
+
+    const uint32_t t41 = t40 ^ t37;
+    const uint32_t t42 = t29 ^ t33;
+    const uint32_t t43 = t29 ^ t40;
+    const uint32_t t44 = t33 ^ t37;
+    const uint32_t t45 = t42 ^ t41;
+    const uint32_t z0 = t44 & y15;
+    const uint32_t z1 = t37 & y6;
+    const uint32_t z2 = t33 & x7;
+    const uint32_t z3 = t43 & y16;
+    const uint32_t z4 = t40 & y1;
+    const uint32_t z5 = t29 & y7;
+    const uint32_t z6 = t42 & y11;
+    const uint32_t z7 = t45 & y17;
+    const uint32_t z8 = t41 & y10;
+    const uint32_t z9 = t44 & y12;
+    const uint32_t z10 = t37 & y3;
+    const uint32_t z11 = t33 & y4;
+    const uint32_t z12 = t43 & y13;
+    const uint32_t z13 = t40 & y5;
+    const uint32_t z14 = t29 & y2;
+    const uint32_t z15 = t42 & y9;
+    const uint32_t z16 = t45 & y14;
+    const uint32_t z17 = t41 & y8;
+
+    // Bottom linear transformation, which also applies the affine constant 0x63
+    const uint32_t t46 = z15 ^ z16;
+    const uint32_t t47 = z10 ^ z11;
+    const uint32_t t48 = z5 ^ z13;
+    const uint32_t t49 = z9 ^ z10;
+    const uint32_t t50 = z2 ^ z12;
+    const uint32_t t51 = z2 ^ z5;
+    const uint32_t t52 = z7 ^ z8;
+    const uint32_t t53 = z0 ^ z3;
+    const uint32_t t54 = z6 ^ z7;
+    const uint32_t t55 = z16 ^ z17;
+    const uint32_t t56 = z12 ^ t48;
+    const uint32_t t57 = t50 ^ t53;
+    const uint32_t t58 = z4 ^ t46;
+    const uint32_t t59 = z3 ^ t54;
+    const uint32_t t60 = t46 ^ t57;
+    const uint32_t t61 = z14 ^ t57;
+    const uint32_t t62 = t52 ^ t58;
+    const uint32_t t63 = t49 ^ t58;
+    const uint32_t t64 = z4 ^ t59;
+    const uint32_t t65 = t61 ^ t62;
+    const uint32_t t66 = z1 ^ t63;
+    const uint32_t s0 = t59 ^ t63;
+    const uint32_t s6 = t56 ^ ~t62;
+    const uint32_t s7 = t48 ^ ~t60;
+    const uint32_t t67 = t64 ^ t65;
+    const uint32_t s3 = t53 ^ t66;
+    const uint32_t s4 = t51 ^ t66;
+    const uint32_t s5 = t47 ^ t65;
+    const uint32_t s1 = t64 ^ ~s3;
+    const uint32_t s2 = t55 ^ ~t67;
+
+    slice[7] = s0;
+    slice[6] = s1;
+    slice[5] = s2;
+    slice[4] = s3;
+    slice[3] = s4;
+    slice[2] = s5;
+    slice[1] = s6;
+    slice[0] = s7;
+}
+
+/**
+ * S(x) = A(inv(x)) ^ 0x63, and inversion is an involution, so InvS(x) = B(S(B(x ^ 0x63)) ^ 0x63) where B is the
+ * inverse of the affine matrix A (the same matrix used by aes::get_inverse_S_BOX_value).
+ */
+void bitslice::inv_sbox(std::array<uint32_t, 8>& slice) {
+    auto inverse_affine = [](std::array<uint32_t, 8>& x) {
+        // XOR with 0x63 flips planes 0, 1, 5 and 6
+        const uint32_t b0 = ~x[0];
+        const uint32_t b1 = ~x[1];
+        const uint32_t b2 = x[2];
+        const uint32_t b3 = x[3];
+        const uint32_t b4 = x[4];
+        const uint32_t b5 = ~x[5];
+        const uint32_t b6 = ~x[6];
+        const uint32_t b7 = x[7];
+        x[0] = b2 ^ b5 ^ b7;
+        x[1] = b0 ^ b3 ^ b6;
+        x[2] = b1 ^ b4 ^ b7;
+        x[3] = b0 ^ b2 ^ b5;
+        x[4] = b1 ^ b3 ^ b6;
+        x[5] = b2 ^ b4 ^ b7;
+        x[6] = b0 ^ b3 ^ b5;
+        x[7] = b1 ^ b4 ^ b6;
+    };
+
+    inverse_affine(slice);
+    sbox(slice);
+    inverse_affine(slice);
+}
+
+void bitslice::encrypt_blocks(const aes::KeySchedule& schedule, const aes::byte* in, aes::byte* out, std::size_t block_count) {
+    const unsigned int Nr = schedule.Nr;
+    round_key_set round_keys;
+    expand_round_keys(Nr, schedule.encryption_words.data(), round_keys);
+
+    for (std::size_t done = 0; done < block_count; done += BLOCKS_PER_BATCH) {
+        std::size_t batch = std::min(BLOCKS_PER_BATCH, block_count - done);
+        bitsliced_state state = pack(in + 16 * done, batch);
+
+        add_round_key(state, round_keys[0]);
+        for (std::size_t i = 1; i < Nr; i++) {
+            sub_bytes(state);
+            shift_rows(state);
+            mix_columns(state);
+            add_round_key(state, round_keys[i]);
+        }
+        sub_bytes(state);
+        shift_rows(state);
+        add_round_key(state, round_keys[Nr]);
+
+        unpack(state, out + 16 * done, batch);
+    }
+    wipe_round_keys(round_keys);
+}
+
+void bitslice::decrypt_blocks(const aes::KeySchedule& schedule, const aes::byte* in, aes::byte* out, std::size_t block_count) {
+    const unsigned int Nr = schedule.Nr;
+    //equivalent inverse cipher, the keys are in decryption order and the middle ones already have InvMixColumns applied
+    round_key_set round_keys;
+    expand_round_keys(Nr, schedule.decryption_words.data(), round_keys);
+
+    for (std::size_t done = 0; done < block_count; done += BLOCKS_PER_BATCH) {
+        std::size_t batch = std::min(BLOCKS_PER_BATCH, block_count - done);
+        bitsliced_state state = pack(in + 16 * done, batch);
+
+        add_round_key(state, round_keys[0]);
+        for (std::size_t i = 1; i < Nr; i++) {
+            inv_sub_bytes(state);
+            inv_shift_rows(state);
+            inv_mix_columns(state);
+            add_round_key(state, round_keys[i]);
+        }
+        inv_sub_bytes(state);
+        inv_shift_rows(state);
+        add_round_key(state, round_keys[Nr]);
+
+        unpack(state, out + 16 * done, batch);
+    }
+    wipe_round_keys(round_keys);
+}
@@ -0,0 +1,177 @@
+#include "calibration.hpp"
+#include "aes_exceptions.hpp"
+#include "yandom.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <vector>
+
+namespace {
+    struct cache_entry {
+        std::string cpu;
+        std::string level;
+        std::string engine;
+    };
+
+    auto level_name(bool require_constant_time) -> const char* {
+        return require_constant_time ? "ct" : "any";
+    }
+
+    // Every line that splits into three tab separated fields, anything else is dropped
+    auto read_cache(const std::string& cache_file) -> std::vector<cache_entry> {
+        std::vector<cache_entry> entries;
+        std::ifstream file(cache_file);
+        std::string line;
+        while (file.is_open() && std::getline(file, line)) {
+            const std::size_t first = line.find('\t');
+            const std::size_t second = first == std::string::npos ? std::string::npos : line.find('\t', first + 1);
+            if (second != std::string::npos) {
+                entries.push_back({line.substr(0, first), line.substr(first + 1, second - first - 1), line.substr(second + 1)});
+            }
+        }
+        return entries;
+    }
+
+    void write_cache(const std::string& cache_file, const std::vector<cache_entry>& entries) {
+        std::ofstream file(cache_file, std::ios::out | std::ios::trunc);
+        for (const cache_entry& entry : entries) {
+            file << entry.cpu << '\t' << entry.level << '\t' << entry.engine << '\n';
+        }
+    }
+
+    // The engine a cache entry names, if it still exists, runs here and meets the constant-time level
+    auto usable_engine(const std::string& name, bool require_constant_time) -> const aes::engine* {
+        const aes::engine* engine = aes::find_engine(name);
+        if (engine == nullptr || !engine->supported() || (require_constant_time && !engine->constant_time)) {
+            return nullptr;
+        }
+        return engine;
+    }
+} // namespace
+
+auto calibration::cpu_model() -> const std::string& {
+    static const std::string model = []() {
+        std::array<unsigned int, 4> cpu_info{};
+        cpuid(cpu_info.data(), static_cast<int>(0x80000000U));
+
+        // Leaves 0x80000002 to 0x80000004 hold the 48 byte brand string
+        if (cpu_info[0] >= 0x80000004U) {
+            std::array<char, 49> brand{};
+            for (unsigned int leaf = 0; leaf < 3; leaf++) {
+                cpuid(cpu_info.data(), static_cast<int>(0x80000002U + leaf));
+                std::memcpy(brand.data() + 16 * leaf, cpu_info.data(), 16);
+            }
+            std::string name(brand.data());
+            name.erase(0, name.find_first_not_of(' '));
+            name.erase(name.find_last_not_of(' ') + 1);
+            if (!name.empty()) {
+                return name;
+            }
+        }
+
+        // The vendor string is spread over EBX, EDX and ECX of leaf 0, the signature is EAX of leaf 1
+        cpuid(cpu_info.data(), 0);
+        std::array<char, 13> vendor{};
+        std::memcpy(vendor.data(), &cpu_info[1], 4);
+        std::memcpy(vendor.data() + 4, &cpu_info[3], 4);
+        std::memcpy(vendor.data() + 8, &cpu_info[2], 4);
+        cpuid(cpu_info.data(), 1);
+        std::ostringstream name;
+        name << vendor.data() << " signature 0x" << std::hex << cpu_info[0];
+        return name.str();
+    }();
+    return model;
+}
+
+auto calibration::cache_path() -> std::string {
+    const char* configured = std::getenv("AES_ENGINE_CACHE"); // NOLINT(concurrency-mt-unsafe) read once, before any thread exists
+    if (configured != nullptr && configured[0] != '\0') {
+        return configured;
+    }
+    const char* home = std::getenv("HOME"); // NOLINT(concurrency-mt-unsafe)
+    if (home != nullptr && home[0] != '\0') {
+        return std::string(home) + "/" + CACHE_FILE_NAME;
+    }
+    return CACHE_FILE_NAME;
+}
+
+auto calibration::measure(const aes::engine& engine) -> double {
+    std::vector<aes::byte> key(32);
+    for (std::size_t i = 0; i < key.size(); i++) {
+        key[i] = static_cast<aes::byte>(i);
+    }
+    const aes::KeySchedule schedule(key);
+    std::vector<aes::byte> blocks(16 * CALIBRATION_BLOCKS, 0x5a);
+
+    const std::string previous = aes::active_engine().name;
+    aes::set_engine(engine.name);
+
+    //the first run only brings the code, the tables and the buffer into the caches
+    double best = std::numeric_limits<double>::max();
+    for (unsigned int run = 0; run <= CALIBRATION_RUNS; run++) {
+        auto start = std::chrono::steady_clock::now();
+        aes::encrypt_blocks(schedule, blocks.data(), blocks.data(), CALIBRATION_BLOCKS);
+        aes::decrypt_blocks(schedule, blocks.data(), blocks.data(), CALIBRATION_BLOCKS);
+        auto stop = std::chrono::steady_clock::now();
+        if (run > 0) {
+            best = std::min(best, std::chrono::duration<double, std::nano>(stop - start).count());
+        }
+    }
+
+    aes::set_engine(previous);
+    return best / (2 * CALIBRATION_BLOCKS);
+}
+
+auto calibration::calibrate(bool require_constant_time) -> const aes::engine& {
+    const aes::engine* fastest = nullptr;
+    double fastest_time = std::numeric_limits<double>::max();
+    for (const aes::engine& engine : aes::engines()) {
+        if (!engine.supported() || (require_constant_time && !engine.constant_time)) {
+            continue;
+        }
+        const double time = measure(engine);
+        if (time < fastest_time) {
+            fastest = &engine;
+            fastest_time = time;
+        }
+    }
+
+    //the bitsliced engine needs nothing past SSE2, its keys included (they fall back to the S-box circuit without SSSE3),
+    //so this is only reached by a registry that no longer has it
+    if (fastest == nullptr) {
+        throw aes_error("No AES engine is supported by this processor!\n");
+    }
+    return *fastest;
+}
+
+auto calibration::select_engine(const std::string& cache_file, bool require_constant_time, bool recalibrate) -> const aes::engine& {
+    const std::string& cpu = cpu_model();
+    const std::string level = level_name(require_constant_time);
+    std::vector<cache_entry> entries = read_cache(cache_file);
+
+    auto recorded = std::find_if(entries.begin(), entries.end(), [&](const cache_entry& entry) {
+        return entry.cpu == cpu && entry.level == level;
+    });
+    const aes::engine* engine = nullptr;
+    if (!recalibrate && recorded != entries.end()) {
+        engine = usable_engine(recorded->engine, require_constant_time);
+    }
+
+    //no entry, or one naming an engine this build no longer has
+    if (engine == nullptr) {
+        engine = &calibrate(require_constant_time);
+        if (recorded != entries.end()) {
+            recorded->engine = engine->name;
+        } else {
+            entries.push_back({cpu, level, engine->name});
+        }
+        write_cache(cache_file, entries);
+    }
+
+    aes::set_engine(engine->name);
+    return *engine;
+}
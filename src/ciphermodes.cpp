@@ -1,6 +1,208 @@
 #include "ciphermodes.hpp"
 #include "aes_exceptions.hpp"
+#include "keycache.hpp"
 #include "yandom.hpp"
+#include <atomic>
+#include <cstring>
+#include <emmintrin.h> // SSE2
+#include <functional>
+#include <thread>
+
+namespace {
+    // Number of blocks handed to aes::encrypt_blocks per call when a mode needs a scratch buffer, and the granularity of the
+    // thread ranges. 1 KB keeps the scratch buffers small on the stack, while 64 is a multiple of every batch width an
+    // engine reports, so no call but the last of a range ends with a partial batch
+    constexpr const std::size_t CHUNK_BLOCKS = 64;
+
+    std::atomic<unsigned int> configured_threads{0}; // 0 for one per hardware thread
+    std::atomic<std::size_t> configured_chunk_blocks{ciphermodes::PARALLEL_MIN_BLOCKS};
+
+    // Splits block_count blocks into contiguous ranges of at least min_blocks, one per thread, and runs work(index, first,
+    // last) on each. There are at most block_count / min_blocks ranges and the calling thread takes range 0, so a small
+    // input starts no thread at all
+    template <class Work>
+    void for_each_range(std::size_t block_count, std::size_t min_blocks, const Work& work) {
+        const std::size_t threads = std::min<std::size_t>(ciphermodes::thread_count(), block_count / min_blocks);
+        if (threads <= 1) {
+            work(std::size_t{0}, std::size_t{0}, block_count);
+            return;
+        }
+
+        //ranges are whole chunks, so every thread hands the engine full batches
+        const std::size_t range = ((block_count + threads - 1) / threads + CHUNK_BLOCKS - 1) / CHUNK_BLOCKS * CHUNK_BLOCKS;
+        std::vector<std::thread> workers;
+        workers.reserve(threads - 1);
+        try {
+            for (std::size_t first = range; first < block_count; first += range) {
+                workers.emplace_back([&work, index = first / range, first, last = std::min(first + range, block_count)]() { work(index, first, last); });
+            }
+            work(std::size_t{0}, std::size_t{0}, std::min(range, block_count));
+        } catch (...) {
+            for (std::thread& worker : workers) {
+                worker.join();
+            }
+            throw;
+        }
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    }
+
+    // for_each_range for a decryption that may run in place, with plaintext block i written over ciphertext block i, which
+    // the range before also reads. decrypt_range(first, last, first_out) writes the first block of its range to first_out:
+    // every range but the first holds it back there until all of them are done
+    template <class DecryptRange>
+    void for_each_held_range(std::size_t block_count, std::size_t last_length, aes::byte* out, const DecryptRange& decrypt_range) {
+        const std::size_t min_blocks = ciphermodes::chunk_blocks();
+        const std::size_t ranges = block_count / min_blocks;
+        std::vector<std::pair<std::size_t, aes::block>> held(ranges > 1 ? ranges - 1 : 0);
+        for_each_range(block_count, min_blocks, [&](std::size_t index, std::size_t first, std::size_t last) {
+            aes::byte* first_out = out;
+            if (index > 0) {
+                held[index - 1].first = first;
+                first_out = held[index - 1].second.data();
+            }
+            decrypt_range(first, last, first_out);
+        });
+        for (const std::pair<std::size_t, aes::block>& block : held) {
+            if (block.first != 0) {
+                const std::size_t length = block.first + 1 == block_count ? last_length : 16;
+                std::copy(block.second.bytes.begin(), block.second.bytes.begin() + length, out + 16 * block.first);
+            }
+        }
+    }
+
+    // out = a ^ b over length bytes, 16 at a time in SSE2 registers. out may equal a or b
+    void xor_bytes(aes::byte* out, const aes::byte* a, const aes::byte* b, std::size_t length) {
+        std::size_t i = 0;
+        for (; i + 16 <= length; i += 16) {
+            const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+            const __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_xor_si128(x, y));
+        }
+        for (; i < length; i++) {
+            out[i] = a[i] ^ b[i];
+        }
+    }
+
+    // XORs the CTR keystream (nonce || big-endian counter) into the bytes of blocks first .. last of a message of length
+    // bytes, in may equal out. The first of them goes to first_out, see for_each_held_range
+    void ctr_xor_range(const std::array<aes::byte, 12>& nonce, const aes::KeySchedule& schedule, const aes::byte* in, aes::byte* out,
+                       std::size_t length, std::size_t first_block, std::size_t last_block, aes::byte* first_out) {
+        std::array<aes::block, CHUNK_BLOCKS> counters{};
+        std::array<aes::block, CHUNK_BLOCKS> keystream{};
+        for (aes::block& counter : counters) {
+            counter = ciphermodes::create_CTR(nonce, 0);
+        }
+
+        for (std::size_t first = first_block; first < last_block; first += CHUNK_BLOCKS) {
+            //only the counter bytes change from one chunk to the next
+            std::size_t chunk = std::min(CHUNK_BLOCKS, last_block - first);
+            for (std::size_t i = 0; i < chunk; i++) {
+                const auto counter = static_cast<aes::word>(first + i);
+                counters[i].bytes[12] = static_cast<aes::byte>(counter >> 24U);
+                counters[i].bytes[13] = static_cast<aes::byte>(counter >> 16U);
+                counters[i].bytes[14] = static_cast<aes::byte>(counter >> 8U);
+                counters[i].bytes[15] = static_cast<aes::byte>(counter);
+            }
+            aes::encrypt_blocks(schedule, counters[0].data(), keystream[0].data(), chunk);
+            std::size_t bytes = std::min(16 * chunk, length - 16 * first);
+
+            std::size_t held = first == first_block ? std::min<std::size_t>(16, bytes) : 0;
+            xor_bytes(first_out, in + 16 * first, keystream[0].data(), held);
+            xor_bytes(out + 16 * first + held, in + 16 * first + held, keystream[0].data() + held, bytes - held);
+        }
+    }
+
+    // XORs the CTR keystream, starting at counter 0, into length bytes with the blocks split over the worker threads.
+    // in must either equal out or not overlap it, so no thread writes bytes another one still has to read
+    void ctr_xor(const std::array<aes::byte, 12>& nonce, const aes::KeySchedule& schedule, const aes::byte* in, aes::byte* out, std::size_t length) {
+        for_each_range((length + 15) / 16, ciphermodes::chunk_blocks(), [&](std::size_t /*index*/, std::size_t first, std::size_t last) {
+            ctr_xor_range(nonce, schedule, in, out, length, first, last, out + 16 * first);
+        });
+    }
+
+    // Decrypts the plaintext blocks first_block .. last_block of a CBC ciphertext, which starts with the IV, into out. The
+    // first of them goes to first_out, see for_each_held_range
+    void cbc_decrypt_range(const aes::KeySchedule& schedule, const aes::byte* in, aes::byte* out, std::size_t first_block,
+                           std::size_t last_block, aes::byte* first_out) {
+        std::array<aes::byte, 16 * CHUNK_BLOCKS> decrypted{};
+        std::array<aes::byte, 16> previous{};
+        std::copy(in + 16 * first_block, in + 16 * first_block + 16, previous.begin());
+
+        //the block decryptions do not depend on each other, only the xor needs the previous ciphertext block. In place,
+        //a chunk is written over the ciphertext 16 bytes before it, so its last ciphertext block is kept for the next chunk
+        for (std::size_t first = first_block; first < last_block; first += CHUNK_BLOCKS) {
+            std::size_t chunk = std::min(CHUNK_BLOCKS, last_block - first);
+            aes::decrypt_blocks(schedule, in + 16 * (first + 1), decrypted.data(), chunk);
+            xor_bytes(decrypted.data(), decrypted.data(), previous.data(), 16);
+            xor_bytes(decrypted.data() + 16, decrypted.data() + 16, in + 16 * first + 16, 16 * (chunk - 1));
+            std::copy(in + 16 * (first + chunk), in + 16 * (first + chunk) + 16, previous.begin());
+
+            std::size_t held = first == first_block ? 16 : 0;
+            std::copy(decrypted.begin(), decrypted.begin() + held, first_out);
+            std::copy(decrypted.begin() + held, decrypted.begin() + 16 * chunk, out + 16 * first + held);
+        }
+    }
+
+    // Decrypts the plaintext blocks first_block .. last_block of a CFB ciphertext of length bytes after the IV into out,
+    // the last block may be partial. The first of them goes to first_out, see for_each_held_range
+    void cfb_decrypt_range(const aes::KeySchedule& schedule, const aes::byte* in, aes::byte* out, std::size_t length,
+                           std::size_t first_block, std::size_t last_block, aes::byte* first_out) {
+        std::array<aes::byte, 16 * CHUNK_BLOCKS> keystream{};
+
+        //the input of AES for every block is the ciphertext block before it (the IV for the first one), all of which are
+        //known up front. A chunk is xored aside, so in place it only overwrites ciphertext it has read
+        for (std::size_t first = first_block; first < last_block; first += CHUNK_BLOCKS) {
+            std::size_t chunk = std::min(CHUNK_BLOCKS, last_block - first);
+            aes::encrypt_blocks(schedule, in + 16 * first, keystream.data(), chunk);
+            std::size_t bytes = std::min(16 * chunk, length - 16 * first);
+            xor_bytes(keystream.data(), keystream.data(), in + 16 * (first + 1), bytes);
+
+            std::size_t held = first == first_block ? std::min<std::size_t>(16, bytes) : 0;
+            std::copy(keystream.begin(), keystream.begin() + held, first_out);
+            std::copy(keystream.begin() + held, keystream.begin() + bytes, out + 16 * first + held);
+        }
+    }
+
+    auto overlaps(aes::span<const aes::byte> in, aes::span<aes::byte> out) -> bool {
+        const std::less<const aes::byte*> before;
+        return !in.empty() && !out.empty() && before(in.data(), out.data() + out.size()) && before(out.data(), in.data() + in.size());
+    }
+
+    void check_output_size(aes::span<aes::byte> out, std::size_t needed) {
+        if (out.size() < needed) {
+            throw aes_error("Output buffer is too small!\n");
+        }
+    }
+
+    // Where an encryption reads the plaintext from. When in and out overlap (in place), it is first moved to out + prefix,
+    // where the ciphertext of each byte goes, so every mode can then encrypt it where it lies
+    auto place_plaintext(aes::span<const aes::byte> in, aes::span<aes::byte> out, std::size_t prefix) -> const aes::byte* {
+        if (!overlaps(in, out) || in.data() == out.data() + prefix) {
+            return in.data();
+        }
+        std::memmove(out.data() + prefix, in.data(), in.size());
+        return out.data() + prefix;
+    }
+
+    // Number of PKCS#7 padding bytes at the end of length decrypted bytes, with the same checks as unpad_ciphertext
+    auto padding_length(const aes::byte* data, std::size_t length) -> std::size_t {
+        if (length == 0) {
+            throw aes_error("Error While Unpadding!\n");
+        }
+        aes::byte padNum = data[length - 1];
+        if (padNum > length) {
+            throw aes_error("Error While Unpadding!\n");
+        }
+        for (std::size_t i = 1; i <= padNum; i++) {
+            if (data[length - i] != padNum) {
+                throw aes_error("Error While Unpadding!\n");
+            }
+        }
+        return padNum;
+    }
+} // namespace
 
 
 auto ciphermodes::genKey(int keySize) -> std::vector<aes::byte>{
@@ -54,49 +256,33 @@ void ciphermodes::unpad_ciphertext(std::vector<aes::byte>& ciphertext_bytes){
         }
 }
 
-auto ciphermodes::xor_blocks(std::vector<aes::byte> block1,std::vector<aes::byte> block2) -> std::vector<aes::byte> {
-    for(std::size_t i = 0; i < ((block1.size() < block2.size()) ? block1.size() : block2.size()); i++){
-            block1[i] ^= block2[i];
-    }
-    return block1;
+void ciphermodes::set_thread_count(unsigned int threads) {
+    configured_threads = threads;
 }
 
-auto ciphermodes::merge_blocks(const std::vector<std::vector<aes::byte>>& ciphertext_blocks) -> std::vector<aes::byte>{
-	//new vector to store the combined bytes of every block
-    std::vector<aes::byte> ciphertext_bytes;
-    //iterate through all blocks
-    for (const auto& cipher_block : ciphertext_blocks) {
-        //iterate throught the bytes of each block and add them to the comvined vector
-        for (const auto& block_byte : cipher_block) {
-            ciphertext_bytes.push_back(block_byte);
-        }
+auto ciphermodes::thread_count() -> unsigned int {
+    const unsigned int threads = configured_threads;
+    if (threads != 0) {
+        return threads;
     }
-    //returned the combined bytes of every block
-    return ciphertext_bytes;
+    return std::max(1U, std::thread::hardware_concurrency());
 }
 
-auto ciphermodes::create_blocks(std::vector<aes::byte> plaintext_bytes) -> std::vector<std::vector<aes::byte> >{
-	//new vector of vectors to store the plaintext as a vector of blocks (each block is a vector of bytes)
-    std::vector<std::vector<aes::byte> > plaintext_blocks;
-    
-    //temp variable to build the current block
-    std::vector<aes::byte> new_block;
-    
-    //iterate through the plaintext
-    for(std::size_t i = 0; i < plaintext_bytes.size(); i++){
-        //every 128 bits (16 bytes), the completed block is added to the vector of vectors
-        if(i != 0 && i % 16 == 0){
-            plaintext_blocks.push_back(new_block);
-            new_block.clear();
-        }
-        new_block.push_back(plaintext_bytes[i]);
+void ciphermodes::set_chunk_blocks(std::size_t blocks) {
+    configured_chunk_blocks = blocks != 0 ? blocks : PARALLEL_MIN_BLOCKS;
+}
+
+auto ciphermodes::chunk_blocks() -> std::size_t {
+    return configured_chunk_blocks;
+}
+
+void ciphermodes::xor_blocks(aes::span<aes::byte> target, aes::span<const aes::byte> source) {
+    for(std::size_t i = 0; i < std::min(target.size(), source.size()); i++){
+            target[i] ^= source[i];
     }
-    plaintext_blocks.push_back(new_block);
-    //returned the vector of blocks correspodning to the plaintext
-    return plaintext_blocks;
 }
 
-auto ciphermodes::convert_block_to_state(std::vector<aes::byte> block) -> aes::state{
+auto ciphermodes::convert_block_to_state(aes::span<const aes::byte> block) -> aes::state{
     int index = 0;
     aes::state state;
     //in AES, a block's contents are populated column after column as opposed to row after row
@@ -119,400 +305,354 @@ auto ciphermodes::convert_state_to_block(aes::state state) -> std::vector<aes::b
     return block;
 }
 
-auto ciphermodes::create_CTR(std::array<aes::byte,12> nonce, aes::word counter)->aes::state{
-	std::vector<aes::byte> block;
+auto ciphermodes::create_CTR(const std::array<aes::byte,12>& nonce, aes::word counter)->aes::block{
+	aes::block CTR{};
 	std::array<aes::byte,4> temp = aes::splitWord(counter);
 
-	block.reserve(sizeof(aes::byte) * 16);
-
-	for(auto byte: nonce){
-		block.push_back(byte);
-	}
-	for(auto byte:temp){
-		block.push_back(byte);
-	}
-	aes::state CTR = convert_block_to_state(block);
+	std::copy(nonce.begin(), nonce.end(), CTR.bytes.begin());
+	std::copy(temp.begin(), temp.end(), CTR.bytes.begin() + 12);
 	return CTR;
 }
 
-auto ciphermodes::create_nonce_blocks(std::vector<aes::byte> ciphertext_bytes)->aes::Tuple<std::array<aes::byte, 12>, std::vector<std::vector<aes::byte>>>{
-	
-	aes:: Tuple<std::array<aes::byte, 12>, std::vector<std::vector<aes::byte>>> result;
-	
-	//gets the 12 bytes of the CTR IV from the first 12 bytes of the ciphertext
-	for(std::size_t i=0; i<12; i++){
-		result.element1.at(i) = ciphertext_bytes[i];
-	}
+auto ciphermodes::ECB_Encrypted_size(std::size_t plaintext_length) -> std::size_t {
+    return (plaintext_length / 16 + 1) * 16;
+}
 
-	//creates the blocks that will be decrypted from the remaining bytes in the ciphertext
-	std::vector<aes::byte> new_block;
-    	for(std::size_t i =12; i < ciphertext_bytes.size(); i++){
-        	if((i-12) != 0 && (i-12) % 16 == 0){
-            	result.element2.push_back(new_block);
-            	new_block.clear();
-        	}
-        	new_block.push_back(ciphertext_bytes[i]);
-    	}
-	if(!new_block.empty()){
-    		result.element2.push_back(new_block);
-	}
-	return result;
+auto ciphermodes::ECB_Decrypted_size(std::size_t ciphertext_length) -> std::size_t {
+    return ciphertext_length;
 }
 
+auto ciphermodes::ECB_Encrypt(aes::span<const aes::byte> plaintext_bytes, const std::vector<aes::byte>& key_bytes) -> std::vector<aes::byte> {
+    return ECB_Encrypt(plaintext_bytes, *keycache::schedule(key_bytes));
+}
 
+auto ciphermodes::ECB_Encrypt(aes::span<const aes::byte> plaintext_bytes, const aes::KeySchedule& schedule) -> std::vector<aes::byte> {
+    std::vector<aes::byte> ciphertext_bytes(ECB_Encrypted_size(plaintext_bytes.size()));
+    ECB_Encrypt(plaintext_bytes, ciphertext_bytes, schedule);
+    return ciphertext_bytes;
+}
 
-auto ciphermodes::ECB_Encrypt(std::vector<aes::byte> plaintext_bytes, const std::vector<aes::byte>& key_bytes) -> std::vector<aes::byte> {
-    
-    std::array<int, 2> nk_nr = aes::get_Nk_Nr(key_bytes.size()); 
-    
-    //key expansion
-    std::vector<aes::word> expandedKey(aes::NB*(nk_nr[1]+1));
-    aes::key_expansion(key_bytes, expandedKey, nk_nr[0], nk_nr[1]);
-    
-    //pad the plaintext and separate plaintext into blocks for encryption
-    pad_plaintext(plaintext_bytes);
-    std::vector<std::vector<aes::byte> > plaintext_blocks = ciphermodes::create_blocks(plaintext_bytes);
-    
-    //iterate through all the blocks
-    for(auto& plain_block : plaintext_blocks){
-        aes::state state = convert_block_to_state(plain_block);
-        //encrypt each block
-        aes::encrypt(nk_nr[1], state, expandedKey);
-        plain_block = convert_state_to_block(state);
-    }
+auto ciphermodes::ECB_Encrypt(aes::span<const aes::byte> plaintext_bytes, aes::span<aes::byte> ciphertext_out, const aes::KeySchedule& schedule) -> std::size_t {
+    const std::size_t length = ECB_Encrypted_size(plaintext_bytes.size());
+    check_output_size(ciphertext_out, length);
+
+    //the whole blocks are independent and in their stored order, so ranges of them are encrypted straight into the
+    //output, over the worker threads for a large plaintext
+    const aes::byte* plaintext = place_plaintext(plaintext_bytes, ciphertext_out, 0);
+    const std::size_t whole_blocks = plaintext_bytes.size() / 16;
+    for_each_range(whole_blocks, chunk_blocks(), [&](std::size_t /*index*/, std::size_t first, std::size_t last) {
+        aes::encrypt_blocks(schedule, plaintext + 16 * first, ciphertext_out.data() + 16 * first, last - first);
+    });
+
+    //the last block holds the remaining bytes and the padding
+    aes::block last{};
+    const std::size_t remaining = plaintext_bytes.size() - 16 * whole_blocks;
+    std::copy(plaintext + 16 * whole_blocks, plaintext + plaintext_bytes.size(), last.bytes.begin());
+    std::fill(last.bytes.begin() + remaining, last.bytes.end(), static_cast<aes::byte>(16 - remaining));
+    aes::encrypt_block(schedule, last.data(), ciphertext_out.data() + 16 * whole_blocks);
+
+    //return the length of the encrypted ciphertext
+    return length;
+}
 
-    //return the encrypted ciphertext
-    std::vector<aes::byte> ciphertext_bytes = merge_blocks(plaintext_blocks);
-    return ciphertext_bytes;
+auto ciphermodes::ECB_Decrypt(aes::span<const aes::byte> ciphertext_bytes, const std::vector<aes::byte>& key_bytes) -> std::vector<aes::byte> {
+    return ECB_Decrypt(ciphertext_bytes, *keycache::schedule(key_bytes));
 }
 
-auto ciphermodes::ECB_Decrypt(std::vector<aes::byte> ciphertext_bytes, const std::vector<aes::byte>& key_bytes) -> std::vector<aes::byte> {
-    
-    std::array<int, 2> nk_nr = aes::get_Nk_Nr(key_bytes.size()); 
-
-    //expand key
-    std::vector<aes::word> expandedKey(aes::NB*(nk_nr[1]+1));
-    aes::key_expansion(key_bytes, expandedKey, nk_nr[0], nk_nr[1]);
-
-    /**
-     * In accordance with EXP63-CPP. Do not rely on the value of a moved-from object
-     * While move semantics are great for efficient usage of larger data structures,
-     * the incorrect use of move-semantics, that is using a moved object in the moved-from state,
-     * has undefined behavior. We made sure to only utilize move semantics in places where:
-     * 1) the data structure is sufficiently large to warrant for an efficiency gain
-     * 2) the data structure is never used afterwards where it was moved from 
-     **/
-    //Separate ciphertext into blocks of 128 bits
-    std::vector<std::vector<aes::byte> > ciphertext_blocks =  ciphermodes::create_blocks(std::move(ciphertext_bytes));
-    
-    //iterate through all blocks of the cipher text
-    for (auto& block : ciphertext_blocks) {
-        //decrypt each block
-       aes::state state = convert_block_to_state(block);
-        aes::decrypt(nk_nr[1], state, expandedKey);
-        block = convert_state_to_block(state); 
-    }
-    //removes padding and returns the decrypted plaintext
-    std::vector<aes::byte> plaintext_bytes = merge_blocks(ciphertext_blocks);
-    unpad_ciphertext(plaintext_bytes);
+auto ciphermodes::ECB_Decrypt(aes::span<const aes::byte> ciphertext_bytes, const aes::KeySchedule& schedule) -> std::vector<aes::byte> {
+    std::vector<aes::byte> plaintext_bytes(ECB_Decrypted_size(ciphertext_bytes.size()));
+    plaintext_bytes.resize(ECB_Decrypt(ciphertext_bytes, plaintext_bytes, schedule));
     return plaintext_bytes;
 }
 
-auto ciphermodes::CTR_Encrypt(std::vector<aes::byte> plaintext_bytes, const std::vector<aes::byte>& key_bytes) -> std::vector<aes::byte>{
-	std::array<int, 2> nk_nr = aes::get_Nk_Nr(key_bytes.size());
-	
-	//Key Expansion
-	std::vector<aes::word> expandedKey(aes::NB*(nk_nr[1]+1));
-	aes::key_expansion(key_bytes, expandedKey, nk_nr[0], nk_nr[1]);
-	std::vector<std::vector<aes::byte>> plaintext_blocks = ciphermodes::create_blocks(std::move(plaintext_bytes));
-	
+auto ciphermodes::ECB_Decrypt(aes::span<const aes::byte> ciphertext_bytes, aes::span<aes::byte> plaintext_out, const aes::KeySchedule& schedule) -> std::size_t {
+    if (ciphertext_bytes.size() % 16 != 0) {
+        throw aes_error("Ciphertext length is not a multiple of the block size!\n");
+    }
+    check_output_size(plaintext_out, ECB_Decrypted_size(ciphertext_bytes.size()));
+
+    //decrypt every block straight into the plaintext, over the worker threads for a large ciphertext, then remove the padding
+    for_each_range(ciphertext_bytes.size() / 16, chunk_blocks(), [&](std::size_t /*index*/, std::size_t first, std::size_t last) {
+        aes::decrypt_blocks(schedule, ciphertext_bytes.data() + 16 * first, plaintext_out.data() + 16 * first, last - first);
+    });
+    return ciphertext_bytes.size() - padding_length(plaintext_out.data(), ciphertext_bytes.size());
+}
+
+auto ciphermodes::CTR_Encrypted_size(std::size_t plaintext_length) -> std::size_t {
+    return 12 + plaintext_length;
+}
+
+auto ciphermodes::CTR_Decrypted_size(std::size_t ciphertext_length) -> std::size_t {
+    return ciphertext_length > 12 ? ciphertext_length - 12 : 0;
+}
+
+auto ciphermodes::CTR_Encrypt(aes::span<const aes::byte> plaintext_bytes, const std::vector<aes::byte>& key_bytes) -> std::vector<aes::byte> {
+    return CTR_Encrypt(plaintext_bytes, *keycache::schedule(key_bytes));
+}
+
+auto ciphermodes::CTR_Encrypt(aes::span<const aes::byte> plaintext_bytes, const aes::KeySchedule& schedule) -> std::vector<aes::byte> {
+    std::vector<aes::byte> ciphertext_bytes(CTR_Encrypted_size(plaintext_bytes.size()));
+    CTR_Encrypt(plaintext_bytes, ciphertext_bytes, schedule);
+    return ciphertext_bytes;
+}
 
-	if(plaintext_blocks.size() > 4294967296){
+auto ciphermodes::CTR_Encrypt(aes::span<const aes::byte> plaintext_bytes, aes::span<aes::byte> ciphertext_out, const aes::KeySchedule& schedule) -> std::size_t {
+	if(plaintext_bytes.size() / 16 >= 4294967296){
 		throw aes_error("Plaintext too large to securely encrypt with CTR.\n");
 	}
-
-	//counter starting at 0
-	aes::word counter= 0U;
+	check_output_size(ciphertext_out, CTR_Encrypted_size(plaintext_bytes.size()));
+	const aes::byte* plaintext = place_plaintext(plaintext_bytes, ciphertext_out, 12);
 
 	//Create the 96 bit nonce for CTR mode
 	auto temp = randgen<128>();
 	std::array <aes::byte, 12> nonce{};
-	for(size_t i =0; i<12; i++){
-	       nonce.at(i) = temp.at(i);
-	}
+	std::copy(temp.begin(), temp.begin() + 12, nonce.begin());
 
-	//iterates over all plaintext blocks
-	for(auto& plain_block: plaintext_blocks){
-		aes::state CTR = create_CTR(nonce, counter); //appends the nonce with current value of the counter as a state matrix for encryption
-		aes::encrypt(nk_nr[1], CTR, expandedKey);
-		
-		//takes the encrypted state and xors it with the plaintext
-		std::vector<aes::byte> encrypted_block = convert_state_to_block(CTR);
-		plain_block= xor_blocks(plain_block, encrypted_block);
-		counter++;
-	}
-	//creates ciphertext by appending the 96bit IV to the beginning of the encrypted plaintext blocks
-	std::vector<aes::byte> ciphertext_bytes = merge_IV_blocks<12>(nonce, plaintext_blocks);
-	return ciphertext_bytes;	
-}
-
-auto ciphermodes::CTR_Decrypt(std::vector<aes::byte> ciphertext_bytes, const std::vector<aes::byte>& key_bytes) -> std::vector<aes::byte>{
-	std::array<int, 2> nk_nr = aes::get_Nk_Nr(key_bytes.size());
-        
-	//Key Expansion
-	std::vector<aes::word> expandedKey(aes::NB*(nk_nr[1]+1));
-        aes::key_expansion(key_bytes, expandedKey, nk_nr[0], nk_nr[1]);
-	
-	//extracts the IV from the first 12 ciphertext bytes and organizes the remaining bytes into blocks of 128 bits
-	aes::Tuple<std::array<aes::byte, 12>, std::vector<std::vector<aes::byte>>> nonce_cipherblocks = create_nonce_blocks(std::move(ciphertext_bytes));
-	
-	//counter starting at 0
-	aes::word counter = 0U;
-
-	for(auto& cipher_block: nonce_cipherblocks.element2){
-		aes::state CTR = create_CTR(nonce_cipherblocks.element1, counter); //appends nonce and counter as state matrix for encryption
-		aes::encrypt(nk_nr[1], CTR, expandedKey);
-
-		//take encrypted state and xors with ciphertext to get back original plaintext
-		std::vector<aes::byte> encrypted_block = convert_state_to_block(CTR);
-		cipher_block = xor_blocks(cipher_block,encrypted_block);
-		counter++;
+	//the ciphertext is the 96bit IV followed by the plaintext xored with the keystream
+	std::copy(nonce.begin(), nonce.end(), ciphertext_out.begin());
+	ctr_xor(nonce, schedule, plaintext, ciphertext_out.data() + 12, plaintext_bytes.size());
+	return CTR_Encrypted_size(plaintext_bytes.size());
+}
+
+auto ciphermodes::CTR_Decrypt(aes::span<const aes::byte> ciphertext_bytes, const std::vector<aes::byte>& key_bytes) -> std::vector<aes::byte> {
+    return CTR_Decrypt(ciphertext_bytes, *keycache::schedule(key_bytes));
+}
+
+auto ciphermodes::CTR_Decrypt(aes::span<const aes::byte> ciphertext_bytes, const aes::KeySchedule& schedule) -> std::vector<aes::byte> {
+    std::vector<aes::byte> plaintext_bytes(CTR_Decrypted_size(ciphertext_bytes.size()));
+    CTR_Decrypt(ciphertext_bytes, plaintext_bytes, schedule);
+    return plaintext_bytes;
+}
+
+auto ciphermodes::CTR_Decrypt(aes::span<const aes::byte> ciphertext_bytes, aes::span<aes::byte> plaintext_out, const aes::KeySchedule& schedule) -> std::size_t {
+	if (ciphertext_bytes.size() < 12) {
+		throw aes_error("Ciphertext is too short to contain the CTR nonce!\n");
 	}
+	const std::size_t length = CTR_Decrypted_size(ciphertext_bytes.size());
+	check_output_size(plaintext_out, length);
+
+	//extracts the IV from the first 12 ciphertext bytes
+	std::array<aes::byte, 12> nonce{};
+	std::copy(ciphertext_bytes.begin(), ciphertext_bytes.begin() + 12, nonce.begin());
+
+	//xoring the same keystream recovers the plaintext. In place, every block is written 12 bytes before its ciphertext,
+	//over the end of the ciphertext block before it, so the first block of each range is held back like in CBC
+	const std::size_t block_count = (length + 15) / 16;
+	const std::size_t last_length = length - 16 * (block_count > 0 ? block_count - 1 : 0);
+	for_each_held_range(block_count, last_length, plaintext_out.data(), [&](std::size_t first, std::size_t last, aes::byte* first_out) {
+	    ctr_xor_range(nonce, schedule, ciphertext_bytes.data() + 12, plaintext_out.data(), length, first, last, first_out);
+	});
+	return length;
+}
 
-	//returns decrypted plaintext
-	std::vector<aes::byte> plaintext_bytes = merge_blocks(nonce_cipherblocks.element2);
-	return plaintext_bytes;
+auto ciphermodes::CBC_Encrypted_size(std::size_t plaintext_length) -> std::size_t {
+    return 16 + (plaintext_length / 16 + 1) * 16;
 }
 
-auto ciphermodes::CBC_Encrypt(std::vector<aes::byte> plaintext_bytes, const std::vector<aes::byte>& key_bytes) -> std::vector<aes::byte>{
-    std::array<int, 2> nk_nr = aes::get_Nk_Nr(key_bytes.size()); 
-    
-    //key expansion
-    std::vector<aes::word> expandedKey(aes::NB*(nk_nr[1]+1));
-    aes::key_expansion(key_bytes, expandedKey, nk_nr[0], nk_nr[1]);
-    
-    pad_plaintext(plaintext_bytes);
+auto ciphermodes::CBC_Decrypted_size(std::size_t ciphertext_length) -> std::size_t {
+    return ciphertext_length > 16 ? ciphertext_length - 16 : 0;
+}
 
-    //separate plaintext into blocks for encryption
-    std::vector<std::vector<aes::byte> > plaintext_blocks = ciphermodes::create_blocks(plaintext_bytes);
-    
-    //get random IV
-    auto IV = randgen<128>();
-    std::vector<aes::byte> temp;
-    temp.reserve(sizeof(aes::byte) * IV.size());
-    for(auto byte: IV){
-	    temp.push_back(byte);
+auto ciphermodes::CBC_Encrypt(aes::span<const aes::byte> plaintext_bytes, const std::vector<aes::byte>& key_bytes) -> std::vector<aes::byte> {
+    return CBC_Encrypt(plaintext_bytes, *keycache::schedule(key_bytes));
+}
+
+auto ciphermodes::CBC_Encrypt(aes::span<const aes::byte> plaintext_bytes, const aes::KeySchedule& schedule) -> std::vector<aes::byte> {
+    std::vector<aes::byte> ciphertext_bytes(CBC_Encrypted_size(plaintext_bytes.size()));
+    CBC_Encrypt(plaintext_bytes, ciphertext_bytes, schedule);
+    return ciphertext_bytes;
+}
+
+auto ciphermodes::CBC_Encrypt(aes::span<const aes::byte> plaintext_bytes, aes::span<aes::byte> ciphertext_out, const aes::KeySchedule& schedule) -> std::size_t {
+    const std::size_t length = CBC_Encrypted_size(plaintext_bytes.size());
+    check_output_size(ciphertext_out, length);
+
+    //the ciphertext starts as a random IV followed by the padded plaintext, which is then chained in place
+    if (!plaintext_bytes.empty()) {
+        std::memmove(ciphertext_out.data() + 16, plaintext_bytes.data(), plaintext_bytes.size());
     }
-    
-    //prepend the IV to the plaintext blocks for encryption to begin the cipher chain
-    plaintext_blocks.insert(plaintext_blocks.begin(), temp);
+    std::fill(ciphertext_out.begin() + 16 + plaintext_bytes.size(), ciphertext_out.begin() + length, static_cast<aes::byte>(length - 16 - plaintext_bytes.size()));
+    auto IV = randgen<128>();
+    std::copy(IV.begin(), IV.end(), ciphertext_out.begin());
 
     //iterates through all plaintext blocks
-    for(std::size_t i = 1; i < plaintext_blocks.size(); i++){
-        //xor the current block with the encrypted previous block (or the IV for the first block)
-        plaintext_blocks[i] = xor_blocks(plaintext_blocks[i],plaintext_blocks[i-1]);
-        aes::state state = convert_block_to_state(plaintext_blocks[i]);
-        aes::encrypt(nk_nr[1], state, expandedKey);
-        plaintext_blocks[i] = convert_state_to_block(state);
+    const aes::block_function encrypt_block = aes::select_encrypt_block(schedule);
+    for(std::size_t i = 16; i < length; i += 16){
+        //xor the current block with the encrypted previous block (or the IV for the first block), then encrypt it in place
+        for(std::size_t j = 0; j < 16; j++){
+            ciphertext_out[i + j] ^= ciphertext_out[i + j - 16];
+        }
+        encrypt_block(schedule, &ciphertext_out[i], &ciphertext_out[i]);
     }
 
-    //returns the encrypted ciphertext
-    std::vector<aes::byte> ciphertext_bytes = merge_blocks(plaintext_blocks);
-    return ciphertext_bytes;
+    //returns the length of the encrypted ciphertext
+    return length;
 }
 
 
-auto ciphermodes::CBC_Decrypt(std::vector<aes::byte> ciphertext_bytes, const std::vector<aes::byte>& key_bytes) -> std::vector<aes::byte>{
-    std::array<int, 2> nk_nr = aes::get_Nk_Nr(key_bytes.size()); 
+auto ciphermodes::CBC_Decrypt(aes::span<const aes::byte> ciphertext_bytes, const std::vector<aes::byte>& key_bytes) -> std::vector<aes::byte> {
+    return CBC_Decrypt(ciphertext_bytes, *keycache::schedule(key_bytes));
+}
 
-    //key expansion
-    std::vector<aes::word> expandedKey(aes::NB*(nk_nr[1]+1));
-    aes::key_expansion(key_bytes, expandedKey, nk_nr[0], nk_nr[1]);
+auto ciphermodes::CBC_Decrypt(aes::span<const aes::byte> ciphertext_bytes, const aes::KeySchedule& schedule) -> std::vector<aes::byte> {
+    std::vector<aes::byte> plaintext_bytes(CBC_Decrypted_size(ciphertext_bytes.size()));
+    plaintext_bytes.resize(CBC_Decrypt(ciphertext_bytes, plaintext_bytes, schedule));
+    return plaintext_bytes;
+}
 
-    //Separate ciphertext into blocks of 128 bits where the first block is the IV
-    std::vector<std::vector<aes::byte> > ciphertext_blocks =  ciphermodes::create_blocks(std::move(ciphertext_bytes));
-    
-    //iterates through ciphertext blocks starting at 1 since first block is the IV
-    for(std::size_t i =  ciphertext_blocks.size() - 1; i > 0; i--){
-        aes::state state = convert_block_to_state(ciphertext_blocks[i]);
-        //decrypts the ciphertextr block
-        aes::decrypt(nk_nr[1], state, expandedKey);
-        ciphertext_blocks[i] = convert_state_to_block(state);
-        ciphertext_blocks[i] = xor_blocks(ciphertext_blocks[i],ciphertext_blocks[i-1]);
+auto ciphermodes::CBC_Decrypt(aes::span<const aes::byte> ciphertext_bytes, aes::span<aes::byte> plaintext_out, const aes::KeySchedule& schedule) -> std::size_t {
+    if (ciphertext_bytes.size() < 16 || ciphertext_bytes.size() % 16 != 0) {
+        throw aes_error("Ciphertext length is not a multiple of the block size!\n");
     }
+    const std::size_t length = CBC_Decrypted_size(ciphertext_bytes.size());
+    check_output_size(plaintext_out, length);
 
-    //remove the IV from the plaintext
-    ciphertext_blocks.erase(ciphertext_blocks.begin());
-    
-    //returns decrypted plaintext after removing padding
-    std::vector<aes::byte> plaintext_bytes = merge_blocks(ciphertext_blocks);
-    unpad_ciphertext(plaintext_bytes);
-    return plaintext_bytes;
+    //the ciphertext is split into ranges of blocks decrypted concurrently, each needing the ciphertext block before it
+    for_each_held_range(length / 16, 16, plaintext_out.data(), [&](std::size_t first, std::size_t last, aes::byte* first_out) {
+        cbc_decrypt_range(schedule, ciphertext_bytes.data(), plaintext_out.data(), first, last, first_out);
+    });
+
+    //the padding is only stripped once every range is done, returns the length of the decrypted plaintext without it
+    return length - padding_length(plaintext_out.data(), length);
 }
 
-auto ciphermodes::CFB_Encrypt(std::vector<aes::byte> plaintext_bytes, const std::vector<aes::byte>& key_bytes) -> std::vector<aes::byte>{
-    std::array<int, 2> nk_nr = aes::get_Nk_Nr(key_bytes.size());
-    
-    //key expansion
-    std::vector<aes::word> expandedKey(aes::NB*(nk_nr[1]+1));
-    aes::key_expansion(key_bytes, expandedKey, nk_nr[0], nk_nr[1]);
+auto ciphermodes::CFB_Encrypted_size(std::size_t plaintext_length) -> std::size_t {
+    return 16 + plaintext_length;
+}
 
-    //get random IV
-    auto IV = randgen<128>();
-    std::vector<aes::byte> temp;
-    temp.reserve(sizeof(aes::byte) * IV.size());
-    for(auto byte: IV){
-	    temp.push_back(byte);
-    }
-    
-    //separate plaintext into blocks for encryption
-    std::vector<std::vector<aes::byte> > plaintext_blocks = ciphermodes::create_blocks(std::move(plaintext_bytes));
-    
-    //iterates through all plaintext blocks
-    for(auto& plaintext_block : plaintext_blocks) {
-	    
-	    aes::state state = convert_block_to_state(temp);
-	    aes::encrypt(nk_nr[1], state, expandedKey);
-	    temp = convert_state_to_block(state);
-
-	    //encrypted block becomes input of AES for next block's encryption
-	    temp = xor_blocks(plaintext_block, temp);
-	    plaintext_block = temp;
-    }
+auto ciphermodes::CFB_Decrypted_size(std::size_t ciphertext_length) -> std::size_t {
+    return ciphertext_length > 16 ? ciphertext_length - 16 : 0;
+}
+
+auto ciphermodes::CFB_Encrypt(aes::span<const aes::byte> plaintext_bytes, const std::vector<aes::byte>& key_bytes) -> std::vector<aes::byte> {
+    return CFB_Encrypt(plaintext_bytes, *keycache::schedule(key_bytes));
+}
 
-    //creates ciphertext by appending the 96bit IV to the beginning of the encrypted plaintext blocks
-    std::vector<aes::byte> ciphertext_bytes = merge_IV_blocks<16>(IV, plaintext_blocks);
+auto ciphermodes::CFB_Encrypt(aes::span<const aes::byte> plaintext_bytes, const aes::KeySchedule& schedule) -> std::vector<aes::byte> {
+    std::vector<aes::byte> ciphertext_bytes(CFB_Encrypted_size(plaintext_bytes.size()));
+    CFB_Encrypt(plaintext_bytes, ciphertext_bytes, schedule);
     return ciphertext_bytes;
 }
 
-auto ciphermodes::CFB_Decrypt(std::vector<aes::byte> ciphertext_bytes, const std::vector<aes::byte>& key_bytes) -> std::vector<aes::byte>{
-    std::array<int, 2> nk_nr = aes::get_Nk_Nr(key_bytes.size());
-    
-    //Key expansion
-    std::vector<aes::word> expandedKey(aes::NB*(nk_nr[1]+1));
-    aes::key_expansion(key_bytes, expandedKey, nk_nr[0], nk_nr[1]);
+auto ciphermodes::CFB_Encrypt(aes::span<const aes::byte> plaintext_bytes, aes::span<aes::byte> ciphertext_out, const aes::KeySchedule& schedule) -> std::size_t {
+    check_output_size(ciphertext_out, CFB_Encrypted_size(plaintext_bytes.size()));
+    const aes::byte* plaintext = place_plaintext(plaintext_bytes, ciphertext_out, 16);
+
+    //the ciphertext starts with a random IV
+    auto IV = randgen<128>();
+    std::copy(IV.begin(), IV.end(), ciphertext_out.begin());
     
-    //Separate ciphertext into blocks of 128 bits where the first block is the IV
-    std::vector<std::vector<aes::byte> > ciphertext_blocks =  create_blocks(std::move(ciphertext_bytes));
-    std::vector<std::vector<aes::byte> > plaintext_blocks;
-
-    //iterates through ciphertext blocks starting at 1 since first block is the IV
-    for(size_t i=1; i < ciphertext_blocks.size(); i++){
-	    aes::state state = convert_block_to_state(ciphertext_blocks[i-1]);
-	    aes::encrypt(nk_nr[1], state, expandedKey);
-	    
-	    //decryption of ciphertext
-	    std::vector<aes::byte> temp = convert_state_to_block(state);
-	    temp = xor_blocks(ciphertext_blocks[i], temp);
-	    plaintext_blocks.push_back(temp);
+    //iterates through all plaintext blocks, the input of AES is the ciphertext block before (or the IV)
+    std::array<aes::byte, 16> keystream{};
+    const aes::block_function encrypt_block = aes::select_encrypt_block(schedule);
+    for(std::size_t i = 0; i < plaintext_bytes.size(); i += 16) {
+	    encrypt_block(schedule, &ciphertext_out[i], keystream.data());
+
+	    std::size_t length = std::min<std::size_t>(16, plaintext_bytes.size() - i);
+	    for(std::size_t j = 0; j < length; j++){
+		    ciphertext_out[16 + i + j] = plaintext[i + j] ^ keystream.at(j);
+	    }
     }
 
-    //returns decrypted plaintext
-    std::vector<aes::byte> plaintext_bytes = merge_blocks(plaintext_blocks);
+    return CFB_Encrypted_size(plaintext_bytes.size());
+}
+
+auto ciphermodes::CFB_Decrypt(aes::span<const aes::byte> ciphertext_bytes, const std::vector<aes::byte>& key_bytes) -> std::vector<aes::byte> {
+    return CFB_Decrypt(ciphertext_bytes, *keycache::schedule(key_bytes));
+}
+
+auto ciphermodes::CFB_Decrypt(aes::span<const aes::byte> ciphertext_bytes, const aes::KeySchedule& schedule) -> std::vector<aes::byte> {
+    std::vector<aes::byte> plaintext_bytes(CFB_Decrypted_size(ciphertext_bytes.size()));
+    CFB_Decrypt(ciphertext_bytes, plaintext_bytes, schedule);
     return plaintext_bytes;
 }
 
-auto ciphermodes::OFM_Encrypt(const std::vector<aes::byte>& plaintext_bytes, const std::vector<aes::byte>& key_bytes) -> std::vector<aes::byte> {
-    using block_vector = std::vector<std::vector<aes::byte>>; // Shorthand notation
+auto ciphermodes::CFB_Decrypt(aes::span<const aes::byte> ciphertext_bytes, aes::span<aes::byte> plaintext_out, const aes::KeySchedule& schedule) -> std::size_t {
+    const std::size_t plaintext_length = CFB_Decrypted_size(ciphertext_bytes.size());
+    check_output_size(plaintext_out, plaintext_length);
+
+    //large ciphertexts are split into ranges of blocks over the worker threads, small ones are decrypted in chunks on
+    //the calling thread, each chunk one call to the engine
+    const std::size_t block_count = (plaintext_length + 15) / 16;
+    const std::size_t last_length = plaintext_length - 16 * (block_count > 0 ? block_count - 1 : 0);
+    for_each_held_range(block_count, last_length, plaintext_out.data(), [&](std::size_t first, std::size_t last, aes::byte* first_out) {
+        cfb_decrypt_range(schedule, ciphertext_bytes.data(), plaintext_out.data(), plaintext_length, first, last, first_out);
+    });
+
+    //returns the length of the decrypted plaintext
+    return plaintext_length;
+}
 
-    const auto NK_NR = aes::get_Nk_Nr(key_bytes.size());
-    const int NK = NK_NR[0];
-    const int NR = NK_NR[1];
+auto ciphermodes::OFM_Encrypted_size(std::size_t plaintext_length) -> std::size_t {
+    return 16 + plaintext_length;
+}
 
-    // Key expansion
-    std::vector<aes::word> expanded_key(aes::NB * (NR + 1));
-    aes::key_expansion(key_bytes, expanded_key, NK, NR);
+auto ciphermodes::OFM_Decrypted_size(std::size_t ciphertext_length) -> std::size_t {
+    return ciphertext_length > 16 ? ciphertext_length - 16 : 0;
+}
 
-    block_vector plaintext_blocks = create_blocks(plaintext_bytes);
+auto ciphermodes::OFM_Encrypt(aes::span<const aes::byte> plaintext_bytes, const std::vector<aes::byte>& key_bytes) -> std::vector<aes::byte> {
+    return OFM_Encrypt(plaintext_bytes, *keycache::schedule(key_bytes));
+}
 
-    block_vector ciphertext_blocks{};
+auto ciphermodes::OFM_Encrypt(aes::span<const aes::byte> plaintext_bytes, const aes::KeySchedule& schedule) -> std::vector<aes::byte> {
+    std::vector<aes::byte> ciphertext_bytes(OFM_Encrypted_size(plaintext_bytes.size()));
+    OFM_Encrypt(plaintext_bytes, ciphertext_bytes, schedule);
+    return ciphertext_bytes;
+}
 
+auto ciphermodes::OFM_Encrypt(aes::span<const aes::byte> plaintext_bytes, aes::span<aes::byte> ciphertext_out, const aes::KeySchedule& schedule) -> std::size_t {
+    check_output_size(ciphertext_out, OFM_Encrypted_size(plaintext_bytes.size()));
+    const aes::byte* plaintext = place_plaintext(plaintext_bytes, ciphertext_out, 16);
     auto IV = randgen<128>(); // Random nonce used in first iteration of OFM
 
-    // Prepare ciphertext_blocks[0] as encrypted IV XOR m[0]
-    auto IV_state = convert_block_to_state<128>(IV);
-    aes::encrypt(NR, IV_state, expanded_key);
-    ciphertext_blocks.emplace_back(
-        xor_blocks(
-            plaintext_blocks[0],
-            convert_state_to_block(IV_state)            
-        )
-    );
-
-    // Iterate from 1...N blocks
-    for (std::size_t i = 1; i < plaintext_blocks.size(); ++i) {
-
-        // Encrypt the result of XORing the previous cipher and plaintext blocks
-        aes::state prev_xor_state = convert_block_to_state(
-            xor_blocks(
-                ciphertext_blocks[i - 1],
-                plaintext_blocks[i - 1]
-            )
-        ); 
-        aes::encrypt(NR, prev_xor_state, expanded_key);
-
-        // New cipher is the XOR of current plaintext block and prev_xor_state
-        ciphertext_blocks.emplace_back(
-            xor_blocks(
-                plaintext_blocks[i],
-                convert_state_to_block(prev_xor_state)
-            )    
-        );
+    // The ciphertext is the IV followed by the plaintext xored with the keystream
+    std::copy(IV.begin(), IV.end(), ciphertext_out.begin());
+
+    // The XOR of a cipher and plaintext block is the keystream block, so every keystream block is the encryption of the previous one
+    std::array<aes::byte, 16> keystream{};
+    std::copy(IV.begin(), IV.end(), keystream.begin());
+    const aes::block_function encrypt_block = aes::select_encrypt_block(schedule);
+    for (std::size_t i = 0; i < plaintext_bytes.size(); i += 16) {
+        encrypt_block(schedule, keystream.data(), keystream.data());
+
+        std::size_t length = std::min<std::size_t>(16, plaintext_bytes.size() - i);
+        for (std::size_t j = 0; j < length; ++j) {
+            ciphertext_out[16 + i + j] = plaintext[i + j] ^ keystream.at(j);
+        }
     }
 
-    return merge_IV_blocks<16>(IV, ciphertext_blocks);
-}
-
-auto ciphermodes::OFM_Decrypt(const std::vector<aes::byte>& ciphertext_bytes, const std::vector<aes::byte>& key_bytes) -> std::vector<aes::byte> {
-    using block_vector = std::vector<std::vector<aes::byte>>; // Shorthand notation
-
-    const auto NK_NR = aes::get_Nk_Nr(key_bytes.size());
-    const int NK = NK_NR[0];
-    const int NR = NK_NR[1];
-
-    // Key expansion
-    std::vector<aes::word> expanded_key(aes::NB * (NR + 1));
-    aes::key_expansion(key_bytes, expanded_key, NK, NR);
-    block_vector ciphertext_blocks = create_blocks(ciphertext_bytes);
-    block_vector plaintext_blocks{};
-
-    // Extract IV from the ciphertext's block (the first) and remove it from the ciphertext_blocks
-    std::vector<aes::byte> IV{ciphertext_blocks[0]};
-    ciphertext_blocks.erase(ciphertext_blocks.begin());
-
-    // Prepare message_blocks[0] as XOR of cipher[0] and encrypted IV
-    auto IV_state = convert_block_to_state(IV);
-    aes::encrypt(NR, IV_state, expanded_key);
-
-    plaintext_blocks.emplace_back(
-        xor_blocks(
-            ciphertext_blocks[0],
-            convert_state_to_block(IV_state)
-        )
-    );
-
-    // std::cout << ciphertext_blocks.size() << std::endl;
-    // std::cout << plaintext_blocks.size() << std::endl;
-    // Iterate from 1...N blocks
-    for (std::size_t i = 1; i < ciphertext_blocks.size(); ++i) {
-
-        // Encrypt the result of XORing the previous cipher and plaintext blocks
-        aes::state prev_xor_state = convert_block_to_state(
-            xor_blocks(
-                ciphertext_blocks[i - 1],
-                plaintext_blocks[i - 1]
-            )
-        ); 
-        aes::encrypt(NR, prev_xor_state, expanded_key);
-
-        // New plaintext block is the XOR of current cipher block and prev_xor_state
-        plaintext_blocks.emplace_back(
-            xor_blocks(
-                ciphertext_blocks[i],
-                convert_state_to_block(prev_xor_state)
-            )    
-        );
+    return OFM_Encrypted_size(plaintext_bytes.size());
+}
+
+auto ciphermodes::OFM_Decrypt(aes::span<const aes::byte> ciphertext_bytes, const std::vector<aes::byte>& key_bytes) -> std::vector<aes::byte> {
+    return OFM_Decrypt(ciphertext_bytes, *keycache::schedule(key_bytes));
+}
+
+auto ciphermodes::OFM_Decrypt(aes::span<const aes::byte> ciphertext_bytes, const aes::KeySchedule& schedule) -> std::vector<aes::byte> {
+    std::vector<aes::byte> plaintext_bytes(OFM_Decrypted_size(ciphertext_bytes.size()));
+    OFM_Decrypt(ciphertext_bytes, plaintext_bytes, schedule);
+    return plaintext_bytes;
+}
+
+auto ciphermodes::OFM_Decrypt(aes::span<const aes::byte> ciphertext_bytes, aes::span<aes::byte> plaintext_out, const aes::KeySchedule& schedule) -> std::size_t {
+    const std::size_t plaintext_length = OFM_Decrypted_size(ciphertext_bytes.size());
+    check_output_size(plaintext_out, plaintext_length);
+
+    // Extract IV from the ciphertext's first block, the rest of the ciphertext is xored with the keystream
+    std::size_t iv_length = std::min<std::size_t>(16, ciphertext_bytes.size());
+    std::array<aes::byte, 16> keystream{};
+    std::copy(ciphertext_bytes.begin(), ciphertext_bytes.begin() + iv_length, keystream.begin());
+    const aes::block_function encrypt_block = aes::select_encrypt_block(schedule);
+
+    for (std::size_t i = 0; i < plaintext_length; i += 16) {
+        encrypt_block(schedule, keystream.data(), keystream.data());
+
+        std::size_t length = std::min<std::size_t>(16, plaintext_length - i);
+        for (std::size_t j = 0; j < length; ++j) {
+            plaintext_out[i + j] = ciphertext_bytes[iv_length + i + j] ^ keystream.at(j);
+        }
     }
 
-    return merge_blocks(plaintext_blocks);
+    return plaintext_length;
 }
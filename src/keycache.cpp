@@ -0,0 +1,208 @@
+#include "keycache.hpp"
+#include "aes_exceptions.hpp"
+#include "yandom.hpp"
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+namespace {
+    constexpr const int RDSEED_ATTEMPTS = 10; // RDSEED may fail transiently when the entropy source is drained
+
+    auto rotl(uint64_t x, unsigned int bits) -> uint64_t {
+        return (x << bits) | (x >> (64U - bits));
+    }
+
+    void sipround(std::array<uint64_t, 4>& v) {
+        v[0] += v[1]; v[1] = rotl(v[1], 13); v[1] ^= v[0]; v[0] = rotl(v[0], 32);
+        v[2] += v[3]; v[3] = rotl(v[3], 16); v[3] ^= v[2];
+        v[0] += v[3]; v[3] = rotl(v[3], 21); v[3] ^= v[0];
+        v[2] += v[1]; v[1] = rotl(v[1], 17); v[1] ^= v[2]; v[2] = rotl(v[2], 32);
+    }
+
+    auto load_little_endian(const aes::byte* bytes, std::size_t count) -> uint64_t {
+        uint64_t value = 0;
+        for (std::size_t i = 0; i < count; i++) {
+            value |= static_cast<uint64_t>(bytes[i]) << (8U * i);
+        }
+        return value;
+    }
+
+    // Writes through a volatile pointer so the stores are not removed as dead before the memory is freed
+    void zeroize(void* data, std::size_t length) {
+        volatile aes::byte* bytes = static_cast<volatile aes::byte*>(data);
+        for (std::size_t i = 0; i < length; i++) {
+            bytes[i] = 0;
+        }
+    }
+
+    auto random_hash_key() -> std::array<uint64_t, 2> {
+        std::array<aes::byte, 16> bytes{};
+        bool seeded = false;
+        for (int attempt = 0; attempt < RDSEED_ATTEMPTS && !seeded; attempt++) {
+            try {
+                bytes = randgen<128>();
+                seeded = true;
+            } catch (const aes_error&) {
+                //retried, then /dev/urandom below
+            }
+        }
+        if (!seeded) {
+            bytes = __os_randgen<128>();
+        }
+        std::array<uint64_t, 2> key = {load_little_endian(bytes.data(), 8), load_little_endian(bytes.data() + 8, 8)};
+        zeroize(bytes.data(), bytes.size());
+        return key;
+    }
+
+    // Compares the key with the first round key of the schedule, which is the cipher key in its byte order
+    auto same_key(const aes::KeySchedule& schedule, const std::vector<aes::byte>& key_bytes) -> bool {
+        if (schedule.Nr != key_bytes.size() / 4 + 6) {
+            return false;
+        }
+        aes::byte difference = 0;
+        for (std::size_t i = 0; i < key_bytes.size(); i++) {
+            difference |= schedule.encryption_blocks[i] ^ key_bytes[i];
+        }
+        return difference == 0;
+    }
+
+    auto make_schedule(const std::vector<aes::byte>& key_bytes) -> std::shared_ptr<const aes::KeySchedule> {
+        return std::shared_ptr<const aes::KeySchedule>(new aes::KeySchedule(key_bytes), [](const aes::KeySchedule* schedule) {
+            zeroize(const_cast<aes::KeySchedule*>(schedule), sizeof(aes::KeySchedule));
+            delete schedule;
+        });
+    }
+
+    struct entry {
+        uint64_t fingerprint;
+        std::shared_ptr<const aes::KeySchedule> schedule;
+    };
+
+    struct cache {
+        std::mutex mutex;
+        std::list<entry> recent; // most recently used first
+        std::unordered_map<uint64_t, std::list<entry>::iterator> index;
+        std::size_t capacity = keycache::DEFAULT_CAPACITY;
+        keycache::statistics counts{};
+        const std::array<uint64_t, 2> hash_key = random_hash_key();
+
+        // Callers hold the mutex
+        void evict(std::list<entry>::iterator victim) {
+            index.erase(victim->fingerprint);
+            recent.erase(victim);
+            counts.evictions++;
+        }
+
+        void shrink() {
+            while (recent.size() > capacity) {
+                evict(std::prev(recent.end()));
+            }
+        }
+    };
+
+    auto instance() -> cache& {
+        static cache shared;
+        return shared;
+    }
+} // namespace
+
+auto keycache::siphash(const std::array<uint64_t, 2>& key, const aes::byte* data, std::size_t length) -> uint64_t {
+    std::array<uint64_t, 4> v = {key[0] ^ 0x736f6d6570736575ULL, key[1] ^ 0x646f72616e646f6dULL,
+                                 key[0] ^ 0x6c7967656e657261ULL, key[1] ^ 0x7465646279746573ULL};
+
+    //two rounds per 8-byte word of the message
+    const std::size_t full_words = length / 8;
+    for (std::size_t i = 0; i < full_words; i++) {
+        const uint64_t m = load_little_endian(data + 8 * i, 8);
+        v[3] ^= m;
+        sipround(v);
+        sipround(v);
+        v[0] ^= m;
+    }
+
+    //the last word holds the remaining bytes and the length modulo 256 in its top byte
+    const uint64_t last = load_little_endian(data + 8 * full_words, length % 8) | (static_cast<uint64_t>(length) << 56U);
+    v[3] ^= last;
+    sipround(v);
+    sipround(v);
+    v[0] ^= last;
+
+    //four finalization rounds
+    v[2] ^= 0xff;
+    sipround(v);
+    sipround(v);
+    sipround(v);
+    sipround(v);
+    return v[0] ^ v[1] ^ v[2] ^ v[3];
+}
+
+auto keycache::schedule(const std::vector<aes::byte>& key_bytes) -> std::shared_ptr<const aes::KeySchedule> {
+    aes::get_Nk_Nr(static_cast<int>(key_bytes.size())); // rejects invalid key lengths before anything is cached
+    cache& shared = instance();
+    const uint64_t fingerprint = siphash(shared.hash_key, key_bytes.data(), key_bytes.size());
+
+    {
+        std::lock_guard<std::mutex> lock(shared.mutex);
+        auto found = shared.index.find(fingerprint);
+        if (found != shared.index.end() && same_key(*found->second->schedule, key_bytes)) {
+            shared.recent.splice(shared.recent.begin(), shared.recent, found->second);
+            shared.counts.hits++;
+            return found->second->schedule;
+        }
+        shared.counts.misses++;
+    }
+
+    //the expansion runs outside the lock so other keys are not held up behind it
+    std::shared_ptr<const aes::KeySchedule> expanded = make_schedule(key_bytes);
+
+    std::lock_guard<std::mutex> lock(shared.mutex);
+    if (shared.capacity == 0) {
+        return expanded;
+    }
+    auto found = shared.index.find(fingerprint);
+    if (found != shared.index.end()) {
+        //another thread inserted this key meanwhile, or a different key has the same fingerprint and is replaced
+        if (same_key(*found->second->schedule, key_bytes)) {
+            shared.recent.splice(shared.recent.begin(), shared.recent, found->second);
+            return found->second->schedule;
+        }
+        shared.evict(found->second);
+    }
+    shared.recent.push_front({fingerprint, expanded});
+    shared.index[fingerprint] = shared.recent.begin();
+    shared.shrink();
+    return expanded;
+}
+
+void keycache::set_capacity(std::size_t capacity) {
+    cache& shared = instance();
+    std::lock_guard<std::mutex> lock(shared.mutex);
+    shared.capacity = capacity;
+    shared.shrink();
+}
+
+auto keycache::capacity() -> std::size_t {
+    cache& shared = instance();
+    std::lock_guard<std::mutex> lock(shared.mutex);
+    return shared.capacity;
+}
+
+auto keycache::size() -> std::size_t {
+    cache& shared = instance();
+    std::lock_guard<std::mutex> lock(shared.mutex);
+    return shared.recent.size();
+}
+
+void keycache::clear() {
+    cache& shared = instance();
+    std::lock_guard<std::mutex> lock(shared.mutex);
+    while (!shared.recent.empty()) {
+        shared.evict(shared.recent.begin());
+    }
+}
+
+auto keycache::stats() -> statistics {
+    cache& shared = instance();
+    std::lock_guard<std::mutex> lock(shared.mutex);
+    return shared.counts;
+}
@@ -17,8 +17,16 @@ jmp_table:
 .quad x14
 .quad x15
 
+# Constants for the batched lookup, aligned for movdqa
+.p2align 4
+nibble_mask:
+.fill 16, 1, 0x0f
+row_increment:
+.fill 16, 1, 0x01
+
 .section .text
 .global no_cache_lookup
+.global no_cache_lookup_state
 
 no_cache_lookup:
 .intel_syntax noprefix    
@@ -158,3 +166,41 @@ x15:
     pshufb xmm15, xmm0
     pextrb eax, xmm15, 0
     jmp zeroize
+
+# Substitutes all 16 bytes of an AES state in a single pass: rdi -> 16 state bytes (modified in place), rsi -> lookup table
+# Every row of the table is loaded and shuffled with the low nibbles exactly once, and the result is kept only for the
+# bytes whose high nibble selects that row. The memory access pattern and instruction stream never depend on the state.
+no_cache_lookup_state:
+    movdqu xmm0, [rdi]
+    movdqa xmm1, xmm0
+    psrlw xmm1, 4
+    movdqa xmm2, [rip + nibble_mask]
+    pand xmm0, xmm2                     # Low nibble of every byte, the column index for pshufb
+    pand xmm1, xmm2                     # High nibble of every byte, the row holding the substitution
+    movdqa xmm3, [rip + row_increment]
+    pxor xmm4, xmm4                     # Index of the row currently being processed (broadcast)
+    pxor xmm5, xmm5                     # Accumulated substitutions
+    mov ecx, 16
+
+row_loop:
+    movdqa xmm6, [rsi]                  # Load the next 16 entries of the lookup table
+    pshufb xmm6, xmm0                   # Select the column for every byte of the state
+    movdqa xmm7, xmm1
+    pcmpeqb xmm7, xmm4                  # 0xff for the bytes that belong to this row, 0x00 otherwise
+    pand xmm6, xmm7
+    por xmm5, xmm6                      # Blend the selected entries into the result
+    paddb xmm4, xmm3
+    add rsi, 0x10
+    dec ecx
+    jnz row_loop
+
+    movdqu [rdi], xmm5
+
+    # Clear every register that held state or table data
+    pxor xmm0, xmm0
+    pxor xmm1, xmm1
+    pxor xmm4, xmm4
+    pxor xmm5, xmm5
+    pxor xmm6, xmm6
+    pxor xmm7, xmm7
+    ret
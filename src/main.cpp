@@ -1,5 +1,6 @@
 #include "aes.hpp"
 #include "aes_exceptions.hpp"
+#include "calibration.hpp"
 #include "ciphermodes.hpp"
 #include <fstream> // File I/O
 #include <iostream>
@@ -55,6 +56,8 @@ auto main(int argc, const char *argv[]) -> int{
     bool outfile_provided = false;
     bool encrypt = false;
     bool decrypt = false;
+    bool engine_forced = false;
+    bool recalibrate = false;
     u_int64_t testFlags = 256;
      enum MODES_OF_OPERATION {
         ECB = 0,
@@ -80,6 +83,21 @@ auto main(int argc, const char *argv[]) -> int{
               printf("%-40s %s\n", "-in <argument>", "Input filename");
               printf("%-40s %s\n", "-out <argument>", "Output filename");
               printf("%-40s %s\n", "-k <argument>", "Specify key for AES");
+              printf("%-40s %s\n", "--engine <name>", "Run AES on the named engine instead of the default one");
+              printf("%-40s %s\n", "--list-engines", "List the AES engines and whether this processor supports them");
+              printf("%-40s %s\n", "--calibrate", "Time the engines again instead of using the choice recorded for this CPU");
+              printf("%-40s %s\n", "--threads <count>", "Split large messages over at most count threads (default: one per hardware thread)");
+              printf("%-40s %s\n", "--chunk-blocks <count>", "Give every thread at least count blocks (default: 16384)");
+              return EXIT_SUCCESS;
+          }
+
+          if (strncmp(argv[i], "--list-engines", sizeof("--list-engines")) == 0) {
+              printf("%-18s %-16s %-14s %-8s %s\n", "Engine", "Requires", "Constant-time", "Blocks", "Status");
+              for (const aes::engine &engine : aes::engines()) {
+                  const char *status = !engine.supported() ? "unsupported" : (&engine == &aes::active_engine() ? "active" : "supported");
+                  printf("%-18s %-16s %-14s %-8zu %s\n", engine.name, engine.requirements, engine.constant_time ? "yes" : "no",
+                         engine.block_width, status);
+              }
               return EXIT_SUCCESS;
           }
 
@@ -153,6 +171,27 @@ auto main(int argc, const char *argv[]) -> int{
               } else if (strncmp(argv[i + 1], "ofm", sizeof("ofm")) == 0) {
                   mode = OFM;
               }
+          } else if (strncmp(argv[i], "--engine", sizeof("--engine")) == 0) {
+              if(i+1 >= argc ){
+                  std::cerr << "ERROR: No engine provided! The available engines are listed by --list-engines\n";
+                  return EXIT_FAILURE;
+              }
+              aes::set_engine(argv[i + 1]); // throws an aes_error for an unknown or unsupported engine
+              engine_forced = true;
+          } else if (strncmp(argv[i], "--calibrate", sizeof("--calibrate")) == 0) {
+              recalibrate = true;
+          } else if (strncmp(argv[i], "--threads", sizeof("--threads")) == 0) {
+              if(i+1 >= argc ){
+                  std::cerr << "ERROR: No thread count provided!\n";
+                  return EXIT_FAILURE;
+              }
+              ciphermodes::set_thread_count(static_cast<unsigned int>(std::stoul(argv[i + 1])));
+          } else if (strncmp(argv[i], "--chunk-blocks", sizeof("--chunk-blocks")) == 0) {
+              if(i+1 >= argc ){
+                  std::cerr << "ERROR: No chunk size provided!\n";
+                  return EXIT_FAILURE;
+              }
+              ciphermodes::set_chunk_blocks(std::stoul(argv[i + 1]));
           } else if (strncmp(argv[i], "-D", sizeof("-D")) == 0) {
                if(i+1 >= argc ){
                   std::cerr << "ERROR: No debug flags provided!\n";
@@ -202,6 +241,11 @@ auto main(int argc, const char *argv[]) -> int{
           return EXIT_FAILURE;
       }
 
+      // Without --engine, the fastest constant-time engine recorded for this CPU model is used, measured on first use
+      if(!engine_forced && mode != DEBUG){
+          calibration::select_engine(calibration::cache_path(), true, recalibrate);
+      }
+
       if(mode == ECB){
           if(encrypt){
               std::vector<aes::byte> ciphertext = ciphermodes::ECB_Encrypt(input_bytes, key_bytes);
@@ -2,18 +2,41 @@
 #include "aes_exceptions.hpp"
 #include <algorithm>
 #include <chrono>
+#include <cstdio>
+#include <fstream>
 #include <random>
 #include <sstream>
+#include <thread>
 #include <iostream>
+#include <numeric>
+#include "aesni.hpp"
+#include "bitslice.hpp"
+#include "gf256.hpp"
+#include "vperm.hpp"
+#include "calibration.hpp"
 #include "ciphermodes.hpp"
+#include "keycache.hpp"
 #include "yandom.hpp"
 
+namespace {
+    // Bulk test data comes from a seeded PRNG, RDSEED is not meant to be drained thousands of times in a row
+    auto random_bytes(std::mt19937& g, std::size_t count) -> std::vector<aes::byte> {
+        std::uniform_int_distribution<unsigned int> dist(0, 255);
+        std::vector<aes::byte> bytes(count);
+        for (auto& byte : bytes) {
+            byte = static_cast<aes::byte>(dist(g));
+        }
+        return bytes;
+    }
+} // namespace
+
 void tb::test_modules(uint64_t test_flags, std::vector<aes::byte>& plaintext_bytes, const std::vector<aes::byte>& key_bytes) {
     /* In accordance with exp46-c: do not use a bitwise operator with a Boolean-like operand
      * In order to avoid ambiguity, it is recommended to envelop the bitwise operation in parenthesis as seen below.
      */
     if ((test_flags & TEST_NO_CACHE) != 0U) {
         test_no_cache_lookup_timing();
+        test_no_cache_lookup_state_timing();
     }
     if ((test_flags & TEST_MANUAL_SBOX) != 0U){
 	test_manual_sbox();
@@ -67,6 +90,45 @@ void tb::test_modules(uint64_t test_flags, std::vector<aes::byte>& plaintext_byt
     if ((test_flags & TEST_GENERIC) != 0U){
 	test_aes();
     }
+    if ((test_flags & TEST_AESNI) != 0U){
+	test_aesni_accuracy();
+    }
+    if ((test_flags & TEST_BITSLICE) != 0U){
+	test_bitslice_accuracy();
+    }
+    if ((test_flags & TEST_VPERM) != 0U){
+	test_vperm_accuracy();
+    }
+    if ((test_flags & TEST_COLUMN_STATE) != 0U){
+	test_column_state_accuracy();
+    }
+    if ((test_flags & TEST_GF256) != 0U){
+	test_gf256_accuracy();
+    }
+    if ((test_flags & TEST_MULTI_KEY) != 0U){
+	test_multi_key_accuracy();
+    }
+    if ((test_flags & TEST_ENGINES) != 0U){
+	test_engines();
+    }
+    if ((test_flags & TEST_CALIBRATION) != 0U){
+	test_calibration();
+    }
+    if ((test_flags & TEST_COMPACT_KEY) != 0U){
+	test_compact_key();
+    }
+    if ((test_flags & TEST_KEY_CACHE) != 0U){
+	test_key_cache();
+    }
+    if ((test_flags & TEST_SPAN_MODES) != 0U){
+	test_span_modes();
+    }
+    if ((test_flags & TEST_CALLER_BUFFERS) != 0U){
+	test_caller_buffers();
+    }
+    if ((test_flags & TEST_PARALLEL_MODES) != 0U){
+	test_parallel_modes();
+    }
 }
 
 void tb::test_no_cache_lookup_timing() {
@@ -109,6 +171,55 @@ void tb::test_no_cache_lookup_timing() {
     std::cout <<"==========END NO CACHE TEST==========\n";
 }
 
+void tb::test_no_cache_lookup_state_timing() {
+    const unsigned int RUN_COUNT = 1000;
+    double avg_scalar = 0.0;
+    double avg_batched = 0.0;
+
+    // 16 states cover every possible byte value exactly once
+    std::vector<aes::byte> lookup_values{};
+    for (std::size_t i = 0; i < 256; ++i) {
+        lookup_values.push_back(static_cast<aes::byte>(i));
+    }
+    std::random_device rd;
+    std::mt19937 g(rd());
+
+    for (std::size_t l = 0; l < RUN_COUNT; ++l) {
+        std::shuffle(lookup_values.begin(), lookup_values.end(), g); // Shuffle the content of the states for each run
+
+        for (std::size_t s = 0; s < 16; ++s) {
+            std::array<aes::byte, 16> scalar{};
+            std::array<aes::byte, 16> batched{};
+            std::copy_n(lookup_values.begin() + s * 16, 16, batched.begin());
+
+            auto scalar_start = std::chrono::steady_clock::now();
+            for (std::size_t i = 0; i < 16; ++i) {
+                scalar.at(i) = no_cache_lookup(batched.at(i) & 0xF0U, batched.at(i) & 0xFU, aes::S_BOX.data());
+            }
+            auto scalar_end = std::chrono::steady_clock::now();
+
+            auto batched_start = std::chrono::steady_clock::now();
+            no_cache_lookup_state(batched.data(), aes::S_BOX.data());
+            auto batched_end = std::chrono::steady_clock::now();
+
+            if (scalar != batched) {
+                throw testbench_error("no_cache_lookup_state does not match no_cache_lookup!", Tests::NO_CACHE);
+            }
+
+            auto scalar_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(scalar_end - scalar_start).count();
+            auto batched_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(batched_end - batched_start).count();
+            std::size_t run = l * 16 + s;
+            avg_scalar = (avg_scalar * run + scalar_ns) / static_cast<double>(run + 1);
+            avg_batched = (avg_batched * run + batched_ns) / static_cast<double>(run + 1);
+        }
+    }
+
+    std::cout <<"==========NO CACHE STATE TEST==========\n";
+    std::cout << "16x no_cache_lookup average runtime (ns): " << static_cast<int>(avg_scalar) << "\n";
+    std::cout << "no_cache_lookup_state average runtime (ns): " << static_cast<int>(avg_batched) << "\n";
+    std::cout <<"==========END NO CACHE STATE TEST==========\n";
+}
+
 void tb::test_ofm_mode_accuracy(std::vector<aes::byte>& plaintext_bytes, const std::vector<aes::byte>& key_bytes) {
     std::cout <<"==========OFM TEST==========\n";
 
@@ -270,6 +381,52 @@ void tb::test_key_expansion(const std::vector<aes::byte>& key_bytes){
     for(std::size_t i = 0; i <= expand; i++){
         printf("0x%02x \n", expandedKey[i]);
     }
+
+    //every runtime expansion must agree with the FIPS-197 schedules computed at compile time
+    std::vector<std::vector<aes::byte>> batch;
+    std::vector<std::vector<aes::word>> expected;
+    auto check_self_test = [&batch, &expected](const auto& key, const auto& schedule) {
+        std::vector<aes::byte> bytes(key.begin(), key.end());
+        std::array<int, 2> nk_nr = aes::get_Nk_Nr(static_cast<int>(key.size()));
+        std::vector<aes::word> w(aes::NB * (nk_nr[1] + 1));
+        std::vector<aes::word> portable(aes::NB * (nk_nr[1] + 1));
+        aes::key_expansion(bytes, w, nk_nr[0], nk_nr[1]);
+        aes::key_expansion_portable(bytes, portable, nk_nr[0], nk_nr[1]);
+        if (!std::equal(w.begin(), w.end(), schedule.begin(), schedule.end()) || portable != w) {
+            throw testbench_error("Key expansion does not match the compile-time FIPS-197 schedule!", Tests::KEY_EXPANSION);
+        }
+        if (aesni::supported()) {
+            std::vector<aes::word> hardware(aes::NB * (nk_nr[1] + 1));
+            aesni::key_expansion(bytes.data(), nk_nr[0], hardware.data());
+            if (hardware != w) {
+                throw testbench_error("aeskeygenassist key expansion does not match the FIPS-197 schedule!", Tests::KEY_EXPANSION);
+            }
+        }
+        batch.push_back(bytes);
+        expected.push_back(w);
+    };
+    check_self_test(aes::SELF_TEST_KEY_128, aes::SELF_TEST_SCHEDULE_128);
+    check_self_test(aes::SELF_TEST_KEY_192, aes::SELF_TEST_SCHEDULE_192);
+    check_self_test(aes::SELF_TEST_KEY_256, aes::SELF_TEST_SCHEDULE_256);
+
+    //mixed key sizes, with groups that fill some lanes completely and leave others partly empty
+    std::mt19937 g(std::random_device{}());
+    for (std::size_t i = 0; i < 11; i++) {
+        std::vector<aes::byte> key = random_bytes(g, i % 3 == 0 ? 16 : (i % 3 == 1 ? 32 : 24));
+        std::array<int, 2> nk_nr = aes::get_Nk_Nr(static_cast<int>(key.size()));
+        std::vector<aes::word> w(aes::NB * (nk_nr[1] + 1));
+        aes::key_expansion_portable(key, w, nk_nr[0], nk_nr[1]);
+        batch.push_back(key);
+        expected.push_back(w);
+    }
+    std::vector<aes::KeySchedule> schedules = aes::expand_keys(batch);
+    for (std::size_t k = 0; k < batch.size(); k++) {
+        aes::KeySchedule single(static_cast<unsigned int>(expected[k].size() / aes::NB - 1), expected[k]);
+        if (schedules[k].Nr != single.Nr || schedules[k].encryption_words != single.encryption_words ||
+            schedules[k].decryption_blocks != single.decryption_blocks) {
+            throw testbench_error("Batched key expansion does not match the single key expansion!", Tests::KEY_EXPANSION);
+        }
+    }
     std::cout <<"==========END KEY EXPANSION TEST==========\n";
 }
 
@@ -305,10 +462,34 @@ void tb::test_manual_sbox(){
         }
     }
 
+    // The register forms substitute 16 bytes per call, both S-boxes must match the tables for every byte
+    double state_ns = 0.0;
+    for (std::size_t first = 0; first < 256; first += 16) {
+        alignas(16) std::array<aes::byte, 16> bytes{};
+        for (std::size_t i = 0; i < 16; ++i) {
+            bytes.at(i) = static_cast<aes::byte>(first + i);
+        }
+        alignas(16) std::array<aes::byte, 16> forward{};
+        alignas(16) std::array<aes::byte, 16> inverse{};
+        const __m128i vector = _mm_load_si128(reinterpret_cast<const __m128i*>(bytes.data()));
+        auto state_start = std::chrono::steady_clock::now();
+        _mm_store_si128(reinterpret_cast<__m128i*>(forward.data()), aes::get_S_BOX_state(vector));
+        auto state_end = std::chrono::steady_clock::now();
+        _mm_store_si128(reinterpret_cast<__m128i*>(inverse.data()), aes::get_inverse_S_BOX_state(vector));
+        state_ns += static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(state_end - state_start).count());
+
+        for (std::size_t i = 0; i < 16; ++i) {
+            if (forward.at(i) != aes::S_BOX.at(first + i) || inverse.at(i) != aes::INV_S_BOX.at(first + i)) {
+                throw testbench_error("Computed 16-byte S-box does not match the tables!", Tests::MANUAL_SBOX);
+            }
+        }
+    }
+
     std::cout <<"==========MANUAL S-BOX  TEST==========\n";
     for (std::size_t i = 0; i < 256; ++i) {
         std::cout << static_cast<std::size_t>(i) << ": " << static_cast<int>(avg_runtimes[i]) << "\n";
     }
+    std::cout << "16-byte S-box: " << state_ns / 16 << " ns per register\n";
     std::cout <<"==========END MANUAL S-BOX TEST==========\n";
 }
 
@@ -352,6 +533,8 @@ void tb:: test_mixColumns_timing(){
         const unsigned int RUN_COUNT = 1000;
 
         std::vector<double> avg_runtimes(5, 0.0);
+        std::vector<double> avg_sse_runtimes(5, 0.0);
+        std::vector<double> avg_pair_runtimes(5, 0.0);
         std::vector<aes::state> states;
         std::vector<int> shuffleVector = {0,1,2,3,4};
         for(std::size_t i=0; i<5; i++){
@@ -363,6 +546,30 @@ void tb:: test_mixColumns_timing(){
                 aes:: state state = ciphermodes::convert_block_to_state(arr);
                 states.push_back(state);
         }
+
+        //the vector kernels must be drop-in replacements for the scalar ones
+        for (std::size_t i = 0; i < 5; ++i) {
+                aes::state expected = states[i];
+                aes::state sse = states[i];
+                aes::state first = states[i];
+                aes::state second = states[(i + 1) % 5];
+                aes::state expected_second = second;
+                aes::mix_columns(expected);
+                aes::mix_columns(expected_second);
+                aes::mix_columns_sse(sse);
+                aes::mix_columns_pair(first, second);
+                if (sse != expected || first != expected || second != expected_second) {
+                        throw testbench_error("Vector mix columns does not match the scalar kernel!", Tests::MIX_COLUMNS);
+                }
+                aes::inv_mix_columns(expected);
+                aes::inv_mix_columns(expected_second);
+                aes::inv_mix_columns_sse(sse);
+                aes::inv_mix_columns_pair(first, second);
+                if (sse != expected || first != expected || second != expected_second || expected != states[i]) {
+                        throw testbench_error("Vector inverse mix columns does not match the scalar kernel!", Tests::MIX_COLUMNS);
+                }
+        }
+
         std::random_device rd;
         std::mt19937 g(rd());
         for (std::size_t l = 0; l < RUN_COUNT; ++l) {
@@ -374,12 +581,29 @@ void tb:: test_mixColumns_timing(){
                         auto mix_end = std::chrono::steady_clock::now();
                         auto mix_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(mix_end - mix_start).count();
                         avg_runtimes[i] = (avg_runtimes[i] * l + mix_ns) / static_cast<double>(l + 1);
+
+                        val = states[i];
+                        mix_start = std::chrono::steady_clock::now();
+                        aes::mix_columns_sse(val);
+                        mix_end = std::chrono::steady_clock::now();
+                        mix_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(mix_end - mix_start).count();
+                        avg_sse_runtimes[i] = (avg_sse_runtimes[i] * l + mix_ns) / static_cast<double>(l + 1);
+
+                        val = states[i];
+                        aes::state other = states[(i + 1) % 5];
+                        mix_start = std::chrono::steady_clock::now();
+                        aes::mix_columns_pair(val, other);
+                        mix_end = std::chrono::steady_clock::now();
+                        mix_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(mix_end - mix_start).count();
+                        avg_pair_runtimes[i] = (avg_pair_runtimes[i] * l + mix_ns) / static_cast<double>(l + 1);
                 }
         }
         std::cout <<"==========MIXCOLUMNS TIMING TEST==========\n";
         for (std::size_t i = 0; i < 5; ++i) {
                 aes::debug_print_state(states[i]);
                 std::cout << "Average runtime (ns):"<<static_cast<int>(avg_runtimes[i])<<"\n";
+                std::cout << "Average SSE runtime (ns):"<<static_cast<int>(avg_sse_runtimes[i])<<"\n";
+                std::cout << "Average runtime for two states (ns):"<<static_cast<int>(avg_pair_runtimes[i])<<"\n";
         }
         std::cout <<"==========END MIXCOLUMNS TIMING TEST==========\n";
 }
@@ -1119,3 +1343,913 @@ void tb::test_aes(){
         b += 1U;
     }  
 }
+
+
+void tb::test_aesni_accuracy(){
+    const unsigned int RUN_COUNT = 1000;
+
+    std::cout <<"==========AES-NI ACCURACY TEST==========\n";
+    if (!aesni::supported()) {
+        std::cout << "AES-NI is not supported on this processor, skipping\n";
+        std::cout <<"==========END AES-NI ACCURACY TEST==========\n";
+        return;
+    }
+
+    std::random_device rd;
+    std::mt19937 g(rd());
+    for (int key_size : {16, 24, 32}) {
+        std::array<int, 2> nk_nr = aes::get_Nk_Nr(key_size);
+
+        for (std::size_t l = 0; l < RUN_COUNT; ++l) {
+            std::vector<aes::byte> key = random_bytes(g, key_size);
+            std::vector<aes::word> expandedKey(aes::NB * (nk_nr[1] + 1));
+            aes::key_expansion(key, expandedKey, nk_nr[0], nk_nr[1]);
+
+            std::vector<aes::byte> block = random_bytes(g, 16);
+            aes::state portable = ciphermodes::convert_block_to_state(block);
+            aes::state hardware = portable;
+
+            aes::encrypt_portable(nk_nr[1], portable, expandedKey);
+            aesni::encrypt(nk_nr[1], hardware, expandedKey);
+            if (portable != hardware) {
+                throw testbench_error("AES-NI encryption does not match the portable engine!", Tests::AESNI);
+            }
+
+            aes::decrypt_portable(nk_nr[1], portable, expandedKey);
+            aesni::decrypt(nk_nr[1], hardware, expandedKey);
+            if (portable != hardware || ciphermodes::convert_state_to_block(hardware) != block) {
+                throw testbench_error("AES-NI decryption does not match the portable engine!", Tests::AESNI);
+            }
+
+            // Cycle the pipeline through full groups, the half group and the single block tail
+            const aes::KeySchedule schedule(nk_nr[1], expandedKey);
+            std::size_t block_count = l % (2 * aesni::PIPELINE_BLOCKS + 8);
+            std::vector<aes::byte> plaintext = random_bytes(g, 16 * block_count);
+            std::vector<aes::byte> expected(plaintext.size());
+            for (std::size_t i = 0; i < block_count; ++i) {
+                aesni::encrypt_block(schedule, &plaintext[16 * i], &expected[16 * i]);
+            }
+            std::vector<aes::byte> pipelined = plaintext;
+            aesni::encrypt_blocks(schedule, pipelined.data(), pipelined.data(), block_count);
+            if (pipelined != expected) {
+                throw testbench_error("Pipelined AES-NI encryption does not match single blocks!", Tests::AESNI);
+            }
+            aesni::decrypt_blocks(schedule, pipelined.data(), pipelined.data(), block_count);
+            if (pipelined != plaintext) {
+                throw testbench_error("Pipelined AES-NI decryption does not recover the plaintext!", Tests::AESNI);
+            }
+        }
+        std::cout << "AES-" << key_size * 8 << ": " << RUN_COUNT << " random blocks and pipelined runs match\n";
+    }
+    std::cout <<"==========END AES-NI ACCURACY TEST==========\n";
+}
+
+void tb::test_bitslice_accuracy(){
+    const unsigned int RUN_COUNT = 100;
+
+    std::cout <<"==========BITSLICE ACCURACY TEST==========\n";
+    std::random_device rd;
+    std::mt19937 g(rd());
+    for (int key_size : {16, 24, 32}) {
+        std::array<int, 2> nk_nr = aes::get_Nk_Nr(key_size);
+
+        for (std::size_t l = 0; l < RUN_COUNT; ++l) {
+            std::vector<aes::byte> key = random_bytes(g, key_size);
+            std::vector<aes::word> expandedKey(aes::NB * (nk_nr[1] + 1));
+            aes::key_expansion(key, expandedKey, nk_nr[0], nk_nr[1]);
+            const aes::KeySchedule schedule(nk_nr[1], expandedKey);
+
+            // Cycle through partial, full and multiple batches
+            std::size_t block_count = 1 + l % (2 * bitslice::BLOCKS_PER_BATCH + 1);
+            std::vector<aes::byte> plaintext = random_bytes(g, 16 * block_count);
+
+            std::vector<aes::byte> ciphertext(plaintext.size());
+            bitslice::encrypt_blocks(schedule, plaintext.data(), ciphertext.data(), block_count);
+
+            for (std::size_t i = 0; i < block_count; ++i) {
+                std::vector<aes::byte> block(plaintext.begin() + 16 * i, plaintext.begin() + 16 * (i + 1));
+                aes::state state = ciphermodes::convert_block_to_state(block);
+                aes::encrypt_portable(nk_nr[1], state, expandedKey);
+                if (!std::equal(ciphertext.begin() + 16 * i, ciphertext.begin() + 16 * (i + 1), ciphermodes::convert_state_to_block(state).begin())) {
+                    throw testbench_error("Bitsliced encryption does not match the portable engine!", Tests::BITSLICE);
+                }
+            }
+
+            std::vector<aes::byte> decrypted(ciphertext.size());
+            bitslice::decrypt_blocks(schedule, ciphertext.data(), decrypted.data(), block_count);
+            if (decrypted != plaintext) {
+                throw testbench_error("Bitsliced decryption does not recover the plaintext!", Tests::BITSLICE);
+            }
+        }
+        std::cout << "AES-" << key_size * 8 << ": " << RUN_COUNT << " random batches match\n";
+    }
+    std::cout <<"==========END BITSLICE ACCURACY TEST==========\n";
+}
+
+void tb::test_vperm_accuracy(){
+    const unsigned int RUN_COUNT = 1000;
+
+    std::cout <<"==========VPERM ACCURACY TEST==========\n";
+    if (!vperm::supported()) {
+        std::cout << "SSSE3 is not supported on this processor, skipping\n";
+        std::cout <<"==========END VPERM ACCURACY TEST==========\n";
+        return;
+    }
+
+    std::random_device rd;
+    std::mt19937 g(rd());
+    for (int key_size : {16, 24, 32}) {
+        std::array<int, 2> nk_nr = aes::get_Nk_Nr(key_size);
+
+        for (std::size_t l = 0; l < RUN_COUNT; ++l) {
+            std::vector<aes::byte> key = random_bytes(g, key_size);
+            std::vector<aes::word> expandedKey(aes::NB * (nk_nr[1] + 1));
+            aes::key_expansion(key, expandedKey, nk_nr[0], nk_nr[1]);
+
+            std::vector<aes::byte> block = random_bytes(g, 16);
+            aes::state portable = ciphermodes::convert_block_to_state(block);
+            aes::state vector_permute = portable;
+
+            aes::encrypt_portable(nk_nr[1], portable, expandedKey);
+            vperm::encrypt(nk_nr[1], vector_permute, expandedKey);
+            if (portable != vector_permute) {
+                throw testbench_error("Vector-permute encryption does not match the portable engine!", Tests::VPERM);
+            }
+
+            aes::decrypt_portable(nk_nr[1], portable, expandedKey);
+            vperm::decrypt(nk_nr[1], vector_permute, expandedKey);
+            if (portable != vector_permute || ciphermodes::convert_state_to_block(vector_permute) != block) {
+                throw testbench_error("Vector-permute decryption does not match the portable engine!", Tests::VPERM);
+            }
+        }
+        std::cout << "AES-" << key_size * 8 << ": " << RUN_COUNT << " random blocks match\n";
+    }
+    std::cout <<"==========END VPERM ACCURACY TEST==========\n";
+}
+
+void tb::test_column_state_accuracy(){
+    const unsigned int RUN_COUNT = 1000;
+
+    std::cout <<"==========COLUMN STATE ACCURACY TEST==========\n";
+    std::random_device rd;
+    std::mt19937 g(rd());
+    for (int key_size : {16, 24, 32}) {
+        std::array<int, 2> nk_nr = aes::get_Nk_Nr(key_size);
+
+        for (std::size_t l = 0; l < RUN_COUNT; ++l) {
+            std::vector<aes::byte> key = random_bytes(g, key_size);
+            std::vector<aes::word> expandedKey(aes::NB * (nk_nr[1] + 1));
+            aes::key_expansion(key, expandedKey, nk_nr[0], nk_nr[1]);
+            const aes::KeySchedule schedule(key);
+
+            std::vector<aes::byte> block = random_bytes(g, 16);
+            aes::state portable = ciphermodes::convert_block_to_state(block);
+            aes::encrypt_portable(nk_nr[1], portable, expandedKey);
+            std::vector<aes::byte> expected = ciphermodes::convert_state_to_block(portable);
+
+            // Fused rounds on the word-oriented state
+            std::vector<aes::byte> fused(16);
+            aes::column_state columns = aes::load_columns(block.data());
+            aes::encrypt_columns(columns, schedule);
+            aes::store_columns(columns, fused.data());
+            if (fused != expected) {
+                throw testbench_error("Fused round encryption does not match the portable engine!", Tests::COLUMN_STATE);
+            }
+            aes::decrypt_columns(columns, schedule);
+            aes::store_columns(columns, fused.data());
+            if (fused != block) {
+                throw testbench_error("Fused round decryption does not recover the block!", Tests::COLUMN_STATE);
+            }
+
+            // Dispatched block entry point used by the cipher modes
+            std::vector<aes::byte> dispatched = block;
+            aes::encrypt_block(schedule, dispatched.data(), dispatched.data());
+            if (dispatched != expected) {
+                throw testbench_error("Block encryption does not match the portable engine!", Tests::COLUMN_STATE);
+            }
+            aes::decrypt_block(schedule, dispatched.data(), dispatched.data());
+            if (dispatched != block) {
+                throw testbench_error("Block decryption does not recover the block!", Tests::COLUMN_STATE);
+            }
+        }
+        std::cout << "AES-" << key_size * 8 << ": " << RUN_COUNT << " random blocks match\n";
+    }
+    std::cout <<"==========END COLUMN STATE ACCURACY TEST==========\n";
+}
+
+void tb::test_gf256_accuracy(){
+    std::cout <<"==========GF256 ACCURACY TEST==========\n";
+
+    // Textbook shift-and-add multiplication, branching on the operand bits
+    auto reference_multiply = [](aes::byte a, aes::byte b) {
+        aes::byte product = 0;
+        while (b != 0) {
+            if ((b & 1U) != 0) {
+                product ^= a;
+            }
+            a = static_cast<aes::byte>((a & 0x80U) != 0 ? (a << 1U) ^ 0x1bU : a << 1U);
+            b >>= 1U;
+        }
+        return product;
+    };
+
+    for (unsigned int a = 0; a < 256; ++a) {
+        auto x = static_cast<aes::byte>(a);
+        if (gf256::mul9(x) != reference_multiply(x, 0x09) || gf256::mulb(x) != reference_multiply(x, 0x0b) ||
+            gf256::muld(x) != reference_multiply(x, 0x0d) || gf256::mule(x) != reference_multiply(x, 0x0e) ||
+            aes::field_multiply_by_2(x) != reference_multiply(x, 0x02)) {
+            throw testbench_error("Fixed GF(2^8) multiplication chain is incorrect!", Tests::GF256);
+        }
+
+        // 16 multipliers per register, covering every pair of operands
+        for (unsigned int b = 0; b < 256; b += 16) {
+            alignas(16) std::array<aes::byte, 16> multipliers{};
+            for (unsigned int i = 0; i < 16; ++i) {
+                multipliers.at(i) = static_cast<aes::byte>(b + i);
+            }
+            alignas(16) std::array<aes::byte, 16> products{};
+            __m128i vector_a = _mm_set1_epi8(static_cast<char>(x));
+            __m128i vector_b = _mm_load_si128(reinterpret_cast<const __m128i*>(multipliers.data()));
+            _mm_store_si128(reinterpret_cast<__m128i*>(products.data()), gf256::multiply_state(vector_a, vector_b));
+
+            for (unsigned int i = 0; i < 16; ++i) {
+                aes::byte expected = reference_multiply(x, multipliers.at(i));
+                if (gf256::multiply(x, multipliers.at(i)) != expected || aes::field_multiply(x, multipliers.at(i)) != expected || products.at(i) != expected) {
+                    throw testbench_error("GF(2^8) multiplication is incorrect!", Tests::GF256);
+                }
+            }
+        }
+    }
+
+    // Packed variants against the scalar chains
+    for (unsigned int first = 0; first < 256; first += 16) {
+        alignas(16) std::array<aes::byte, 16> bytes{};
+        for (unsigned int i = 0; i < 16; ++i) {
+            bytes.at(i) = static_cast<aes::byte>(first + i);
+        }
+        const __m128i vector = _mm_load_si128(reinterpret_cast<const __m128i*>(bytes.data()));
+        const std::array<aes::byte, 5> factors = {0x02, 0x09, 0x0b, 0x0d, 0x0e};
+        alignas(16) std::array<aes::byte, 16 * 5> results{};
+        auto* result_vectors = reinterpret_cast<__m128i*>(results.data());
+        _mm_store_si128(result_vectors, gf256::xtime_state(vector));
+        _mm_store_si128(result_vectors + 1, gf256::mul9_state(vector));
+        _mm_store_si128(result_vectors + 2, gf256::mulb_state(vector));
+        _mm_store_si128(result_vectors + 3, gf256::muld_state(vector));
+        _mm_store_si128(result_vectors + 4, gf256::mule_state(vector));
+        for (std::size_t r = 0; r < factors.size(); ++r) {
+            const aes::byte* products = results.data() + 16 * r;
+            for (unsigned int i = 0; i < 16; ++i) {
+                if (products[i] != reference_multiply(bytes.at(i), factors.at(r))) {
+                    throw testbench_error("Vector GF(2^8) multiplication chain is incorrect!", Tests::GF256);
+                }
+            }
+        }
+
+        for (unsigned int i = 0; i < 16; i += 4) {
+            aes::word packed = aes::buildWord(bytes.at(i), bytes.at(i + 1), bytes.at(i + 2), bytes.at(i + 3));
+            std::array<aes::byte, 4> doubled = aes::splitWord(gf256::xtime_word(packed));
+            for (unsigned int j = 0; j < 4; ++j) {
+                if (doubled.at(j) != gf256::xtime(bytes.at(i + j))) {
+                    throw testbench_error("Word GF(2^8) xtime is incorrect!", Tests::GF256);
+                }
+            }
+        }
+
+        // Inversion: a * a^-1 = 1 for every non-zero byte, 0 maps to 0
+        alignas(16) std::array<aes::byte, 16> inverses{};
+        _mm_store_si128(reinterpret_cast<__m128i*>(inverses.data()), gf256::inverse_state(vector));
+        for (unsigned int i = 0; i < 16; ++i) {
+            aes::byte inverse = gf256::inverse(bytes.at(i));
+            if ((bytes.at(i) == 0 ? inverse != 0 : reference_multiply(bytes.at(i), inverse) != 1) || inverses.at(i) != inverse) {
+                throw testbench_error("GF(2^8) inversion is incorrect!", Tests::GF256);
+            }
+        }
+    }
+    std::cout << "All 65536 products and 256 inverses match\n";
+    std::cout <<"==========END GF256 ACCURACY TEST==========\n";
+}
+
+void tb::test_multi_key_accuracy(){
+    std::cout <<"==========MULTI KEY ACCURACY TEST==========\n";
+
+    std::mt19937 g(std::random_device{}());
+    std::vector<aes::KeySchedule> keys;
+    for (std::size_t size : {16, 24, 32, 16, 16, 32, 24, 16, 32}) {
+        keys.emplace_back(random_bytes(g, size));
+    }
+
+    //block counts around the lane count, with one key size throughout and with the key sizes interleaved
+    for (std::size_t block_count : {1, 7, 8, 9, 16, 37}) {
+        for (bool mixed : {false, true}) {
+            std::vector<const aes::KeySchedule*> schedules(block_count);
+            for (std::size_t k = 0; k < block_count; k++) {
+                schedules[k] = mixed ? &keys[g() % keys.size()] : &keys[(k % 2) * 3];
+            }
+            std::vector<aes::byte> plaintext = random_bytes(g, 16 * block_count);
+            std::vector<aes::byte> expected(plaintext.size());
+            std::vector<aes::byte> ciphertext(plaintext.size());
+            for (std::size_t k = 0; k < block_count; k++) {
+                aes::encrypt_block(*schedules[k], &plaintext[16 * k], &expected[16 * k]);
+            }
+
+            aes::encrypt_multi(schedules, plaintext.data(), ciphertext.data());
+            if (ciphertext != expected) {
+                throw testbench_error("encrypt_multi does not match per-block encryption!", Tests::MULTI_KEY);
+            }
+            std::vector<aes::byte> decrypted(plaintext.size());
+            aes::decrypt_multi(schedules, ciphertext.data(), decrypted.data());
+            if (decrypted != plaintext) {
+                throw testbench_error("decrypt_multi does not invert encrypt_multi!", Tests::MULTI_KEY);
+            }
+
+            //in place
+            aes::encrypt_multi(schedules, decrypted.data(), decrypted.data());
+            if (decrypted != expected) {
+                throw testbench_error("In-place encrypt_multi does not match per-block encryption!", Tests::MULTI_KEY);
+            }
+        }
+    }
+    std::cout << "All batches match per-block encryption\n";
+    std::cout <<"==========END MULTI KEY ACCURACY TEST==========\n";
+}
+
+void tb::test_engines(){
+    std::cout <<"==========ENGINE ACCURACY TEST==========\n";
+
+    //FIPS-197 appendix C: the same plaintext under 128, 192 and 256-bit keys counting up from 0x00
+    const std::vector<aes::byte> fips_plaintext = {0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
+                                                   0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff};
+    const std::vector<std::vector<aes::byte>> fips_ciphertexts = {
+        {0x69, 0xc4, 0xe0, 0xd8, 0x6a, 0x7b, 0x04, 0x30, 0xd8, 0xcd, 0xb7, 0x80, 0x70, 0xb4, 0xc5, 0x5a},
+        {0xdd, 0xa9, 0x7c, 0xa4, 0x86, 0x4c, 0xdf, 0xe0, 0x6e, 0xaf, 0x70, 0xa0, 0xec, 0x0d, 0x71, 0x91},
+        {0x8e, 0xa2, 0xb7, 0xca, 0x51, 0x67, 0x45, 0xbf, 0xea, 0xfc, 0x49, 0x90, 0x4b, 0x49, 0x60, 0x89}};
+
+    std::mt19937 g(std::random_device{}());
+    //37 blocks covers full batches of every engine plus a partial one
+    const std::size_t BLOCK_COUNT = 37;
+    const std::vector<aes::byte> plaintext = random_bytes(g, 16 * BLOCK_COUNT);
+
+    const std::string original_engine = aes::active_engine().name;
+    for (std::size_t size = 0; size < 3; size++) {
+        std::vector<aes::byte> fips_key(16 + 8 * size);
+        std::iota(fips_key.begin(), fips_key.end(), 0);
+        const aes::KeySchedule fips_schedule(fips_key);
+        const std::vector<aes::byte> random_key = random_bytes(g, 16 + 8 * size);
+        const aes::KeySchedule schedule(random_key);
+
+        //the table engine is the plain FIPS-197 algorithm, every other engine has to agree with it
+        aes::set_engine("table");
+        std::vector<aes::byte> expected(plaintext.size());
+        for (std::size_t k = 0; k < BLOCK_COUNT; k++) {
+            aes::encrypt_block(schedule, &plaintext[16 * k], &expected[16 * k]);
+        }
+
+        for (const aes::engine &engine : aes::engines()) {
+            if (!engine.supported()) {
+                std::cout << "Skipping " << engine.name << ", this processor lacks " << engine.requirements << "\n";
+                continue;
+            }
+            aes::set_engine(engine.name);
+            const std::string failure = std::string(engine.name) + " engine, " + std::to_string(128 + 64 * size) + "-bit key: ";
+
+            std::vector<aes::byte> block(16);
+            aes::encrypt_block(fips_schedule, fips_plaintext.data(), block.data());
+            if (block != fips_ciphertexts[size]) {
+                throw testbench_error((failure + "encrypt_block does not match FIPS-197!").c_str(), Tests::ENGINES);
+            }
+            aes::decrypt_block(fips_schedule, block.data(), block.data());
+            if (block != fips_plaintext) {
+                throw testbench_error((failure + "decrypt_block does not match FIPS-197!").c_str(), Tests::ENGINES);
+            }
+
+            std::vector<aes::byte> ciphertext(plaintext.size());
+            aes::encrypt_blocks(schedule, plaintext.data(), ciphertext.data(), BLOCK_COUNT);
+            if (ciphertext != expected) {
+                throw testbench_error((failure + "encrypt_blocks does not match the table engine!").c_str(), Tests::ENGINES);
+            }
+            std::vector<aes::byte> decrypted(plaintext.size());
+            aes::decrypt_blocks(schedule, ciphertext.data(), decrypted.data(), BLOCK_COUNT);
+            if (decrypted != plaintext) {
+                throw testbench_error((failure + "decrypt_blocks does not invert encrypt_blocks!").c_str(), Tests::ENGINES);
+            }
+
+            //the state entry point, which falls back to the block routine for engines without a state form
+            const std::vector<aes::word> w(schedule.encryption_words.begin(), schedule.encryption_words.begin() + aes::NB * (schedule.Nr + 1));
+            aes::state state{};
+            for (std::size_t c = 0; c < aes::NB; c++) {
+                for (std::size_t r = 0; r < 4; r++) {
+                    state[r][c] = plaintext[4 * c + r];
+                }
+            }
+            const aes::state original = state;
+            aes::encrypt(schedule.Nr, state, w);
+            for (std::size_t c = 0; c < aes::NB; c++) {
+                for (std::size_t r = 0; r < 4; r++) {
+                    if (state[r][c] != expected[4 * c + r]) {
+                        throw testbench_error((failure + "encrypt does not match the table engine!").c_str(), Tests::ENGINES);
+                    }
+                }
+            }
+            aes::decrypt(schedule.Nr, state, w);
+            if (state != original) {
+                throw testbench_error((failure + "decrypt does not invert encrypt!").c_str(), Tests::ENGINES);
+            }
+        }
+    }
+    aes::set_engine(original_engine);
+
+    std::cout << "Every supported engine matches FIPS-197 and the table engine\n";
+    std::cout <<"==========END ENGINE ACCURACY TEST==========\n";
+}
+
+void tb::test_calibration(){
+    std::cout <<"==========ENGINE CALIBRATION TEST==========\n";
+    const std::string cache_file = "calibration_test_cache";
+    const std::string original_engine = aes::active_engine().name;
+    std::remove(cache_file.c_str());
+
+    std::cout << "CPU model: " << calibration::cpu_model() << "\n";
+    for (const aes::engine& engine : aes::engines()) {
+        if (engine.supported()) {
+            std::cout << engine.name << ": " << calibration::measure(engine) << " ns per block\n";
+        }
+    }
+
+    //first use: measures, activates and records the engine
+    const aes::engine& chosen = calibration::select_engine(cache_file, true);
+    if (!chosen.supported() || !chosen.constant_time || &aes::active_engine() != &chosen) {
+        throw testbench_error("Calibration activated an unsupported or variable-time engine!", Tests::CALIBRATION);
+    }
+    std::cout << "Calibration chose " << chosen.name << "\n";
+
+    //a recorded entry is used as is, even when it is not the fastest engine
+    {
+        std::ofstream cache(cache_file, std::ios::out | std::ios::trunc);
+        cache << "Some other CPU\tct\tvperm\n" << calibration::cpu_model() << "\tct\tbitslice\n";
+    }
+    if (std::string(calibration::select_engine(cache_file, true).name) != "bitslice") {
+        throw testbench_error("Calibration did not reuse the engine recorded for this CPU!", Tests::CALIBRATION);
+    }
+
+    //a variable-time or unknown entry does not satisfy the constant-time level, it is measured again and replaced
+    {
+        std::ofstream cache(cache_file, std::ios::out | std::ios::trunc);
+        cache << "Some other CPU\tct\tvperm\n" << calibration::cpu_model() << "\tct\ttable\n";
+    }
+    const aes::engine& remeasured = calibration::select_engine(cache_file, true);
+    std::ifstream cache(cache_file);
+    std::stringstream contents;
+    contents << cache.rdbuf();
+    if (!remeasured.constant_time || contents.str() != "Some other CPU\tct\tvperm\n" + calibration::cpu_model() + "\tct\t" + remeasured.name + "\n") {
+        throw testbench_error("Calibration did not replace an unusable cache entry!", Tests::CALIBRATION);
+    }
+
+    std::remove(cache_file.c_str());
+    aes::set_engine(original_engine);
+    std::cout <<"==========END ENGINE CALIBRATION TEST==========\n";
+}
+
+void tb::test_compact_key(){
+    const unsigned int RUN_COUNT = 10000;
+    std::cout <<"==========COMPACT KEY ACCURACY TEST==========\n";
+    std::cout << "sizeof(KeySchedule): " << sizeof(aes::KeySchedule) << " bytes, sizeof(CompactKey): " << sizeof(aes::CompactKey) << " bytes\n";
+
+    std::mt19937 g(std::random_device{}());
+    const std::string original_engine = aes::active_engine().name;
+    for (const aes::engine& engine : aes::engines()) {
+        if (!engine.supported()) {
+            continue;
+        }
+        aes::set_engine(engine.name);
+        for (std::size_t size : {16, 24, 32}) {
+            for (unsigned int k = 0; k < 20; k++) {
+                const std::vector<aes::byte> key_bytes = random_bytes(g, size);
+                const aes::KeySchedule schedule(key_bytes);
+                const aes::CompactKey key(key_bytes);
+                const std::vector<aes::byte> plaintext = random_bytes(g, 16);
+
+                std::vector<aes::byte> expected(16);
+                std::vector<aes::byte> block(16);
+                aes::encrypt_block(schedule, plaintext.data(), expected.data());
+                aes::encrypt_block(key, plaintext.data(), block.data());
+                if (block != expected) {
+                    throw testbench_error((std::string(engine.name) + " engine: compact encryption does not match the key schedule!").c_str(), Tests::COMPACT_KEY);
+                }
+                aes::decrypt_block(key, block.data(), block.data());
+                if (block != plaintext) {
+                    throw testbench_error((std::string(engine.name) + " engine: compact decryption does not invert encryption!").c_str(), Tests::COMPACT_KEY);
+                }
+
+                aes::state state{};
+                for (std::size_t c = 0; c < aes::NB; c++) {
+                    for (std::size_t r = 0; r < 4; r++) {
+                        state[r][c] = plaintext[4 * c + r];
+                    }
+                }
+                aes::encrypt(key, state);
+                for (std::size_t c = 0; c < aes::NB; c++) {
+                    for (std::size_t r = 0; r < 4; r++) {
+                        if (state[r][c] != expected[4 * c + r]) {
+                            throw testbench_error((std::string(engine.name) + " engine: compact state encryption does not match the key schedule!").c_str(), Tests::COMPACT_KEY);
+                        }
+                    }
+                }
+                aes::decrypt(key, state);
+                for (std::size_t c = 0; c < aes::NB; c++) {
+                    for (std::size_t r = 0; r < 4; r++) {
+                        if (state[r][c] != plaintext[4 * c + r]) {
+                            throw testbench_error((std::string(engine.name) + " engine: compact state decryption does not invert encryption!").c_str(), Tests::COMPACT_KEY);
+                        }
+                    }
+                }
+            }
+        }
+
+        //cost of regenerating the round keys, for a 256-bit key
+        const std::vector<aes::byte> key_bytes = random_bytes(g, 32);
+        const aes::KeySchedule schedule(key_bytes);
+        const aes::CompactKey key(key_bytes);
+        std::vector<aes::byte> block = random_bytes(g, 16);
+        auto start = std::chrono::high_resolution_clock::now();
+        for (unsigned int run = 0; run < RUN_COUNT; run++) {
+            aes::encrypt_block(schedule, block.data(), block.data());
+            aes::decrypt_block(schedule, block.data(), block.data());
+        }
+        auto middle = std::chrono::high_resolution_clock::now();
+        for (unsigned int run = 0; run < RUN_COUNT; run++) {
+            aes::encrypt_block(key, block.data(), block.data());
+            aes::decrypt_block(key, block.data(), block.data());
+        }
+        auto stop = std::chrono::high_resolution_clock::now();
+        std::cout << engine.name << ": " << std::chrono::duration<double, std::nano>(middle - start).count() / (2 * RUN_COUNT)
+                  << " ns per block with the schedule, " << std::chrono::duration<double, std::nano>(stop - middle).count() / (2 * RUN_COUNT)
+                  << " ns per block with the compact key\n";
+    }
+    aes::set_engine(original_engine);
+
+    std::cout << "Compact keys match their key schedules on every supported engine\n";
+    std::cout <<"==========END COMPACT KEY ACCURACY TEST==========\n";
+}
+
+void tb::test_key_cache(){
+    const unsigned int RUN_COUNT = 20000;
+    const unsigned int THREAD_COUNT = 4;
+    std::cout <<"==========KEY CACHE TEST==========\n";
+
+    //reference vectors of the SipHash paper: key 00 .. 0f, messages 00 .. (length - 1)
+    std::array<uint64_t, 2> sip_key = {0x0706050403020100ULL, 0x0f0e0d0c0b0a0908ULL};
+    std::vector<aes::byte> message(15);
+    std::iota(message.begin(), message.end(), 0);
+    if (keycache::siphash(sip_key, message.data(), 0) != 0x726fdb47dd0e0e31ULL || keycache::siphash(sip_key, message.data(), 15) != 0xa129ca6149be45e5ULL) {
+        throw testbench_error("SipHash-2-4 does not match its reference vectors!", Tests::KEY_CACHE);
+    }
+
+    std::mt19937 g(std::random_device{}());
+    const std::size_t original_capacity = keycache::capacity();
+    keycache::clear();
+    keycache::set_capacity(3);
+
+    //a repeated key is a hit on the same schedule, which matches a fresh expansion
+    const std::vector<aes::byte> first_key = random_bytes(g, 16);
+    std::shared_ptr<const aes::KeySchedule> first = keycache::schedule(first_key);
+    if (keycache::schedule(first_key) != first || first->encryption_words != aes::KeySchedule(first_key).encryption_words) {
+        throw testbench_error("A cached key was not reused!", Tests::KEY_CACHE);
+    }
+
+    //a key that only shares a prefix with another one is a different entry
+    std::vector<aes::byte> longer_key = first_key;
+    longer_key.resize(32);
+    if (keycache::schedule(longer_key) == first || keycache::schedule(longer_key)->Nr != 14) {
+        throw testbench_error("Keys of different lengths share a cache entry!", Tests::KEY_CACHE);
+    }
+
+    //with three entries, touching the first key makes the longer key the least recently used one
+    keycache::schedule(first_key);
+    keycache::schedule(random_bytes(g, 24));
+    const keycache::statistics before = keycache::stats();
+    keycache::schedule(random_bytes(g, 16));
+    if (keycache::size() != 3 || keycache::stats().evictions != before.evictions + 1 || keycache::schedule(first_key) != first) {
+        throw testbench_error("The least recently used key was not the one evicted!", Tests::KEY_CACHE);
+    }
+
+    //an evicted schedule stays usable by whoever holds it
+    keycache::clear();
+    if (keycache::size() != 0 || first->encryption_words != aes::KeySchedule(first_key).encryption_words) {
+        throw testbench_error("A held schedule changed when it was evicted!", Tests::KEY_CACHE);
+    }
+    first.reset();
+
+    //threads sharing a few keys through a cache too small for all of them
+    std::vector<std::vector<aes::byte>> keys;
+    for (std::size_t size : {16, 24, 32, 16, 32}) {
+        keys.push_back(random_bytes(g, size));
+    }
+    const std::vector<aes::byte> plaintext = random_bytes(g, 16);
+    std::vector<std::vector<aes::byte>> expected;
+    for (const std::vector<aes::byte>& key : keys) {
+        expected.push_back(std::vector<aes::byte>(16));
+        aes::encrypt_block(aes::KeySchedule(key), plaintext.data(), expected.back().data());
+    }
+    std::vector<int> failures(THREAD_COUNT, 0);
+    std::vector<std::thread> threads;
+    for (unsigned int t = 0; t < THREAD_COUNT; t++) {
+        threads.emplace_back([&, t]() {
+            std::vector<aes::byte> block(16);
+            for (unsigned int run = 0; run < RUN_COUNT / 10; run++) {
+                const std::size_t k = (run * 7 + t) % keys.size();
+                aes::encrypt_block(*keycache::schedule(keys[k]), plaintext.data(), block.data());
+                failures[t] += static_cast<int>(block != expected[k]);
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    if (std::any_of(failures.begin(), failures.end(), [](int count) { return count != 0; }) || keycache::size() > 3) {
+        throw testbench_error("Concurrent lookups returned a wrong schedule!", Tests::KEY_CACHE);
+    }
+
+    //short messages under one key, the workload the cache is for (ECB, CTR would time its nonce generation)
+    keycache::set_capacity(keycache::DEFAULT_CAPACITY);
+    const std::vector<aes::byte> key = random_bytes(g, 32);
+    const std::vector<aes::byte> short_message = random_bytes(g, 16);
+    auto start = std::chrono::high_resolution_clock::now();
+    for (unsigned int run = 0; run < RUN_COUNT; run++) {
+        ciphermodes::ECB_Encrypt(short_message, aes::KeySchedule(key));
+    }
+    auto middle = std::chrono::high_resolution_clock::now();
+    for (unsigned int run = 0; run < RUN_COUNT; run++) {
+        ciphermodes::ECB_Encrypt(short_message, key);
+    }
+    auto stop = std::chrono::high_resolution_clock::now();
+    std::cout << "16-byte ECB message: " << std::chrono::duration<double, std::nano>(middle - start).count() / RUN_COUNT
+              << " ns expanding the key every time, " << std::chrono::duration<double, std::nano>(stop - middle).count() / RUN_COUNT
+              << " ns through the cache\n";
+
+    keycache::clear();
+    keycache::set_capacity(original_capacity);
+    std::cout << "Cached schedules are reused, evicted least recently used first and safe to share between threads\n";
+    std::cout <<"==========END KEY CACHE TEST==========\n";
+}
+
+void tb::test_span_modes(){
+    using mode_function = std::vector<aes::byte> (*)(aes::span<const aes::byte>, const aes::KeySchedule&);
+    struct mode {
+        const char* name;
+        mode_function encrypt;
+        mode_function decrypt;
+    };
+    const std::array<mode, 5> modes = {{
+        {"ECB", ciphermodes::ECB_Encrypt, ciphermodes::ECB_Decrypt},
+        {"CTR", ciphermodes::CTR_Encrypt, ciphermodes::CTR_Decrypt},
+        {"CBC", ciphermodes::CBC_Encrypt, ciphermodes::CBC_Decrypt},
+        {"CFB", ciphermodes::CFB_Encrypt, ciphermodes::CFB_Decrypt},
+        {"OFM", ciphermodes::OFM_Encrypt, ciphermodes::OFM_Decrypt},
+    }};
+    std::cout <<"==========SPAN MODES ACCURACY TEST==========\n";
+
+    std::mt19937 g(std::random_device{}());
+    std::vector<aes::byte> key = random_bytes(g, 32);
+    const aes::KeySchedule schedule(key);
+
+    //the message sits at an odd offset of a larger buffer, every length around the block boundaries is tried
+    std::vector<aes::byte> buffer = random_bytes(g, 1000);
+    const aes::span<const aes::byte> whole(buffer);
+    for (std::size_t length : {0, 1, 15, 16, 17, 31, 32, 33, 255, 256, 257, 900}) {
+        const aes::span<const aes::byte> message = whole.subspan(7, length);
+        const std::vector<aes::byte> copy(message.begin(), message.end());
+
+        if (ciphermodes::ECB_Encrypt(message, schedule) != ciphermodes::ECB_Encrypt(copy, schedule)) {
+            throw testbench_error("ECB encrypts a span differently from a vector!", Tests::SPAN_MODES);
+        }
+        for (const mode& m : modes) {
+            //the ciphertext is also decrypted through a span into a larger buffer
+            const std::vector<aes::byte> ciphertext = m.encrypt(message, schedule);
+            std::vector<aes::byte> surrounded(ciphertext.size() + 32, 0xa5);
+            std::copy(ciphertext.begin(), ciphertext.end(), surrounded.begin() + 16);
+            const aes::span<const aes::byte> inner = aes::span<const aes::byte>(surrounded).subspan(16, ciphertext.size());
+            if (m.decrypt(inner, schedule) != copy || m.decrypt(ciphertext, schedule) != copy) {
+                throw testbench_error((std::string(m.name) + " does not decrypt a span of " + std::to_string(length) + " bytes!").c_str(), Tests::SPAN_MODES);
+            }
+        }
+    }
+
+    //an array of blocks is one contiguous run of bytes for the bulk functions and the modes
+    std::array<aes::block, 4> blocks{};
+    for (aes::block& b : blocks) {
+        const std::vector<aes::byte> bytes = random_bytes(g, b.bytes.size());
+        std::copy(bytes.begin(), bytes.end(), b.bytes.begin());
+    }
+    const std::array<aes::block, 4> original = blocks;
+    aes::encrypt_blocks(schedule, blocks[0].data(), blocks[0].data(), blocks.size());
+    const aes::span<const aes::byte> block_bytes(original[0].data(), sizeof(original));
+    std::vector<aes::byte> expected = ciphermodes::ECB_Encrypt(block_bytes, schedule);
+    for (std::size_t i = 0; i < blocks.size(); i++) {
+        if (!std::equal(blocks[i].bytes.begin(), blocks[i].bytes.end(), expected.begin() + 16 * static_cast<std::ptrdiff_t>(i))) {
+            throw testbench_error("An array of blocks is not encrypted as contiguous bytes!", Tests::SPAN_MODES);
+        }
+    }
+    if (ciphermodes::create_CTR({}, 0x01020304) != aes::block{{0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 2, 3, 4}}) {
+        throw testbench_error("The counter block does not end with the big-endian counter!", Tests::SPAN_MODES);
+    }
+
+    //corrupted padding is rejected instead of read past the start of the plaintext
+    std::vector<aes::byte> bad_padding(16, 0x11);
+    aes::encrypt_blocks(schedule, bad_padding.data(), bad_padding.data(), 1);
+    bool rejected = false;
+    try {
+        ciphermodes::ECB_Decrypt(bad_padding, schedule);
+    } catch (const aes_error&) {
+        rejected = true;
+    }
+    if (!rejected) {
+        throw testbench_error("A padding longer than the message was accepted!", Tests::SPAN_MODES);
+    }
+
+    std::cout << "Every mode reads spans of larger buffers and arrays of blocks like vectors\n";
+    std::cout <<"==========END SPAN MODES ACCURACY TEST==========\n";
+}
+
+void tb::test_caller_buffers(){
+    const unsigned int RUN_COUNT = 20000;
+    using buffer_function = std::size_t (*)(aes::span<const aes::byte>, aes::span<aes::byte>, const aes::KeySchedule&);
+    using vector_function = std::vector<aes::byte> (*)(aes::span<const aes::byte>, const aes::KeySchedule&);
+    using size_function = std::size_t (*)(std::size_t);
+    struct mode {
+        const char* name;
+        buffer_function encrypt;
+        buffer_function decrypt;
+        vector_function decrypt_vector;
+        size_function encrypted_size;
+        size_function decrypted_size;
+    };
+    const std::array<mode, 5> modes = {{
+        {"ECB", ciphermodes::ECB_Encrypt, ciphermodes::ECB_Decrypt, ciphermodes::ECB_Decrypt, ciphermodes::ECB_Encrypted_size, ciphermodes::ECB_Decrypted_size},
+        {"CTR", ciphermodes::CTR_Encrypt, ciphermodes::CTR_Decrypt, ciphermodes::CTR_Decrypt, ciphermodes::CTR_Encrypted_size, ciphermodes::CTR_Decrypted_size},
+        {"CBC", ciphermodes::CBC_Encrypt, ciphermodes::CBC_Decrypt, ciphermodes::CBC_Decrypt, ciphermodes::CBC_Encrypted_size, ciphermodes::CBC_Decrypted_size},
+        {"CFB", ciphermodes::CFB_Encrypt, ciphermodes::CFB_Decrypt, ciphermodes::CFB_Decrypt, ciphermodes::CFB_Encrypted_size, ciphermodes::CFB_Decrypted_size},
+        {"OFM", ciphermodes::OFM_Encrypt, ciphermodes::OFM_Decrypt, ciphermodes::OFM_Decrypt, ciphermodes::OFM_Encrypted_size, ciphermodes::OFM_Decrypted_size},
+    }};
+    std::cout <<"==========CALLER BUFFERS ACCURACY TEST==========\n";
+
+    std::mt19937 g(std::random_device{}());
+    std::vector<aes::byte> key = random_bytes(g, 16);
+    const aes::KeySchedule schedule(key);
+
+    for (const mode& m : modes) {
+        auto fail = [&m](const std::string& message) {
+            throw testbench_error((std::string(m.name) + ": " + message).c_str(), Tests::CALLER_BUFFERS);
+        };
+        //lengths crossing the chunk size of the bulk functions as well as the block boundaries
+        for (std::size_t length : {0, 1, 15, 16, 17, 100, 1023, 1024, 1025, 5000}) {
+            std::vector<aes::byte> plaintext = random_bytes(g, length);
+
+            //into a separate buffer with room to spare, which must be left alone past the reported size
+            std::vector<aes::byte> ciphertext(m.encrypted_size(length) + 8, 0xa5);
+            const std::size_t written = m.encrypt(plaintext, ciphertext, schedule);
+            if (written != m.encrypted_size(length) || std::any_of(ciphertext.begin() + static_cast<std::ptrdiff_t>(written), ciphertext.end(), [](aes::byte b) { return b != 0xa5; })) {
+                fail("the ciphertext does not have the reported size");
+            }
+            ciphertext.resize(written);
+            std::vector<aes::byte> decrypted(m.decrypted_size(written));
+            if (decrypted.size() < length || m.decrypt(ciphertext, decrypted, schedule) != length ||
+                !std::equal(plaintext.begin(), plaintext.end(), decrypted.begin()) || m.decrypt_vector(ciphertext, schedule) != plaintext) {
+                fail("a caller buffer does not decrypt to the plaintext");
+            }
+
+            //in place, the plaintext at the start of a buffer large enough for the ciphertext
+            std::vector<aes::byte> buffer(m.encrypted_size(length));
+            std::copy(plaintext.begin(), plaintext.end(), buffer.begin());
+            const std::size_t encrypted = m.encrypt(aes::span<const aes::byte>(buffer.data(), length), buffer, schedule);
+            const std::size_t decrypted_length = m.decrypt(aes::span<const aes::byte>(buffer.data(), encrypted), buffer, schedule);
+            if (decrypted_length != length || !std::equal(plaintext.begin(), plaintext.end(), buffer.begin())) {
+                fail("in place encryption and decryption do not give back the plaintext");
+            }
+        }
+
+        //a buffer one byte short is rejected before anything is written
+        std::vector<aes::byte> plaintext(40, 0x3c);
+        std::vector<aes::byte> small(m.encrypted_size(plaintext.size()) - 1, 0xa5);
+        bool rejected = false;
+        try {
+            m.encrypt(plaintext, small, schedule);
+        } catch (const aes_error&) {
+            rejected = std::all_of(small.begin(), small.end(), [](aes::byte b) { return b == 0xa5; });
+        }
+        if (!rejected) {
+            fail("an output buffer that is too small was accepted");
+        }
+    }
+
+    //small messages with the output buffer reused, the pooled-buffer workload, against the vector API
+    std::vector<aes::byte> message(64, 0x42);
+    std::vector<aes::byte> pooled(ciphermodes::ECB_Encrypted_size(message.size()));
+    auto start = std::chrono::high_resolution_clock::now();
+    for (unsigned int run = 0; run < RUN_COUNT; run++) {
+        ciphermodes::ECB_Encrypt(message, schedule);
+    }
+    auto middle = std::chrono::high_resolution_clock::now();
+    for (unsigned int run = 0; run < RUN_COUNT; run++) {
+        ciphermodes::ECB_Encrypt(message, pooled, schedule);
+    }
+    auto stop = std::chrono::high_resolution_clock::now();
+    std::cout << "64-byte ECB message: " << std::chrono::duration<double, std::nano>(middle - start).count() / RUN_COUNT
+              << " ns returning a vector, " << std::chrono::duration<double, std::nano>(stop - middle).count() / RUN_COUNT
+              << " ns into a reused buffer\n";
+
+    std::cout << "Every mode encrypts and decrypts into caller buffers and in place, within the sizes it reports\n";
+    std::cout <<"==========END CALLER BUFFERS ACCURACY TEST==========\n";
+}
+
+void tb::test_parallel_modes(){
+    const std::size_t LARGE_BYTES = 64 * 1024 * 1024;
+    using buffer_function = std::size_t (*)(aes::span<const aes::byte>, aes::span<aes::byte>, const aes::KeySchedule&);
+    using size_function = std::size_t (*)(std::size_t);
+    struct mode {
+        const char* name;
+        buffer_function encrypt;
+        buffer_function decrypt;
+        size_function encrypted_size;
+        size_function decrypted_size;
+    };
+    const std::array<mode, 4> modes = {{
+        {"ECB", ciphermodes::ECB_Encrypt, ciphermodes::ECB_Decrypt, ciphermodes::ECB_Encrypted_size, ciphermodes::ECB_Decrypted_size},
+        {"CTR", ciphermodes::CTR_Encrypt, ciphermodes::CTR_Decrypt, ciphermodes::CTR_Encrypted_size, ciphermodes::CTR_Decrypted_size},
+        {"CBC", ciphermodes::CBC_Encrypt, ciphermodes::CBC_Decrypt, ciphermodes::CBC_Encrypted_size, ciphermodes::CBC_Decrypted_size},
+        {"CFB", ciphermodes::CFB_Encrypt, ciphermodes::CFB_Decrypt, ciphermodes::CFB_Encrypted_size, ciphermodes::CFB_Decrypted_size},
+    }};
+    std::cout <<"==========PARALLEL MODES ACCURACY TEST==========\n";
+
+    std::mt19937 g(std::random_device{}());
+    std::vector<aes::byte> key = random_bytes(g, 32);
+    const aes::KeySchedule schedule(key);
+    const unsigned int original_threads = ciphermodes::thread_count();
+    const std::size_t original_chunk_blocks = ciphermodes::chunk_blocks();
+
+    //a few ranges per thread count, with a partial last block, so the ranges do not split evenly. The smaller chunk
+    //size gives every thread count its full number of ranges
+    std::vector<aes::byte> plaintext = random_bytes(g, 5 * ciphermodes::PARALLEL_MIN_BLOCKS * 16 + 7);
+    for (const mode& m : modes) {
+        for (std::size_t chunk_blocks : {std::size_t{0}, std::size_t{1000}}) {
+            for (unsigned int threads : {2, 3, 4, 7}) {
+                auto fail = [&m, threads](const char* message) {
+                    throw testbench_error((std::string(m.name) + " on " + std::to_string(threads) + " threads " + message).c_str(), Tests::PARALLEL_MODES);
+                };
+                ciphermodes::set_chunk_blocks(chunk_blocks);
+
+                //a ciphertext made on several threads decrypts on one thread and the other way round, so the outputs are identical
+                std::vector<aes::byte> ciphertext(m.encrypted_size(plaintext.size()));
+                std::vector<aes::byte> serial(m.decrypted_size(ciphertext.size()));
+                std::vector<aes::byte> parallel(serial.size());
+                ciphermodes::set_thread_count(threads);
+                m.encrypt(plaintext, ciphertext, schedule);
+                ciphermodes::set_thread_count(1);
+                serial.resize(m.decrypt(ciphertext, serial, schedule));
+                ciphermodes::set_thread_count(threads);
+                parallel.resize(m.decrypt(ciphertext, parallel, schedule));
+                if (serial != plaintext || parallel != plaintext) {
+                    fail("differs from one thread!");
+                }
+
+                //in place, where every range is written over the end of the range before it
+                std::vector<aes::byte> buffer = ciphertext;
+                const std::size_t length = m.decrypt(buffer, buffer, schedule);
+                if (length != plaintext.size() || !std::equal(plaintext.begin(), plaintext.end(), buffer.begin())) {
+                    fail("does not recover the plaintext in place!");
+                }
+            }
+        }
+    }
+
+    //ECB has no IV, so its ciphertext is compared directly
+    ciphermodes::set_chunk_blocks(1);
+    ciphermodes::set_thread_count(7);
+    const std::vector<aes::byte> parallel_ecb = ciphermodes::ECB_Encrypt(plaintext, schedule);
+    ciphermodes::set_thread_count(1);
+    if (parallel_ecb != ciphermodes::ECB_Encrypt(plaintext, schedule)) {
+        throw testbench_error("ECB on 7 threads differs from ECB on one thread!", Tests::PARALLEL_MODES);
+    }
+    ciphermodes::set_chunk_blocks(original_chunk_blocks);
+
+    //throughput on one thread and on every hardware thread
+    std::vector<aes::byte> large(LARGE_BYTES, 0x5a);
+    for (const mode& m : modes) {
+        std::vector<aes::byte> ciphertext(m.encrypted_size(large.size()));
+        std::vector<aes::byte> output(m.decrypted_size(ciphertext.size()));
+        m.encrypt(large, ciphertext, schedule);
+        for (unsigned int threads : {1U, std::max(1U, std::thread::hardware_concurrency())}) {
+            ciphermodes::set_thread_count(threads);
+            m.decrypt(ciphertext, output, schedule); // brings the output pages in
+            auto start = std::chrono::high_resolution_clock::now();
+            m.decrypt(ciphertext, output, schedule);
+            auto stop = std::chrono::high_resolution_clock::now();
+            std::cout << "64 MB " << m.name << " decryption on " << threads << " thread(s): "
+                      << LARGE_BYTES / std::chrono::duration<double, std::micro>(stop - start).count() << " MB/s\n";
+        }
+    }
+
+    ciphermodes::set_thread_count(original_threads);
+    ciphermodes::set_chunk_blocks(original_chunk_blocks);
+    std::cout << "Modes split over several threads match them on one thread byte for byte\n";
+    std::cout <<"==========END PARALLEL MODES ACCURACY TEST==========\n";
+}
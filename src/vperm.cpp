@@ -0,0 +1,232 @@
+#include "vperm.hpp"
+#include "gf256.hpp"
+#include "yandom.hpp"
+#include <tmmintrin.h> // SSSE3 (pshufb)
+#include <utility>
+
+namespace {
+    static_assert(sizeof(aes::state) == 16, "aes::state must be a contiguous 16 byte matrix");
+
+    auto load_table(const std::array<aes::byte, 16>& table) -> __m128i {
+        return _mm_load_si128(reinterpret_cast<const __m128i*>(table.data()));
+    }
+
+    // Same layout conversions as the AES-NI engine: the block is kept column-major (byte 4c + r) inside the register
+    auto transpose_mask() -> __m128i {
+        return _mm_setr_epi8(0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15);
+    }
+
+    auto word_swap_mask() -> __m128i {
+        return _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    }
+
+    auto load_state(const aes::state& state) -> __m128i {
+        return _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(state.data())), transpose_mask());
+    }
+
+    void store_state(aes::state& state, __m128i block) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(state.data()), _mm_shuffle_epi8(block, transpose_mask()));
+    }
+
+    auto load_round_key(const std::vector<aes::word>& w, unsigned int round) -> __m128i {
+        return _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&w[4 * round])), word_swap_mask());
+    }
+
+    // new[4c + r] = old[4((c + r) % 4) + r]
+    auto shift_rows(__m128i block) -> __m128i {
+        return _mm_shuffle_epi8(block, _mm_setr_epi8(0, 5, 10, 15, 4, 9, 14, 3, 8, 13, 2, 7, 12, 1, 6, 11));
+    }
+
+    // new[4c + r] = old[4((c - r) % 4) + r]
+    auto inv_shift_rows(__m128i block) -> __m128i {
+        return _mm_shuffle_epi8(block, _mm_setr_epi8(0, 13, 10, 7, 4, 1, 14, 11, 8, 5, 2, 15, 12, 9, 6, 3));
+    }
+
+    // Rotates every column up by one row: new[4c + r] = old[4c + (r + 1) % 4]
+    auto rotate_column(__m128i block) -> __m128i {
+        return _mm_shuffle_epi8(block, _mm_setr_epi8(1, 2, 3, 0, 5, 6, 7, 4, 9, 10, 11, 8, 13, 14, 15, 12));
+    }
+
+    // Rotates every column by two rows, which swaps the 16-bit halves of every 32-bit lane
+    auto rotate_column_twice(__m128i block) -> __m128i {
+        return _mm_or_si128(_mm_slli_epi32(block, 16), _mm_srli_epi32(block, 16));
+    }
+
+    // 2a_r ^ 3a_(r+1) ^ a_(r+2) ^ a_(r+3) rewritten as xtime(t_r) ^ a_(r+1) ^ t_(r+2) with t_r = a_r ^ a_(r+1)
+    auto mix_columns(__m128i block) -> __m128i {
+        const __m128i rotated = rotate_column(block);
+        const __m128i t = _mm_xor_si128(block, rotated);
+        return _mm_xor_si128(_mm_xor_si128(gf256::xtime_state(t), rotated), rotate_column_twice(t));
+    }
+
+    // InvMixColumns factors into MixColumns after adding 4(a_r ^ a_(r+2)) to every byte
+    auto inv_mix_columns(__m128i block) -> __m128i {
+        const __m128i u = gf256::xtime_state(gf256::xtime_state(_mm_xor_si128(block, rotate_column_twice(block))));
+        return mix_columns(_mm_xor_si128(block, u));
+    }
+
+    /*
+     * Inverts every byte of a block given in the tower representation, returning the two GF(2^4) halves io and jo
+     * of the inverse. The 0x80 entries of INV and A_OVER stand for 1/0: they make the dependent pshufb return 0.
+     */
+    void tower_inverse(__m128i code, __m128i& io, __m128i& jo) {
+        const __m128i low_nibbles = _mm_set1_epi8(0x0f);
+        const __m128i inv = load_table(vperm::INV);
+
+        const __m128i k = _mm_and_si128(code, low_nibbles);
+        const __m128i i = _mm_and_si128(_mm_srli_epi16(code, 4), low_nibbles);
+        const __m128i ak = _mm_shuffle_epi8(load_table(vperm::A_OVER), k);
+        const __m128i j = _mm_xor_si128(i, k);
+        const __m128i iak = _mm_xor_si128(_mm_shuffle_epi8(inv, i), ak);
+        const __m128i jak = _mm_xor_si128(_mm_shuffle_epi8(inv, j), ak);
+        io = _mm_xor_si128(_mm_shuffle_epi8(inv, iak), j);
+        jo = _mm_xor_si128(_mm_shuffle_epi8(inv, jak), i);
+    }
+
+    // Looks every byte up in a pair of tables indexed by its low and high nibble
+    auto nibble_transform(__m128i block, const std::array<aes::byte, 16>& lo, const std::array<aes::byte, 16>& hi) -> __m128i {
+        const __m128i low_nibbles = _mm_set1_epi8(0x0f);
+        const __m128i l = _mm_and_si128(block, low_nibbles);
+        const __m128i h = _mm_and_si128(_mm_srli_epi16(block, 4), low_nibbles);
+        return _mm_xor_si128(_mm_shuffle_epi8(load_table(lo), l), _mm_shuffle_epi8(load_table(hi), h));
+    }
+
+    auto sub_bytes(__m128i block) -> __m128i {
+        __m128i io;
+        __m128i jo;
+        tower_inverse(nibble_transform(block, vperm::IPT_LO, vperm::IPT_HI), io, jo);
+        const __m128i out = _mm_xor_si128(_mm_shuffle_epi8(load_table(vperm::SBO_1), io), _mm_shuffle_epi8(load_table(vperm::SBO_2), jo));
+        return _mm_xor_si128(out, _mm_set1_epi8(0x63));
+    }
+
+    auto inv_sub_bytes(__m128i block) -> __m128i {
+        __m128i io;
+        __m128i jo;
+        tower_inverse(nibble_transform(block, vperm::DIPT_LO, vperm::DIPT_HI), io, jo);
+        return _mm_xor_si128(_mm_shuffle_epi8(load_table(vperm::DSBO_1), io), _mm_shuffle_epi8(load_table(vperm::DSBO_2), jo));
+    }
+
+    // Runs the cipher on a block that is already in column-major order, with the round keys in block order.
+    // Round is the sequence 0 .. Nr - 2, so the fold expression unrolls the Nr - 1 full rounds at compile time.
+    template <unsigned int Nr, std::size_t... Round>
+    auto encrypt_register(__m128i block, const __m128i* round_keys, std::index_sequence<Round...> /*rounds*/) -> __m128i {
+        //Performs an AddRoundkey before the 10,12, or 14 rounds of AES
+        block = _mm_xor_si128(block, _mm_load_si128(&round_keys[0]));
+
+        ((block = _mm_xor_si128(mix_columns(shift_rows(sub_bytes(block))), _mm_load_si128(&round_keys[Round + 1]))), ...);
+
+        //the last round omits mix columns
+        return _mm_xor_si128(shift_rows(sub_bytes(block)), _mm_load_si128(&round_keys[Nr]));
+    }
+
+    // The decryption round keys are in the order they are consumed, last round key first
+    template <unsigned int Nr, std::size_t... Round>
+    auto decrypt_register(__m128i block, const __m128i* round_keys, std::index_sequence<Round...> /*rounds*/) -> __m128i {
+        //reverses the last round key
+        block = _mm_xor_si128(block, _mm_load_si128(&round_keys[0]));
+
+        //equivalent inverse cipher, the middle round keys already have InvMixColumns applied
+        ((block = _mm_xor_si128(inv_mix_columns(inv_sub_bytes(inv_shift_rows(block))), _mm_load_si128(&round_keys[Round + 1]))), ...);
+
+        //reverses the first round, which has no mix columns
+        return _mm_xor_si128(inv_sub_bytes(inv_shift_rows(block)), _mm_load_si128(&round_keys[Nr]));
+    }
+
+    template <unsigned int Nr>
+    auto encrypt_register(__m128i block, const __m128i* round_keys) -> __m128i {
+        return encrypt_register<Nr>(block, round_keys, std::make_index_sequence<Nr - 1>{});
+    }
+
+    template <unsigned int Nr>
+    auto decrypt_register(__m128i block, const __m128i* round_keys) -> __m128i {
+        return decrypt_register<Nr>(block, round_keys, std::make_index_sequence<Nr - 1>{});
+    }
+
+    auto encrypt_register(unsigned int Nr, __m128i block, const __m128i* round_keys) -> __m128i {
+        switch (Nr) {
+            case 10: return encrypt_register<10>(block, round_keys);
+            case 12: return encrypt_register<12>(block, round_keys);
+            default: return encrypt_register<14>(block, round_keys);
+        }
+    }
+
+    auto decrypt_register(unsigned int Nr, __m128i block, const __m128i* round_keys) -> __m128i {
+        switch (Nr) {
+            case 10: return decrypt_register<10>(block, round_keys);
+            case 12: return decrypt_register<12>(block, round_keys);
+            default: return decrypt_register<14>(block, round_keys);
+        }
+    }
+
+    auto schedule_keys(const std::array<aes::byte, 16 * (aes::MAX_NR + 1)>& blocks) -> const __m128i* {
+        return reinterpret_cast<const __m128i*>(blocks.data());
+    }
+
+    // Round keys of a key expanded into words, in encryption order
+    void load_round_keys(unsigned int Nr, const std::vector<aes::word>& w, std::array<aes::byte, 16 * (aes::MAX_NR + 1)>& blocks) {
+        auto* round_keys = reinterpret_cast<__m128i*>(blocks.data());
+        for (unsigned int i = 0; i <= Nr; i++) {
+            _mm_store_si128(round_keys + i, load_round_key(w, i));
+        }
+    }
+
+    // Round keys of the equivalent inverse cipher, in the order decrypt_register consumes them
+    void load_inverse_round_keys(unsigned int Nr, const std::vector<aes::word>& w, std::array<aes::byte, 16 * (aes::MAX_NR + 1)>& blocks) {
+        auto* round_keys = reinterpret_cast<__m128i*>(blocks.data());
+        _mm_store_si128(round_keys, load_round_key(w, Nr));
+        for (unsigned int i = 1; i < Nr; i++) {
+            _mm_store_si128(round_keys + i, inv_mix_columns(load_round_key(w, Nr - i)));
+        }
+        _mm_store_si128(round_keys + Nr, load_round_key(w, 0));
+    }
+} // namespace
+
+auto vperm::supported() -> bool {
+    static const bool has_ssse3 = []() {
+        std::array<unsigned int, 4> cpu_info{};
+        cpuid(cpu_info.data(), 1);
+        return (cpu_info[2] & SSSE3_FLAG) != 0;
+    }();
+    return has_ssse3;
+}
+
+void vperm::encrypt(unsigned int Nr, aes::state& state, const std::vector<aes::word>& w) {
+    alignas(16) std::array<aes::byte, 16 * (aes::MAX_NR + 1)> round_keys{};
+    load_round_keys(Nr, w, round_keys);
+    store_state(state, encrypt_register(Nr, load_state(state), schedule_keys(round_keys)));
+}
+
+void vperm::decrypt(unsigned int Nr, aes::state& state, const std::vector<aes::word>& w) {
+    alignas(16) std::array<aes::byte, 16 * (aes::MAX_NR + 1)> round_keys{};
+    load_inverse_round_keys(Nr, w, round_keys);
+    store_state(state, decrypt_register(Nr, load_state(state), schedule_keys(round_keys)));
+}
+
+void vperm::encrypt_block(const aes::KeySchedule& schedule, const aes::byte* in, aes::byte* out) {
+    const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), encrypt_register(schedule.Nr, block, schedule_keys(schedule.encryption_blocks)));
+}
+
+void vperm::decrypt_block(const aes::KeySchedule& schedule, const aes::byte* in, aes::byte* out) {
+    const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), decrypt_register(schedule.Nr, block, schedule_keys(schedule.decryption_blocks)));
+}
+
+template <unsigned int Nr>
+void vperm::encrypt_block(const aes::KeySchedule& schedule, const aes::byte* in, aes::byte* out) {
+    const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), encrypt_register<Nr>(block, schedule_keys(schedule.encryption_blocks)));
+}
+
+template <unsigned int Nr>
+void vperm::decrypt_block(const aes::KeySchedule& schedule, const aes::byte* in, aes::byte* out) {
+    const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), decrypt_register<Nr>(block, schedule_keys(schedule.decryption_blocks)));
+}
+
+template void vperm::encrypt_block<10>(const aes::KeySchedule& schedule, const aes::byte* in, aes::byte* out);
+template void vperm::encrypt_block<12>(const aes::KeySchedule& schedule, const aes::byte* in, aes::byte* out);
+template void vperm::encrypt_block<14>(const aes::KeySchedule& schedule, const aes::byte* in, aes::byte* out);
+template void vperm::decrypt_block<10>(const aes::KeySchedule& schedule, const aes::byte* in, aes::byte* out);
+template void vperm::decrypt_block<12>(const aes::KeySchedule& schedule, const aes::byte* in, aes::byte* out);
+template void vperm::decrypt_block<14>(const aes::KeySchedule& schedule, const aes::byte* in, aes::byte* out);